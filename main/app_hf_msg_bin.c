@@ -0,0 +1,330 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/*
+The `app_hf_msg_bin.c` file implements a compact binary control protocol for host automation, next to
+the `hf <cmd> <args>;` text commands that stay for humans.
+
+1. Frames:
+    - SOF (0xA5), a little-endian length, then type, request id, opcode and typed arguments, closed by
+    a CRC-16/CCITT-FALSE over length through arguments (layout in `app_hf_msg_bin.h`). The deframer
+    hunts for SOF and drops frames with a bad length or CRC, so text output on the same UART (logs
+    of other tasks) never breaks the stream. A rejected frame's bytes are scanned again from the byte
+    after its SOF, so a real frame that starts inside noise or a corrupt frame is not lost.
+
+2. Requests:
+    - The opcode is the `opcode` field of `hf_cmd_tbl`, looked up with `hf_find_cmd_by_opcode`. The
+    typed arguments are turned into the argv strings the existing handlers take, so one handler
+    serves both protocols. Every request is answered with a RSP frame carrying the same request id,
+    a status and the handler return, so a host can pipeline requests and match answers by id.
+    - Commands are queued to the executor task (`hf_exec_post`) like console commands, so a slow
+    handler (`con` sleeps a second) never stalls the deframer, and PING is answered meanwhile. The
+    executor discards the handler's printf output and calls `hf_bin_done`, which sends the RSP. A
+    full queue is answered with HF_BIN_ST_BUSY.
+
+3. Events:
+    - While binary mode is active, `hf_bin_notify` sends EVT frames for connection and audio state
+    changes from `bt_app_hf_cb`, so the host waits on events instead of polling.
+
+4. Binary mode:
+    - `hf binmode;` (or the `binmode` console command) hands the console UART to `hf_bin_run`. It
+    returns to the REPL on an EXIT frame or after HF_BIN_IDLE_TIMEOUT_MS without a valid frame.
+    tools/hf_bin_client.py is the reference host client.
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "app_hf_msg_bin.h"
+#include "app_hf_msg_set.h"
+#include "app_hf_msg_exec.h"
+
+#define HF_BIN_TAG            "HF_BIN"
+#define HF_BIN_UART           (CONFIG_ESP_CONSOLE_UART_NUM)
+#define HF_BIN_ARG_STR_MAX    (HF_BIN_BODY_MAX)
+
+typedef enum {
+    HF_BIN_PRS_SOF = 0,
+    HF_BIN_PRS_LEN_LO,
+    HF_BIN_PRS_LEN_HI,
+    HF_BIN_PRS_BODY,
+    HF_BIN_PRS_CRC_LO,
+    HF_BIN_PRS_CRC_HI,
+} hf_bin_prs_state_t;
+
+typedef struct {
+    hf_bin_prs_state_t state;
+    uint16_t len;
+    uint16_t raw_len;
+    uint8_t raw[2 + HF_BIN_BODY_MAX + 2];   // the bytes after SOF: len, body, crc
+} hf_bin_prs_t;
+
+static hf_bin_prs_t s_bin_prs;
+// bytes after the SOF of a rejected frame, scanned again for a SOF before new input
+static uint8_t s_bin_replay[sizeof(s_bin_prs.raw)];
+static volatile bool s_bin_active = false;
+static uint32_t s_bin_frames;
+static uint32_t s_bin_crc_errors;
+static uint32_t s_bin_len_errors;
+
+uint16_t hf_bin_crc16(const uint8_t *buf, size_t len, uint16_t crc)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)buf[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void hf_bin_send(hf_bin_type_t type, uint8_t req_id, uint16_t opcode, const uint8_t *args, size_t args_len)
+{
+    uint8_t frame[3 + HF_BIN_BODY_MAX + 2];
+    size_t body_len = HF_BIN_BODY_MIN + args_len;
+    if (body_len > HF_BIN_BODY_MAX) {
+        return;
+    }
+    uint8_t *p = frame;
+    *p++ = HF_BIN_SOF;
+    *p++ = body_len & 0xff;
+    *p++ = body_len >> 8;
+    *p++ = type;
+    *p++ = req_id;
+    *p++ = opcode & 0xff;
+    *p++ = opcode >> 8;
+    memcpy(p, args, args_len);
+    p += args_len;
+    uint16_t crc = hf_bin_crc16(frame + 1, p - (frame + 1), 0xFFFF);
+    *p++ = crc & 0xff;
+    *p++ = crc >> 8;
+    // one write per frame, the driver serializes writers so frames never interleave
+    uart_write_bytes(HF_BIN_UART, frame, p - frame);
+}
+
+static uint8_t *hf_bin_put_u32(uint8_t *p, uint32_t v)
+{
+    *p++ = HF_BIN_ARG_U32;
+    *p++ = v & 0xff;
+    *p++ = (v >> 8) & 0xff;
+    *p++ = (v >> 16) & 0xff;
+    *p++ = v >> 24;
+    return p;
+}
+
+static void hf_bin_respond(uint8_t req_id, uint16_t opcode, hf_bin_status_t status, int ret)
+{
+    uint8_t args[10];
+    uint8_t *p = hf_bin_put_u32(args, status);
+    p = hf_bin_put_u32(p, (uint32_t)ret);
+    hf_bin_send(HF_BIN_TYPE_RSP, req_id, opcode, args, p - args);
+}
+
+void hf_bin_notify(uint16_t event, uint32_t v0, uint32_t v1)
+{
+    if (!s_bin_active) {
+        return;
+    }
+    uint8_t args[10];
+    uint8_t *p = hf_bin_put_u32(args, v0);
+    p = hf_bin_put_u32(p, v1);
+    hf_bin_send(HF_BIN_TYPE_EVT, 0, event, args, p - args);
+}
+
+// typed arguments -> argv strings for the text handlers, argv[0] is the command name
+static bool hf_bin_args_to_argv(const uint8_t *p, const uint8_t *end, char *strs, char **argv, int *argn)
+{
+    char *s = strs;
+    char *s_end = strs + HF_BIN_ARG_STR_MAX;
+    while (p < end) {
+        if (*argn >= HF_MSG_ARGS_MAX) {
+            return false;
+        }
+        int n;
+        switch (*p++) {
+        case HF_BIN_ARG_U32:
+            if (end - p < 4) {
+                return false;
+            }
+            n = snprintf(s, s_end - s, "%u", (unsigned int)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)));
+            p += 4;
+            break;
+        case HF_BIN_ARG_STR:
+            if (end - p < 1 || end - p - 1 < p[0]) {
+                return false;
+            }
+            n = snprintf(s, s_end - s, "%.*s", p[0], (const char *)p + 1);
+            p += 1 + p[0];
+            break;
+        default:
+            return false;
+        }
+        if (n < 0 || n >= s_end - s) {
+            return false;
+        }
+        argv[(*argn)++] = s;
+        s += n + 1;
+    }
+    return true;
+}
+
+// executor task, the request id and opcode travel in ctx
+static void hf_bin_done(const hf_msg_hdl_t *hdl, uint32_t ctx, int ret)
+{
+    if (s_bin_active) {
+        hf_bin_respond(ctx & 0xff, ctx >> 8, HF_BIN_ST_OK, ret);
+    }
+}
+
+static bool hf_bin_handle(const uint8_t *body, uint16_t len)
+{
+    uint8_t type = body[0];
+    uint8_t req_id = body[1];
+    uint16_t opcode = body[2] | (body[3] << 8);
+
+    if (type != HF_BIN_TYPE_REQ) {
+        hf_bin_respond(req_id, opcode, HF_BIN_ST_BAD_TYPE, 0);
+        return true;
+    }
+    if (opcode == HF_BIN_OP_PING || opcode == HF_BIN_OP_EXIT) {
+        hf_bin_respond(req_id, opcode, HF_BIN_ST_OK, 0);
+        return opcode != HF_BIN_OP_EXIT;
+    }
+
+    const hf_msg_hdl_t *hdl = hf_find_cmd_by_opcode(opcode);
+    if (hdl == NULL || hdl->handler == NULL) {
+        hf_bin_respond(req_id, opcode, HF_BIN_ST_UNKNOWN_OPCODE, 0);
+        return true;
+    }
+
+    char strs[HF_BIN_ARG_STR_MAX];
+    char *argv[HF_MSG_ARGS_MAX];
+    int argn = 1;
+    argv[0] = (char *)hdl->str;
+    if (!hf_bin_args_to_argv(body + HF_BIN_BODY_MIN, body + len, strs, argv, &argn)) {
+        hf_bin_respond(req_id, opcode, HF_BIN_ST_BAD_ARGS, 0);
+        return true;
+    }
+    switch (hf_exec_post(hdl, argn, argv, hf_bin_done, req_id | ((uint32_t)opcode << 8))) {
+    case HF_EXEC_OK:
+        break;
+    case HF_EXEC_ERR_BUSY:
+        hf_bin_respond(req_id, opcode, HF_BIN_ST_BUSY, 0);
+        break;
+    default:
+        hf_bin_respond(req_id, opcode, HF_BIN_ST_BAD_ARGS, 0);
+        break;
+    }
+    return true;
+}
+
+bool hf_bin_feed(const uint8_t *buf, size_t len)
+{
+    hf_bin_prs_t *prs = &s_bin_prs;
+    size_t replay_pos = 0;
+    size_t replay_len = 0;
+    size_t i = 0;
+    bool run = true;
+    while (run && (replay_pos < replay_len || i < len)) {
+        uint8_t c = (replay_pos < replay_len) ? s_bin_replay[replay_pos++] : buf[i++];
+        bool bad = false;
+        if (prs->state != HF_BIN_PRS_SOF) {
+            prs->raw[prs->raw_len++] = c;
+        }
+        switch (prs->state) {
+        case HF_BIN_PRS_SOF:
+            if (c == HF_BIN_SOF) {
+                prs->raw_len = 0;
+                prs->state = HF_BIN_PRS_LEN_LO;
+            }
+            break;
+        case HF_BIN_PRS_LEN_LO:
+            prs->state = HF_BIN_PRS_LEN_HI;
+            break;
+        case HF_BIN_PRS_LEN_HI:
+            prs->len = prs->raw[0] | (prs->raw[1] << 8);
+            if (prs->len < HF_BIN_BODY_MIN || prs->len > HF_BIN_BODY_MAX) {
+                s_bin_len_errors++;
+                bad = true;
+            } else {
+                prs->state = HF_BIN_PRS_BODY;
+            }
+            break;
+        case HF_BIN_PRS_BODY:
+            if (prs->raw_len == 2 + prs->len) {
+                prs->state = HF_BIN_PRS_CRC_LO;
+            }
+            break;
+        case HF_BIN_PRS_CRC_LO:
+            prs->state = HF_BIN_PRS_CRC_HI;
+            break;
+        case HF_BIN_PRS_CRC_HI: {
+            prs->state = HF_BIN_PRS_SOF;
+            uint16_t crc = prs->raw[prs->raw_len - 2] | (prs->raw[prs->raw_len - 1] << 8);
+            if (hf_bin_crc16(prs->raw, 2 + prs->len, 0xFFFF) != crc) {
+                s_bin_crc_errors++;
+                bad = true;
+                break;
+            }
+            s_bin_frames++;
+            run = hf_bin_handle(prs->raw + 2, prs->len);
+            break;
+        }
+        }
+        if (bad) {
+            // the SOF may have been a data byte and a real frame start inside what was taken for
+            // this one: hunt again from the byte after it. Every rejection drops at least that
+            // SOF, so the replay never outgrows the frame buffer and the hunt ends.
+            size_t rest = replay_len - replay_pos;
+            memmove(s_bin_replay + prs->raw_len, s_bin_replay + replay_pos, rest);
+            memcpy(s_bin_replay, prs->raw, prs->raw_len);
+            replay_pos = 0;
+            replay_len = prs->raw_len + rest;
+            prs->state = HF_BIN_PRS_SOF;
+        }
+    }
+    return run;
+}
+
+void hf_bin_run(void)
+{
+    uint8_t buf[64];
+    if (s_bin_active) {
+        return;
+    }
+    memset(&s_bin_prs, 0, sizeof(s_bin_prs));
+    s_bin_frames = 0;
+    s_bin_crc_errors = 0;
+    s_bin_len_errors = 0;
+    printf("binary mode, EXIT frame or %d s idle returns to the console\n", HF_BIN_IDLE_TIMEOUT_MS / 1000);
+    fflush(stdout);
+
+    s_bin_active = true;
+    int64_t last_frame_us = esp_timer_get_time();
+    for (;;) {
+        int n = uart_read_bytes(HF_BIN_UART, buf, sizeof(buf), pdMS_TO_TICKS(100));
+        if (n > 0) {
+            uint32_t frames = s_bin_frames;
+            if (!hf_bin_feed(buf, n)) {
+                break;
+            }
+            if (s_bin_frames != frames) {
+                last_frame_us = esp_timer_get_time();
+            }
+        }
+        if (esp_timer_get_time() - last_frame_us > (int64_t)HF_BIN_IDLE_TIMEOUT_MS * 1000) {
+            break;
+        }
+    }
+    s_bin_active = false;
+
+    ESP_LOGI(HF_BIN_TAG, "left binary mode: %u frames, %u crc errors, %u length errors",
+             (unsigned int)s_bin_frames, (unsigned int)s_bin_crc_errors, (unsigned int)s_bin_len_errors);
+}
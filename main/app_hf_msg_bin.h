@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __APP_HF_MSG_BIN_H__
+#define __APP_HF_MSG_BIN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Frame: SOF | len (LE16) | type | req_id | opcode (LE16) | args | crc (LE16)
+ * len counts type through args, crc is CRC-16/CCITT-FALSE over len through args.
+ * args: a sequence of (arg type, value), u32 is LE32, str is a length byte plus the characters.
+ */
+#define HF_BIN_SOF                  (0xA5)
+#define HF_BIN_BODY_MAX             (256)
+#define HF_BIN_BODY_MIN             (4)
+
+/* leave binary mode when no valid frame arrived for this long, PING keeps it open */
+#define HF_BIN_IDLE_TIMEOUT_MS      (60000)
+
+typedef enum {
+    HF_BIN_TYPE_REQ = 0x01,         // host -> AG, opcode from hf_cmd_tbl
+    HF_BIN_TYPE_RSP = 0x02,         // AG -> host, same req_id and opcode, args: status, handler return;
+                                    // commands answer when done, so out of order with PING
+    HF_BIN_TYPE_EVT = 0x03,         // AG -> host, req_id 0, opcode: esp_hf_cb_event_t
+} hf_bin_type_t;
+
+typedef enum {
+    HF_BIN_ARG_U32 = 0x01,
+    HF_BIN_ARG_STR = 0x02,
+} hf_bin_arg_t;
+
+/* opcodes outside hf_cmd_tbl */
+#define HF_BIN_OP_PING              (0xFFFE)
+#define HF_BIN_OP_EXIT              (0xFFFF)
+
+typedef enum {
+    HF_BIN_ST_OK = 0,
+    HF_BIN_ST_UNKNOWN_OPCODE,
+    HF_BIN_ST_BAD_ARGS,
+    HF_BIN_ST_BAD_TYPE,
+    HF_BIN_ST_BUSY,                 // the command executor queue is full, try again
+} hf_bin_status_t;
+
+/**
+ * @brief     run binary mode on the console UART until an EXIT frame or the idle timeout;
+ *            the REPL does not read the UART meanwhile
+ */
+void hf_bin_run(void);
+
+/**
+ * @brief     feed received bytes to the deframer, complete requests are executed and answered
+ *
+ * @return    false once an EXIT frame was handled
+ */
+bool hf_bin_feed(const uint8_t *buf, size_t len);
+
+/**
+ * @brief     send an event frame with up to two u32 values if binary mode is active
+ */
+void hf_bin_notify(uint16_t event, uint32_t v0, uint32_t v1);
+
+uint16_t hf_bin_crc16(const uint8_t *buf, size_t len, uint16_t crc);
+
+#endif /* __APP_HF_MSG_BIN_H__*/
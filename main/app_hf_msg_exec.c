@@ -0,0 +1,283 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/*
+The `app_hf_msg_exec.c` file moves console command execution off the REPL task.
+
+1. Trampoline:
+    - The console commands are registered with `hf_exec_submit` instead of their handlers. It finds
+    the command by argv[0] (`hf_find_cmd`), copies the arguments into a queue item and returns, so
+    the REPL prompt comes back at once, also while `con` sleeps between SLC and audio connect.
+    - The queue holds HF_EXEC_QUEUE_LEN commands. When it is full the command is rejected with a
+    message instead of blocking the console. So is a command with more than HF_EXEC_ARGS_MAX
+    arguments or more than HF_EXEC_LINE_MAX characters of them, nothing is cut short. With BT_APP_MEM_STATIC the queue storage is static.
+
+2. Executor:
+    - One task runs the queued commands in order, at a priority below the Bluetooth tasks and the
+    app dispatcher, so a slow handler never holds up Bluetooth events. When a handler returns, the
+    executor prints "<cmd>: done" with the return value, queue wait and run time.
+
+3. Latency:
+    - The submit-to-done time of every command is recorded in a per-command histogram with
+    power-of-two millisecond buckets, printed by `hf_exec_dump` (part of the `metrics` command).
+
+4. Binary protocol:
+    - Binary mode requests are queued with `hf_exec_post` and a done callback that sends the
+    response frame. While such a handler runs, the executor points its own stdout at /dev/null, so
+    handler text never lands between binary frames.
+
+5. Scripts:
+    - Script steps go through `hf_exec_run`, which queues the step like a console command, waits for
+    room in the queue instead of failing, and blocks the script task until the executor has run it,
+    so a step sees the same ordering as typed commands and the script still gets its result. The
+    handler output reaches the console.
+
+6. Exceptions:
+    - `binmode` reads the console UART itself and stays synchronous.
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "app_hf_msg_set.h"
+#include "app_hf_msg_exec.h"
+#include "bt_app_tasks.h"
+#include "bt_app_mem.h"
+
+#define HF_EXEC_TAG           "HF_EXEC"
+
+typedef struct {
+    const hf_msg_hdl_t *hdl;
+    hf_exec_done_cb_t done;
+    uint32_t ctx;
+    bool quiet;                     // handler stdout to /dev/null
+    int argn;
+    uint32_t enq_us;
+    char line[HF_EXEC_LINE_MAX];    // arguments, each terminated by '\0'
+} hf_exec_item_t;
+
+static QueueHandle_t s_exec_queue = NULL;
+static TaskHandle_t s_exec_task = NULL;
+static const hf_exec_item_t *s_exec_cur;    /* executor task only */
+static FILE *s_exec_null;                   /* stdout of handlers that report through a callback */
+#if BT_APP_MEM_STATIC
+static StaticQueue_t s_exec_queue_buf;
+static uint8_t s_exec_queue_storage[HF_EXEC_QUEUE_LEN * sizeof(hf_exec_item_t)];
+#endif
+static uint32_t s_exec_hist[HF_EXEC_CMD_MAX][HF_EXEC_HIST_BUCKETS];
+static uint32_t s_exec_max_ms[HF_EXEC_CMD_MAX];
+static uint32_t s_exec_rejected;
+static hf_exec_item_t s_exec_run_item;      /* hf_exec_run's copy, one caller at a time */
+static TaskHandle_t s_exec_run_waiter;
+static int s_exec_run_ret;
+
+static void hf_exec_record(const hf_msg_hdl_t *hdl, uint32_t ms)
+{
+    size_t idx = hdl - hf_get_cmd_tbl();
+    if (idx >= HF_EXEC_CMD_MAX) {
+        return;
+    }
+    uint32_t bucket = (ms == 0) ? 0 : 32 - __builtin_clz(ms);
+    if (bucket >= HF_EXEC_HIST_BUCKETS) {
+        bucket = HF_EXEC_HIST_BUCKETS - 1;
+    }
+    s_exec_hist[idx][bucket]++;
+    if (ms > s_exec_max_ms[idx]) {
+        s_exec_max_ms[idx] = ms;
+    }
+}
+
+static void hf_exec_task(void *arg)
+{
+    static hf_exec_item_t item;
+    char *argv[HF_EXEC_ARGS_MAX];
+    for (;;) {
+        if (xQueueReceive(s_exec_queue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        char *p = item.line;
+        for (int i = 0; i < item.argn; i++) {
+            argv[i] = p;
+            p += strlen(p) + 1;
+        }
+        // stdout is per task, this only silences the handler run here
+        FILE *out = stdout;
+        if (item.quiet && s_exec_null) {
+            stdout = s_exec_null;
+        }
+        uint32_t start_us = (uint32_t)esp_timer_get_time();
+        s_exec_cur = &item;
+        int ret = item.hdl->handler(item.argn, argv);
+        s_exec_cur = NULL;
+        uint32_t end_us = (uint32_t)esp_timer_get_time();
+        if (stdout != out) {
+            fflush(stdout);
+            stdout = out;
+        }
+
+        hf_exec_record(item.hdl, (end_us - item.enq_us) / 1000);
+        if (item.done) {
+            item.done(item.hdl, item.ctx, ret);
+            continue;
+        }
+        printf("%s: done, ret %d, queued %"PRIu32" ms, ran %"PRIu32" ms\n", item.hdl->str, ret,
+               (start_us - item.enq_us) / 1000, (end_us - start_us) / 1000);
+    }
+}
+
+void hf_exec_init(void)
+{
+    if (s_exec_queue) {
+        return;
+    }
+#if BT_APP_MEM_STATIC
+    s_exec_queue = xQueueCreateStatic(HF_EXEC_QUEUE_LEN, sizeof(hf_exec_item_t), s_exec_queue_storage, &s_exec_queue_buf);
+#else
+    s_exec_queue = xQueueCreate(HF_EXEC_QUEUE_LEN, sizeof(hf_exec_item_t));
+#endif
+    // NULL without the /dev/null VFS, then binary mode handler text still reaches the UART
+    s_exec_null = fopen("/dev/null", "w");
+    // below BtAppT and the Bluetooth stack tasks, see BT_APP_TASKS_TABLE
+    bt_app_tasks_create(BT_APP_TASK_EXEC, hf_exec_task, NULL, &s_exec_task);
+}
+
+const char *hf_exec_line(int *argn)
+{
+    if (s_exec_cur == NULL || xTaskGetCurrentTaskHandle() != s_exec_task) {
+        return NULL;
+    }
+    *argn = s_exec_cur->argn;
+    return s_exec_cur->line;
+}
+
+// the arguments one after the other into the item, nothing cut short
+static hf_exec_err_t hf_exec_fill(hf_exec_item_t *item, const hf_msg_hdl_t *hdl, int argn, char **argv)
+{
+    if (argn > HF_EXEC_ARGS_MAX) {
+        return HF_EXEC_ERR_ARGC;
+    }
+    size_t len = 0;
+    for (int i = 0; i < argn; i++) {
+        size_t n = strlen(argv[i]) + 1;
+        if (len + n > sizeof(item->line)) {
+            return HF_EXEC_ERR_LINE;
+        }
+        memcpy(item->line + len, argv[i], n);
+        len += n;
+    }
+    item->hdl = hdl;
+    item->argn = argn;
+    item->enq_us = (uint32_t)esp_timer_get_time();
+    return HF_EXEC_OK;
+}
+
+hf_exec_err_t hf_exec_post(const hf_msg_hdl_t *hdl, int argn, char **argv, hf_exec_done_cb_t done, uint32_t ctx)
+{
+    static hf_exec_item_t item;
+    if (s_exec_queue == NULL) {
+        return HF_EXEC_ERR_BUSY;
+    }
+
+    // only the REPL task posts (binmode runs in it), the static item keeps the copy off its stack
+    hf_exec_err_t err = hf_exec_fill(&item, hdl, argn, argv);
+    if (err != HF_EXEC_OK) {
+        return err;
+    }
+    item.done = done;
+    item.ctx = ctx;
+    item.quiet = (done != NULL);
+    if (xQueueSend(s_exec_queue, &item, 0) != pdTRUE) {
+        s_exec_rejected++;
+        return HF_EXEC_ERR_BUSY;
+    }
+    return HF_EXEC_OK;
+}
+
+static void hf_exec_run_done(const hf_msg_hdl_t *hdl, uint32_t ctx, int ret)
+{
+    s_exec_run_ret = ret;
+    xTaskNotifyGive(s_exec_run_waiter);
+}
+
+hf_exec_err_t hf_exec_run(const hf_msg_hdl_t *hdl, int argn, char **argv, int *ret)
+{
+    if (s_exec_queue == NULL) {
+        return HF_EXEC_ERR_BUSY;
+    }
+    // a handler that runs a command itself would wait for its own executor
+    if (xTaskGetCurrentTaskHandle() == s_exec_task) {
+        *ret = hdl->handler(argn, argv);
+        return HF_EXEC_OK;
+    }
+    hf_exec_err_t err = hf_exec_fill(&s_exec_run_item, hdl, argn, argv);
+    if (err != HF_EXEC_OK) {
+        return err;
+    }
+    s_exec_run_item.done = hf_exec_run_done;
+    s_exec_run_item.ctx = 0;
+    s_exec_run_item.quiet = false;
+    s_exec_run_waiter = xTaskGetCurrentTaskHandle();
+    xQueueSend(s_exec_queue, &s_exec_run_item, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    *ret = s_exec_run_ret;
+    return HF_EXEC_OK;
+}
+
+int hf_exec_submit(int argn, char **argv)
+{
+    const hf_msg_hdl_t *hdl = (argn > 0) ? hf_find_cmd(argv[0]) : NULL;
+    if (hdl == NULL || hdl->handler == NULL || s_exec_queue == NULL) {
+        printf("unsupported command\n");
+        return 1;
+    }
+    switch (hf_exec_post(hdl, argn, argv, NULL, 0)) {
+    case HF_EXEC_OK:
+        return 0;
+    case HF_EXEC_ERR_ARGC:
+        printf("%s: more than %d arguments\n", hdl->str, HF_EXEC_ARGS_MAX);
+        break;
+    case HF_EXEC_ERR_LINE:
+        printf("%s: arguments longer than %d characters\n", hdl->str, HF_EXEC_LINE_MAX);
+        break;
+    case HF_EXEC_ERR_BUSY:
+        printf("%s: busy, %d commands pending\n", hdl->str, HF_EXEC_QUEUE_LEN);
+        break;
+    }
+    return 1;
+}
+
+void hf_exec_dump(void)
+{
+    const hf_msg_hdl_t *tbl = hf_get_cmd_tbl();
+    size_t size = hf_get_cmd_tbl_size();
+    printf("%-26s %"PRIu32"\n", "cmd.rejected", s_exec_rejected);
+    for (size_t i = 0; i < size && i < HF_EXEC_CMD_MAX; i++) {
+        uint32_t total = 0;
+        for (int b = 0; b < HF_EXEC_HIST_BUCKETS; b++) {
+            total += s_exec_hist[i][b];
+        }
+        if (total == 0) {
+            continue;
+        }
+        printf("cmd.%-22s n=%"PRIu32" max=%"PRIu32" ms\n", tbl[i].str, total, s_exec_max_ms[i]);
+        for (int b = 0; b < HF_EXEC_HIST_BUCKETS; b++) {
+            if (s_exec_hist[i][b] == 0) {
+                continue;
+            }
+            uint32_t lo = (b == 0) ? 0 : (1u << (b - 1));
+            if (b == HF_EXEC_HIST_BUCKETS - 1) {
+                printf("    [%5"PRIu32", inf) ms %"PRIu32"\n", lo, s_exec_hist[i][b]);
+            } else {
+                printf("    [%5"PRIu32", %5"PRIu32") ms %"PRIu32"\n", lo, 1u << b, s_exec_hist[i][b]);
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __APP_HF_MSG_EXEC_H__
+#define __APP_HF_MSG_EXEC_H__
+
+#include <stdint.h>
+#include "app_hf_msg_set.h"
+
+/* pending console commands, a full queue rejects the command */
+#define HF_EXEC_QUEUE_LEN           (8)
+/* the arguments of a command are copied into one buffer of this size */
+#define HF_EXEC_LINE_MAX            (320)
+/* as many arguments as the console splits a line into (esp_console max_cmdline_args), more are rejected */
+#define HF_EXEC_ARGS_MAX            (32)
+/* commands with a latency histogram, the registry in app_hf_msg_set.c asserts it has no more */
+#define HF_EXEC_CMD_MAX             (32)
+/* command latency buckets are powers of two in ms: [0,1), [1,2), [2,4) ... [2^10, inf) */
+#define HF_EXEC_HIST_BUCKETS        (12)
+
+typedef enum {
+    HF_EXEC_OK = 0,
+    HF_EXEC_ERR_ARGC,               /*!< more than HF_EXEC_ARGS_MAX arguments */
+    HF_EXEC_ERR_LINE,               /*!< arguments longer than HF_EXEC_LINE_MAX altogether */
+    HF_EXEC_ERR_BUSY,               /*!< HF_EXEC_QUEUE_LEN commands pending */
+} hf_exec_err_t;
+
+/**
+ * @brief     called by the executor task when a posted command is done
+ *
+ * @param     ctx: the value given to hf_exec_post
+ * @param     ret: the handler return
+ */
+typedef void (* hf_exec_done_cb_t)(const hf_msg_hdl_t *hdl, uint32_t ctx, int ret);
+
+/**
+ * @brief     start the command executor task, called by register_hfp_ag
+ */
+void hf_exec_init(void);
+
+/**
+ * @brief     queue a copy of the arguments of a command for the executor, without printing
+ *
+ *            With a done callback the result is reported through it instead of the "done" line,
+ *            and the handler's stdout is discarded, so a caller that owns the UART (binmode) gets
+ *            no text in its stream. REPL task only, the copy is built in a static item.
+ */
+hf_exec_err_t hf_exec_post(const hf_msg_hdl_t *hdl, int argn, char **argv, hf_exec_done_cb_t done, uint32_t ctx);
+
+/**
+ * @brief     queue a command for the executor like a console command and wait until it has run;
+ *            waits for room in the queue, the handler output reaches the console. For the script
+ *            task, one caller at a time; from the executor task the handler is called directly.
+ *
+ * @param     ret: the handler return
+ *
+ * @return    HF_EXEC_OK once the handler has run, HF_EXEC_ERR_ARGC or HF_EXEC_ERR_LINE if the
+ *            arguments do not fit a queue item, HF_EXEC_ERR_BUSY before hf_exec_init
+ */
+hf_exec_err_t hf_exec_run(const hf_msg_hdl_t *hdl, int argn, char **argv, int *ret);
+
+/**
+ * @brief     console trampoline: look the command up by argv[0], queue a copy of the arguments
+ *            for the executor and return at once; completion is printed when the handler is done
+ *
+ * @return    0 if queued, 1 if the command is unknown, has too many or too long arguments, or
+ *            the queue is full
+ */
+int hf_exec_submit(int argn, char **argv);
+
+/**
+ * @brief     the executor's copy of the command it is running: `argn` arguments, each terminated
+ *            by '\0', one after the other
+ *
+ * @return    the first argument, or NULL if not called from a handler run by the executor
+ */
+const char *hf_exec_line(int *argn);
+
+/**
+ * @brief     print the per-command latency histograms (queue wait plus handler)
+ */
+void hf_exec_dump(void);
+
+#endif /* __APP_HF_MSG_EXEC_H__*/
@@ -21,9 +21,20 @@ Let's break down the main features of the file:
 3. hf_msg_parser_register_callback:
     - Registers a callback function that will be invoked once a valid message has been parsed.
 
-4. hf_msg_parse:
+4. hf_msg_parse_buf / hf_msg_parse:
+    - `hf_msg_parse_buf` takes a whole UART read. It finds the header start and the `;` terminator
+    with memchr and copies the payload in one go, delivers every complete message in the buffer
+    (pipelined commands), keeps a partial message for the next call, and reports the consumed
+    count, the number of messages and the first error with its offset in `hf_msg_prs_result_t`.
+    A message longer than HF_MSG_LEN_MAX is dropped up to its terminator: without a terminator in
+    the same buffer the parser stays in the discard state across calls (and across one byte calls),
+    so nothing inside the dropped message is taken for a header.
+    - `hf_msg_parse` is the per-character form, a one byte call of `hf_msg_parse_buf`.
+    - Unlike the old per-character parser, white space between messages is not reported as an
+    error, and a character that breaks the header is looked at again as a possible header start.
     - This function parses a single character `c` and advances the state of the parser according to the character.
-    - The parser operates in different states: Idle, Parsing the header, Parsing the payload.
+    - The parser operates in different states: Idle, Parsing the header, Parsing the payload,
+    Discarding an over-long payload.
     - Upon successful parsing of a message, the registered callback is invoked with the parsed message.
     - Errors can occur during parsing, like buffer overflow, header sync failure, and more. 
     These errors are returned as specific error codes.
@@ -36,7 +47,10 @@ Let's break down the main features of the file:
 6. hf_msg_args_parser:
     - Parses the arguments from the message buffer.
     - After splitting the message into individual arguments using `hf_msg_split_args`, 
-    it looks up the command (first argument) in a command table. If the command exists 
+    it looks up the command (first argument) in a command table, by name
+    (`hf_find_cmd`), or by opcode when the first argument is a number (`hf 150;`,
+    `hf_find_cmd_by_opcode`). A number with trailing characters ("5x") or past the command
+    opcodes ("70000") is no command. If the command exists 
     in the table and has an associated handler, the handler is called with the parsed arguments.
     - If a command is not supported, an "unsupported command" message is printed, and usage information is displayed.
 
@@ -48,7 +62,7 @@ This design allows for modularity and separation of concerns.
 - Command Processing: Commands and their handlers are separated, likely defined in a table in another file (`app_hf_msg_set.h`). 
 This design allows for easy addition and removal of supported commands.
 
-Overall, the code is designed for parsing and processing messages in a `hf ;` format. The messages are processed one character at a time, and once a full message is received, it's processed as a command with arguments.
+Overall, the code is designed for parsing and processing messages in a `hf ;` format. Messages are processed a buffer (or one character) at a time, and once a full message is received, it's processed as a command with arguments.
 */
 #include <ctype.h>
 #include <stdio.h>
@@ -58,6 +72,7 @@ Overall, the code is designed for parsing and processing messages in a `hf ;` fo
 #include <stdlib.h>
 #include "app_hf_msg_prs.h"
 #include "app_hf_msg_set.h"
+#include "app_hf_msg_bin.h"
 
 // according to the design, message header length shall be no less than 2.
 #define HF_MSG_HDR_LEN        (3)
@@ -80,64 +95,134 @@ void hf_msg_parser_register_callback(hf_msg_prs_cb_t *prs, hf_msg_callback cb)
     prs->callback = cb;
 }
 
-hf_msg_prs_err_t hf_msg_parse(char c, hf_msg_prs_cb_t *prs)
+// the payload scan looks for the terminator with memchr, which needs a single character tail
+_Static_assert(HF_MSG_TAIL_LEN == 1, "hf_msg_parse_buf expects a one character tail");
+
+// line breaks and blanks between pipelined messages are not an error
+static bool hf_msg_is_blank(const char *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (!isspace((int)p[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void hf_msg_prs_error(hf_msg_prs_result_t *res, hf_msg_prs_err_t err, size_t offset)
 {
-    hf_msg_prs_err_t err = HF_MSG_PRS_ERR_IN_PROGRESS;
-    switch (prs->state)
-    {
-        case HF_MSG_PRS_IDLE:
+    if (res->err == HF_MSG_PRS_ERR_OK) {
+        res->err = err;
+        res->err_offset = offset;
+    }
+    if (err == HF_MSG_PRS_ERR_BUF_OVERFLOW) {
+        res->overflows++;
+    } else {
+        res->hdr_errors++;
+    }
+}
+
+hf_msg_prs_err_t hf_msg_parse_buf(const char *buf, size_t len, hf_msg_prs_cb_t *prs, hf_msg_prs_result_t *res)
+{
+    hf_msg_prs_result_t local;
+    if (res == NULL) {
+        res = &local;
+    }
+    memset(res, 0, sizeof(hf_msg_prs_result_t));
+
+    size_t pos = 0;
+    while (pos < len) {
+        switch (prs->state)
         {
-            if (c == hf_msg_hdr[0]) {
+            case HF_MSG_PRS_IDLE:
+            {
+                const char *h = memchr(buf + pos, hf_msg_hdr[0], len - pos);
+                size_t gap = h ? (size_t)(h - (buf + pos)) : len - pos;
+                if (!hf_msg_is_blank(buf + pos, gap)) {
+                    hf_msg_prs_error(res, HF_MSG_PRS_ERR_HDR_UNDETECTED, pos);
+                }
+                if (h == NULL) {
+                    pos = len;
+                    break;
+                }
+                pos = h - buf + 1;
                 prs->state = HF_MSG_PRS_HDR;
-                prs->buf[0] = c;
+                prs->buf[0] = hf_msg_hdr[0];
                 prs->cnt = 1;
                 prs->h_idx = 1;
-            } else {
-                err = HF_MSG_PRS_ERR_HDR_UNDETECTED;
             }
-        }
-        break;
+            break;
 
-        case HF_MSG_PRS_HDR:
-        {
-            if (c == hf_msg_hdr[prs->h_idx]) {
-                prs->buf[prs->cnt++] = c;
-                if (++(prs->h_idx) == HF_MSG_HDR_LEN) {
-                    prs->state = HF_MSG_PRS_PAYL;
-                    prs->t_idx = 0;
+            case HF_MSG_PRS_HDR:
+            {
+                if (buf[pos] == hf_msg_hdr[prs->h_idx]) {
+                    prs->buf[prs->cnt++] = buf[pos++];
+                    if (++(prs->h_idx) == HF_MSG_HDR_LEN) {
+                        prs->state = HF_MSG_PRS_PAYL;
+                        prs->t_idx = 0;
+                    }
+                } else {
+                    // the mismatching character is looked at again as a possible header start
+                    hf_msg_parser_reset_state(prs);
+                    hf_msg_prs_error(res, HF_MSG_PRS_ERR_HDR_SYNC_FAILED, pos);
                 }
-            } else {
-                hf_msg_parser_reset_state(prs);
-                err = HF_MSG_PRS_ERR_HDR_SYNC_FAILED;
             }
-        }
-        break;
+            break;
 
-        case HF_MSG_PRS_PAYL:
-        {
-            prs->buf[prs->cnt++] = c;
-            if (c == hf_msg_tail[prs->t_idx]) {
-                if (++(prs->t_idx) == HF_MSG_TAIL_LEN) {
+            case HF_MSG_PRS_PAYL:
+            {
+                const char *t = memchr(buf + pos, hf_msg_tail[0], len - pos);
+                size_t chunk = t ? (size_t)(t - (buf + pos)) + 1 : len - pos;
+                if (prs->cnt + chunk > HF_MSG_LEN_MAX || (t == NULL && prs->cnt + chunk == HF_MSG_LEN_MAX)) {
+                    // drop the whole message, up to its terminator in this or a later buffer
+                    hf_msg_parser_reset_state(prs);
+                    hf_msg_prs_error(res, HF_MSG_PRS_ERR_BUF_OVERFLOW, pos);
+                    if (t == NULL) {
+                        prs->state = HF_MSG_PRS_DISCARD;
+                    }
+                    pos += chunk;
+                    break;
+                }
+                memcpy(prs->buf + prs->cnt, buf + pos, chunk);
+                prs->cnt += chunk;
+                pos += chunk;
+                if (t) {
                     prs->buf[prs->cnt] = '\0';
                     prs->callback(prs->buf, prs->cnt);
                     hf_msg_parser_reset_state(prs);
-                    err = HF_MSG_PRS_ERR_OK;
-                    break;
+                    res->msgs++;
                 }
-            } else {
-                prs->t_idx = 0;
             }
+            break;
 
-            if (prs->cnt >= HF_MSG_LEN_MAX) {
+            case HF_MSG_PRS_DISCARD:
+            {
+                const char *t = memchr(buf + pos, hf_msg_tail[0], len - pos);
+                if (t == NULL) {
+                    pos = len;
+                    break;
+                }
+                pos = t - buf + 1;
                 hf_msg_parser_reset_state(prs);
-                err = HF_MSG_PRS_ERR_BUF_OVERFLOW;
             }
+            break;
         }
-        break;
     }
-    return err;
+    res->consumed = pos;
+
+    if (res->err != HF_MSG_PRS_ERR_OK) {
+        return res->err;
+    }
+    if (prs->state != HF_MSG_PRS_IDLE || res->msgs == 0) {
+        return HF_MSG_PRS_ERR_IN_PROGRESS;
+    }
+    return HF_MSG_PRS_ERR_OK;
 }
 
+hf_msg_prs_err_t hf_msg_parse(char c, hf_msg_prs_cb_t *prs)
+{
+    return hf_msg_parse_buf(&c, 1, prs, NULL);
+}
 
 void hf_msg_split_args(char *start, char *end, char **argv, int *argn)
 {
@@ -192,17 +277,19 @@ void hf_msg_args_parser(char *buf, int len)
 
     bool cmd_supported = false;
 
-    hf_msg_hdl_t *cmd_tbl = hf_get_cmd_tbl();
-    size_t cmd_tbl_size = hf_get_cmd_tbl_size();
-    for (int i = 0; i < cmd_tbl_size; ++i) {
-        hf_msg_hdl_t *hdl = &cmd_tbl[i];
-        if (strcmp(argv[0], hdl->str) == 0) {
-            if (hdl->handler) {
-                hdl->handler(argn, argv);
-                cmd_supported = true;
-                break;
-            }
-        }
+    // "hf 150 p 500;" addresses a command by opcode, which skips the name lookup
+    const hf_msg_hdl_t *hdl;
+    if (isdigit((int)argv[0][0])) {
+        char *num_end;
+        unsigned long opcode = strtoul(argv[0], &num_end, 10);
+        // command opcodes are all below the binary protocol's; nothing is cut to 16 bits
+        hdl = (*num_end == '\0' && opcode < HF_BIN_OP_PING) ? hf_find_cmd_by_opcode((uint16_t)opcode) : NULL;
+    } else {
+        hdl = hf_find_cmd(argv[0]);
+    }
+    if (hdl && hdl->handler) {
+        hdl->handler(argn, argv);
+        cmd_supported = true;
     }
     if (!cmd_supported) {
         printf("unsupported command\n");
@@ -7,6 +7,8 @@
 #ifndef __APP_HF_MSG_PRS_H__
 #define __APP_HF_MSG_PRS_H__
 
+#include <stddef.h>
+
 typedef enum {
     HF_MSG_PRS_ERR_OK = 0,          // a complete message is finished
     HF_MSG_PRS_ERR_IN_PROGRESS,     // message parsing is in progress
@@ -19,6 +21,7 @@ typedef enum {
     HF_MSG_PRS_IDLE = 0,
     HF_MSG_PRS_HDR,
     HF_MSG_PRS_PAYL,
+    HF_MSG_PRS_DISCARD,             // rest of an over-long message, up to its terminator
 } hf_msg_prs_state_t;
 
 typedef void (*hf_msg_callback)(char *buf, int len);
@@ -38,6 +41,29 @@ void hf_msg_parser_reset_state(hf_msg_prs_cb_t *prs);
 
 void hf_msg_parser_register_callback(hf_msg_prs_cb_t *prs, hf_msg_callback cb);
 
+typedef struct {
+    size_t consumed;                // bytes of the buffer that were used
+    int msgs;                       // complete messages delivered to the callback
+    int hdr_errors;                 // bytes skipped looking for a header, header sync failures
+    int overflows;                  // messages dropped for exceeding HF_MSG_LEN_MAX
+    hf_msg_prs_err_t err;           // first error in the buffer, HF_MSG_PRS_ERR_OK if none
+    size_t err_offset;              // offset of the first error
+} hf_msg_prs_result_t;
+
+/**
+ * @brief     parse a buffer, calling the callback for each complete message; a partial message
+ *            is kept in prs for the next call
+ *
+ * @param     res: optional, filled with the consumed count, message count and errors
+ *
+ * @return    the first error, else HF_MSG_PRS_ERR_OK if the buffer ended on a message boundary
+ *            after at least one message, else HF_MSG_PRS_ERR_IN_PROGRESS
+ */
+hf_msg_prs_err_t hf_msg_parse_buf(const char *buf, size_t len, hf_msg_prs_cb_t *prs, hf_msg_prs_result_t *res);
+
+/**
+ * @brief     parse one character, same as hf_msg_parse_buf(&c, 1, prs, NULL)
+ */
 hf_msg_prs_err_t hf_msg_parse(char c, hf_msg_prs_cb_t *prs);
 
 void hf_msg_show_usage(void);
@@ -0,0 +1,404 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/*
+The `app_hf_msg_scr.c` file runs named command scripts, so a fixed bring-up sequence (connect, wait,
+audio, volumes, in-band ring) is one command instead of six typed by hand.
+
+1. Scripts:
+    - A script is a list of steps separated by `,`, each step is a console command with its
+    arguments, e.g. `con, wait slc_connected 5000, cona, wait audio_connected 2000, vu 0 12, vu 1 10, iron`.
+    - Two steps are built in: `wait <event> <timeout ms>` and `delay <ms>`. A wait without a timeout
+    is an error, so a script never blocks for good with the script slot taken.
+    - Scripts are stored as strings in NVS (namespace HF_SCR_NVS_NAMESPACE, key = script name). The
+    name of the boot script is stored under the key `.boot`; deleting the boot script clears it,
+    and `script boot` only takes a stored script.
+
+2. Event waits:
+    - `bt_app_hf_cb` posts connection and audio state changes with `hf_scr_post`. They are kept as
+    levels in an event group (connected clears disconnected and the other way round), so a wait
+    returns as soon as the state is reached, also when it was reached before the wait started.
+    - A wait that times out stops the script, as does an unknown command.
+
+3. Execution:
+    - A script runs in its own task, one at a time, and looks the commands up with `hf_find_cmd`, so
+    the console stays usable and a script runs exactly what a human would type.
+    - Each command step is queued to the command executor with `hf_exec_run` and the script waits
+    until it has run, so steps and typed commands run one at a time in the executor, in order.
+    - The start offset, duration and result of every step are kept for the last run and printed at
+    the end (and by `script report`), which shows where bring-up time goes.
+
+4. Boot:
+    - `hf_scr_init` starts the boot script once the stack reports HF_SCR_EVT_READY.
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "app_hf_msg_set.h"
+#include "app_hf_msg_scr.h"
+#include "app_hf_msg_exec.h"
+#include "bt_app_dlog.h"
+#include "bt_app_tasks.h"
+
+#define HF_SCR_TAG            "HF_SCR"
+#define HF_SCR_BOOT_KEY       ".boot"
+#define HF_SCR_STEP_SEP       ","
+#define HF_SCR_EVT_BIT(evt)   (1 << (evt))
+
+static const char *c_hf_scr_evt_str[HF_SCR_EVT_NUM] = {
+    "ready",
+    "slc_connected",
+    "slc_disconnected",
+    "audio_connected",
+    "audio_disconnected",
+};
+
+static EventGroupHandle_t s_scr_events = NULL;
+static volatile bool s_scr_running = false;
+static char s_scr_name[HF_SCR_NAME_MAX + 1];
+static char s_scr_text[HF_SCR_LEN_MAX + 1];
+static hf_scr_step_t s_scr_steps[HF_SCR_STEPS_MAX];
+static int s_scr_step_num;
+
+void hf_scr_post(hf_scr_evt_t evt)
+{
+    if (s_scr_events == NULL || evt >= HF_SCR_EVT_NUM) {
+        return;
+    }
+    EventBits_t clear = 0;
+    switch (evt) {
+    case HF_SCR_EVT_SLC_CONNECTED:
+        clear = HF_SCR_EVT_BIT(HF_SCR_EVT_SLC_DISCONNECTED);
+        break;
+    case HF_SCR_EVT_SLC_DISCONNECTED:
+        clear = HF_SCR_EVT_BIT(HF_SCR_EVT_SLC_CONNECTED) | HF_SCR_EVT_BIT(HF_SCR_EVT_AUDIO_CONNECTED);
+        break;
+    case HF_SCR_EVT_AUDIO_CONNECTED:
+        clear = HF_SCR_EVT_BIT(HF_SCR_EVT_AUDIO_DISCONNECTED);
+        break;
+    case HF_SCR_EVT_AUDIO_DISCONNECTED:
+        clear = HF_SCR_EVT_BIT(HF_SCR_EVT_AUDIO_CONNECTED);
+        break;
+    default:
+        break;
+    }
+    if (clear) {
+        xEventGroupClearBits(s_scr_events, clear);
+    }
+    xEventGroupSetBits(s_scr_events, HF_SCR_EVT_BIT(evt));
+}
+
+static int hf_scr_find_evt(const char *name)
+{
+    for (int i = 0; i < HF_SCR_EVT_NUM; i++) {
+        if (strcmp(name, c_hf_scr_evt_str[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool hf_scr_wait(hf_scr_evt_t evt, TickType_t ticks)
+{
+    EventBits_t bits = xEventGroupWaitBits(s_scr_events, HF_SCR_EVT_BIT(evt), pdFALSE, pdTRUE, ticks);
+    return (bits & HF_SCR_EVT_BIT(evt)) != 0;
+}
+
+// -1 if the step has more than HF_MSG_ARGS_MAX words
+static int hf_scr_split(char *step, char **argv)
+{
+    int argn = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(step, " \t", &save); tok; tok = strtok_r(NULL, " \t", &save)) {
+        if (argn == HF_MSG_ARGS_MAX) {
+            return -1;
+        }
+        argv[argn++] = tok;
+    }
+    return argn;
+}
+
+// a time in ms, all digits and at most HF_SCR_TIME_MAX_MS
+static bool hf_scr_parse_ms(const char *arg, uint32_t *ms)
+{
+    char *end;
+    unsigned long v = strtoul(arg, &end, 10);
+    if (arg[0] < '0' || arg[0] > '9' || *end != '\0' || v > HF_SCR_TIME_MAX_MS) {
+        return false;
+    }
+    *ms = v;
+    return true;
+}
+
+// a failed wait, a bad step or an unknown command sets abort, a handler error does not stop the script
+static int hf_scr_exec_step(char **argv, int argn, bool *abort)
+{
+    uint32_t ms;
+    *abort = true;
+    if (strcmp(argv[0], "wait") == 0) {
+        int evt = (argn >= 2) ? hf_scr_find_evt(argv[1]) : -1;
+        if (evt < 0) {
+            printf("script: unknown event \"%s\"\n", argn >= 2 ? argv[1] : "");
+            return -1;
+        }
+        if (argn != 3 || !hf_scr_parse_ms(argv[2], &ms)) {
+            printf("script: wait needs a timeout, 0 to %d ms\n", HF_SCR_TIME_MAX_MS);
+            return -1;
+        }
+        *abort = !hf_scr_wait(evt, pdMS_TO_TICKS(ms));
+        return *abort ? -1 : 0;
+    }
+    if (strcmp(argv[0], "delay") == 0) {
+        if (argn != 2 || !hf_scr_parse_ms(argv[1], &ms)) {
+            printf("script: delay needs a time, 0 to %d ms\n", HF_SCR_TIME_MAX_MS);
+            return -1;
+        }
+        vTaskDelay(pdMS_TO_TICKS(ms));
+        *abort = false;
+        return 0;
+    }
+    const hf_msg_hdl_t *hdl = hf_find_cmd(argv[0]);
+    if (hdl == NULL || hdl->handler == NULL) {
+        printf("script: unknown command \"%s\"\n", argv[0]);
+        return -1;
+    }
+    int ret;
+    if (hf_exec_run(hdl, argn, argv, &ret) != HF_EXEC_OK) {
+        printf("script: the executor does not take \"%s\"\n", argv[0]);
+        return -1;
+    }
+    *abort = false;
+    return ret;
+}
+
+static void hf_scr_report(void)
+{
+    printf("script %s, %d steps\n", s_scr_name, s_scr_step_num);
+    printf("  %-32s %8s %10s %6s\n", "step", "at ms", "took ms", "ret");
+    for (int i = 0; i < s_scr_step_num; i++) {
+        hf_scr_step_t *st = &s_scr_steps[i];
+        printf("  %-32s %8u %6u.%03u %6d\n", st->text, (unsigned int)st->start_ms,
+               (unsigned int)(st->dur_us / 1000), (unsigned int)(st->dur_us % 1000), st->result);
+    }
+}
+
+static void hf_scr_task(void *arg)
+{
+    bool boot = (arg != NULL);
+    if (boot && !hf_scr_wait(HF_SCR_EVT_READY, pdMS_TO_TICKS(HF_SCR_BOOT_READY_MS))) {
+        ESP_LOGE(HF_SCR_TAG, "boot script %s: stack not ready", s_scr_name);
+        goto done;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    char *save = NULL;
+    s_scr_step_num = 0;
+    for (char *step = strtok_r(s_scr_text, HF_SCR_STEP_SEP, &save); step; step = strtok_r(NULL, HF_SCR_STEP_SEP, &save)) {
+        char *argv[HF_MSG_ARGS_MAX];
+        while (*step == ' ') {
+            step++;
+        }
+        if (*step == '\0') {
+            continue;
+        }
+        if (s_scr_step_num == HF_SCR_STEPS_MAX) {
+            printf("script: more than %d steps, rest ignored\n", HF_SCR_STEPS_MAX);
+            break;
+        }
+        hf_scr_step_t *st = &s_scr_steps[s_scr_step_num++];
+        snprintf(st->text, sizeof(st->text), "%s", step);
+
+        bool abort;
+        int argn = hf_scr_split(step, argv);
+        if (argn < 0) {
+            printf("script: more than %d words in \"%s\"\n", HF_MSG_ARGS_MAX, st->text);
+            st->start_ms = 0;
+            st->dur_us = 0;
+            st->result = -1;
+            break;
+        }
+        int64_t start = esp_timer_get_time();
+        st->start_ms = (uint32_t)((start - t0) / 1000);
+        st->result = hf_scr_exec_step(argv, argn, &abort);
+        st->dur_us = (uint32_t)(esp_timer_get_time() - start);
+        if (abort) {
+            printf("script: stopped at \"%s\"\n", st->text);
+            break;
+        }
+    }
+    hf_scr_report();
+
+done:
+    s_scr_running = false;
+    bt_app_tasks_delete(NULL);
+}
+
+static esp_err_t hf_scr_load(const char *key, char *buf, size_t len)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(HF_SCR_NVS_NAMESPACE, NVS_READONLY, &h);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_get_str(h, key, buf, &len);
+    nvs_close(h);
+    return err;
+}
+
+static esp_err_t hf_scr_store(const char *key, const char *value)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(HF_SCR_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = value ? nvs_set_str(h, key, value) : nvs_erase_key(h, key);
+    if (err == ESP_OK) {
+        err = nvs_commit(h);
+    }
+    nvs_close(h);
+    return err;
+}
+
+static int hf_scr_start(const char *name, bool boot)
+{
+    if (s_scr_running) {
+        printf("script: %s is still running\n", s_scr_name);
+        return -1;
+    }
+    if (hf_scr_load(name, s_scr_text, sizeof(s_scr_text)) != ESP_OK) {
+        printf("script: no script \"%s\"\n", name);
+        return -1;
+    }
+    snprintf(s_scr_name, sizeof(s_scr_name), "%s", name);
+    s_scr_running = true;
+    if (bt_app_tasks_create(BT_APP_TASK_SCR, hf_scr_task, boot ? (void *)1 : NULL, NULL) != pdPASS) {
+        s_scr_running = false;
+        return -1;
+    }
+    return 0;
+}
+
+static void hf_scr_list(void)
+{
+    char boot[HF_SCR_NAME_MAX + 1] = "";
+    hf_scr_load(HF_SCR_BOOT_KEY, boot, sizeof(boot));
+
+    char text[HF_SCR_LEN_MAX + 1];
+    nvs_iterator_t it = NULL;
+    esp_err_t err = nvs_entry_find(NVS_DEFAULT_PART_NAME, HF_SCR_NVS_NAMESPACE, NVS_TYPE_STR, &it);
+    while (err == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        if (strcmp(info.key, HF_SCR_BOOT_KEY) != 0 && hf_scr_load(info.key, text, sizeof(text)) == ESP_OK) {
+            printf("%s%s: %s\n", info.key, strcmp(info.key, boot) == 0 ? " (boot)" : "", text);
+        }
+        err = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+}
+
+int hf_scr_cmd(int argn, char **argv)
+{
+    if (argn < 2) {
+        printf("script add <name> <step, step, ...> | del <name> | list | run <name> | boot <name|off> | report\n");
+        return -1;
+    }
+    const char *op = argv[1];
+    const char *name = (argn >= 3) ? argv[2] : NULL;
+
+    if (strcmp(op, "list") == 0) {
+        hf_scr_list();
+        return 0;
+    }
+    if (strcmp(op, "report") == 0) {
+        hf_scr_report();
+        return 0;
+    }
+    if (name == NULL || strlen(name) > HF_SCR_NAME_MAX || name[0] == '.') {
+        printf("script: missing or bad name (max %d characters)\n", HF_SCR_NAME_MAX);
+        return -1;
+    }
+
+    if (strcmp(op, "add") == 0) {
+        // the console splits on blanks, join the rest back into one script; from the console the
+        // executor's copy of the whole line is used, so no argv limit can cut steps off
+        char text[HF_SCR_LEN_MAX + 1] = "";
+        size_t len = 0;
+        int line_argn = 0;
+        const char *arg = hf_exec_line(&line_argn);
+        if (arg == NULL || line_argn != argn) {
+            arg = NULL;
+        }
+        for (int i = 0; i < argn; i++) {
+            const char *a = arg ? arg : argv[i];
+            if (arg) {
+                arg += strlen(arg) + 1;
+            }
+            if (i < 3) {
+                continue;
+            }
+            int n = snprintf(text + len, sizeof(text) - len, "%s%s", i > 3 ? " " : "", a);
+            if (n < 0 || len + n >= sizeof(text)) {
+                printf("script: longer than %d characters\n", HF_SCR_LEN_MAX);
+                return -1;
+            }
+            len += n;
+        }
+        return (hf_scr_store(name, text) == ESP_OK) ? 0 : -1;
+    }
+    if (strcmp(op, "del") == 0) {
+        char boot[HF_SCR_NAME_MAX + 1];
+        if (hf_scr_store(name, NULL) != ESP_OK) {
+            return -1;
+        }
+        // no boot key naming a script that is gone
+        if (hf_scr_load(HF_SCR_BOOT_KEY, boot, sizeof(boot)) == ESP_OK && strcmp(boot, name) == 0) {
+            return (hf_scr_store(HF_SCR_BOOT_KEY, NULL) == ESP_OK) ? 0 : -1;
+        }
+        return 0;
+    }
+    if (strcmp(op, "run") == 0) {
+        return hf_scr_start(name, false);
+    }
+    if (strcmp(op, "boot") == 0) {
+        char text[HF_SCR_LEN_MAX + 1];
+        if (strcmp(name, "off") == 0) {
+            esp_err_t err = hf_scr_store(HF_SCR_BOOT_KEY, NULL);
+            return (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) ? 0 : -1;
+        }
+        if (hf_scr_load(name, text, sizeof(text)) != ESP_OK) {
+            printf("script: no script \"%s\"\n", name);
+            return -1;
+        }
+        return (hf_scr_store(HF_SCR_BOOT_KEY, name) == ESP_OK) ? 0 : -1;
+    }
+    printf("script: unknown operation \"%s\"\n", op);
+    return -1;
+}
+
+void hf_scr_init(void)
+{
+    if (s_scr_events) {
+        return;
+    }
+    s_scr_events = xEventGroupCreate();
+    xEventGroupSetBits(s_scr_events, HF_SCR_EVT_BIT(HF_SCR_EVT_SLC_DISCONNECTED) |
+                       HF_SCR_EVT_BIT(HF_SCR_EVT_AUDIO_DISCONNECTED));
+
+    char boot[HF_SCR_NAME_MAX + 1];
+    if (hf_scr_load(HF_SCR_BOOT_KEY, boot, sizeof(boot)) == ESP_OK) {
+        ESP_LOGI(HF_SCR_TAG, "boot script %s", boot);
+        hf_scr_start(boot, true);
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __APP_HF_MSG_SCR_H__
+#define __APP_HF_MSG_SCR_H__
+
+#include <stdint.h>
+
+#define HF_SCR_NVS_NAMESPACE        "hf_scr"
+/* NVS keys are at most 15 characters, script names share the limit */
+#define HF_SCR_NAME_MAX             (15)
+#define HF_SCR_LEN_MAX              (256)
+#define HF_SCR_STEPS_MAX            (16)
+#define HF_SCR_STEP_TEXT_MAX        (32)
+/* longest wait timeout and delay a step takes */
+#define HF_SCR_TIME_MAX_MS          (600000)
+/* how long a boot script waits for the stack to come up */
+#define HF_SCR_BOOT_READY_MS        (10000)
+
+/* state levels a script can wait for, set from the HFP callback */
+typedef enum {
+    HF_SCR_EVT_READY = 0,           // HFP AG registered, commands can be issued
+    HF_SCR_EVT_SLC_CONNECTED,
+    HF_SCR_EVT_SLC_DISCONNECTED,
+    HF_SCR_EVT_AUDIO_CONNECTED,
+    HF_SCR_EVT_AUDIO_DISCONNECTED,
+    HF_SCR_EVT_NUM,
+} hf_scr_evt_t;
+
+typedef struct {
+    char text[HF_SCR_STEP_TEXT_MAX];
+    uint32_t start_ms;              // from the start of the script
+    uint32_t dur_us;
+    int result;                     // handler return, -1 for a wait timeout or an unknown command
+} hf_scr_step_t;
+
+/**
+ * @brief     create the event group and start the boot script, if one is set
+ */
+void hf_scr_init(void);
+
+/**
+ * @brief     record a state change; connected and disconnected levels of a link clear each other
+ */
+void hf_scr_post(hf_scr_evt_t evt);
+
+/**
+ * @brief     the `script` console command: add, del, list, run, boot, report
+ */
+int hf_scr_cmd(int argn, char **argv);
+
+#endif /* __APP_HF_MSG_SCR_H__*/
@@ -22,37 +22,47 @@ Key Features:
 3. Message and Command Handlers:
    - The module contains handlers for various HFP AG commands. Handlers are functions that execute specific tasks when a corresponding command is received. These include tasks like connecting and disconnecting, audio management, voice recognition control, volume adjustments, and more.
    
-4. Command Usage Manual:
-   - `hf_msg_show_usage()`: This function prints a list of supported commands with their respective explanations, providing a manual for users on how to use these commands.
+4. Command Registry:
+   - `HF_CMD_REGISTRY` lists every command once: name, opcode, handler, how the console runs it, an argument synopsis and the help text. Everything else is generated from it at compile time. `HF_CMD_BY_NAME` lists the names once more in strcmp order for `hf_find_cmd`; the preprocessor cannot sort, so that order is kept by hand and checked by the compiler.
+   - Duplicate names, duplicate opcodes, a handler used twice, an opcode taken by the binary protocol, a missing help text, or a name missing from or out of order in `HF_CMD_BY_NAME` stop the build.
    
 5. Custom Modifications:
    - Comments indicate that modifications have been made by a user named "PHIL". For instance, after establishing a connection, the audio connection is automatically set up.
 
-6. Console Command Registrations:
-   - The module uses the ESP32's `esp_console` to register HFP AG commands. Each command has associated explanations and arguments (if any). Examples of commands are "connect", "disconnect", "volume update", "start voice recognition", etc.
+6. Command Tables:
+   - `hf_cmd_tbl`: It's a table mapping command strings to their respective handlers, in flash. `hf_find_cmd` looks a command up by name with a binary search over the constant index generated from `HF_CMD_BY_NAME`, `hf_find_cmd_by_opcode` by opcode through a generated switch.
    
-7. Command Tables:
-   - `hf_cmd_tbl`: It's a table mapping command strings to their respective handlers. This table is used to quickly lookup and execute the appropriate action when a command is received.
-   
-8. Command Explanation:
-   - `hf_cmd_explain`: An array providing explanations for various HFP AG commands, making it easier to understand each command's purpose.
-
-9. Argument Parsing:
-   - Several structs (e.g., `vu_args_t`, `ind_args_t`, `ate_args_t`) are defined to help parse command arguments using the `argtable3` library. This makes it simpler to retrieve and validate arguments from user input.
+7. Command Usage Manual:
+   - `hf_msg_show_usage()`: This function prints a list of supported commands with their arguments and explanations, providing a manual for users on how to use these commands.
 
-10. Console Command Registration:
-   - The `register_hfp_ag()` function is used to register the available HFP AG commands with the ESP32's console. This function is pivotal in enabling user interactions with the system via a console interface.
+8. Console Command Registration:
+   - The `register_hfp_ag()` function registers the generated `esp_console_cmd_t` entries with the ESP32's console. The argument synopsis is the console hint and the argument details are part of the help text, so no argtables are allocated.
 
 In essence, this module provides the command interface and handlers for the HFP AG functionalities on an ESP32 platform, allowing users to control and manage Bluetooth Hands-Free operations through textual commands.
 */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
+#include <inttypes.h>
 #include "esp_hf_ag_api.h"
 #include "app_hf_msg_set.h"
+#include "app_hf_msg_bin.h"
+#include "app_hf_msg_scr.h"
+#include "app_hf_msg_exec.h"
 #include "bt_app_hf.h"
+#include "bt_app_call.h"
+#include "bt_app_floor.h"
+#include "bt_app_gain.h"
+#include "bt_app_ind.h"
+#include "bt_app_link.h"
+#include "bt_app_mem.h"
+#include "bt_app_metrics.h"
+#include "bt_app_tasks.h"
+#include "bt_app_dlog.h"
+#include "bt_app_trace.h"
 #include "esp_console.h"
-#include "argtable3/argtable3.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 
@@ -80,41 +90,97 @@ void print_mac_address_and_role(esp_bd_addr_t addr) {
     printf("MAC Address: %s, Role: %s\n", addr_str, role_str);
 }
 
-void hf_msg_show_usage(void)
-{
-    printf("########################################################################\n");
-    printf("HFP AG command usage manual\n");
-    printf("HFP AG commands begins with \"hf\" and end with \";\"\n");
-    printf("Supported commands are as follows, arguments are embraced with < and >\n\n");
-    printf("hf con;                   -- set up connection with peer device\n");
-    printf("hf dis;                   -- disconnection with peer device\n");
-    printf("hf cona;                  -- set up audio connection with peer device\n");
-    printf("hf disa;                  -- release audio connection with peer device\n");
-    printf("hf vron;                  -- start voice recognition\n");
-    printf("hf vroff;                 -- stop voice recognition\n");
-    printf("hf vu <tgt> <vol>;        -- volume update\n");
-    printf("     tgt: 0-speaker, 1-microphone\n");
-    printf("     vol: volume gain ranges from 0 to 15\n");
-    printf("hf ind <call> <ntk> <callsetup> <sig>;       -- unsolicited indication device status to HF Client\n");
-    printf("     call: call status [0,1]\n");
-    printf("     callsetup: call setup status [0,3]\n");
-    printf("     ntk: network status [0,1]\n");
-    printf("     sig: signal strength value from 0~5\n");
-    printf("hf ate <rep> <err>;       -- send extended at error code\n");
-    printf("     rep: response code from 0 to 7\n");
-    printf("     err: error code from 0 to 32\n");
-    printf("hf iron;                  -- in-band ring tone provided\n");
-    printf("hf iroff;                 -- in-band ring tone not provided\n");
-    printf("hf ac;                    -- Answer Incoming Call from AG\n");
-    printf("hf rc;                    -- Reject Incoming Call from AG\n");
-    printf("hf d <num>;               -- Dial Number by AG, e.g. hf d 11223344\n");
-    printf("hf end;                   -- End up a call by AG\n");
-    printf("hf h;                     -- to see the command for HFP AG\n");
-    printf("########################################################################\n");
-}
+/*
+ * The command registry. Every hf command is one line here. The parser table, the opcode and name
+ * lookups, the usage manual, the console help and the console registration are generated from it.
+ *
+ * X(name, opcode, handler, run, args, text)
+ *   name     command word, "hf <name>;" and the console command
+ *   opcode   "hf <opcode>;", binary protocol opcode and trace id, unique and below HF_BIN_OP_PING
+ *   handler  HF_CMD_HANDLER(<handler>) below
+ *   run      console: QUEUED on the executor task, DIRECT in the REPL task, NONE not registered
+ *   args     argument synopsis, "" for none
+ *   text     one line of help, argument details follow on lines indented by five spaces
+ */
+#define HF_CMD_REGISTRY(X)                                                                              \
+    X(h,       0,   help,           NONE,   "",                     "to see the command for HFP AG")     \
+    X(con,     5,   conn,           QUEUED, "",                     "set up connection with peer device") \
+    X(dis,     10,  disc,           QUEUED, "",                     "disconnection with peer device")   \
+    X(cona,    20,  conn_audio,     QUEUED, "",                     "set up audio connection with peer device") \
+    X(disa,    30,  disc_audio,     QUEUED, "",                     "release audio connection with peer device") \
+    X(vu,      40,  volume_control, QUEUED, "<tgt> <vol> | agc [on | off]", "volume update\n"            \
+                                                                    "     tgt: 0-speaker, 1-microphone\n" \
+                                                                    "     vol: volume gain ranges from 0 to 15\n" \
+                                                                    "     agc: automatic gain control of the audio sent to the HF") \
+    X(ind,     50,  ind_change,     QUEUED, "[<call> <callsetup> <ntk> <sig>]",                         \
+                                                                    "unsolicited indication device status to HF Client, only changes are sent\n" \
+                                                                    "     call: call status [0,1]\n"    \
+                                                                    "     callsetup: call setup status [0,3]\n" \
+                                                                    "     ntk: network status [0,1]\n"  \
+                                                                    "     sig: signal strength value from 0~5\n" \
+                                                                    "     <name> <value>: set one indicator, e.g. ind battchg 2\n" \
+                                                                    "     no arguments: show the indicators and what each peer was told") \
+    X(vron,    60,  vra_on,         QUEUED, "",                     "start voice recognition")          \
+    X(vroff,   70,  vra_off,        QUEUED, "",                     "stop voice recognition")           \
+    X(ate,     80,  cme_err,        QUEUED, "<rep> <err>",          "send extended at error code\n"     \
+                                                                    "     rep: response code from 0 to 7\n" \
+                                                                    "     err: error code from 0 to 32") \
+    X(iron,    90,  ir_on,          QUEUED, "",                     "in-band ring tone provided")       \
+    X(iroff,   100, ir_off,         QUEUED, "",                     "in-band ring tone not provided")   \
+    X(ac,      110, ac,             QUEUED, "",                     "Answer Incoming Call (or the dialed party answers)") \
+    X(rc,      120, rc,             QUEUED, "",                     "Reject Incoming Call from AG")     \
+    X(end,     130, end,            QUEUED, "",                     "End up a call by AG")              \
+    X(d,       140, d,              QUEUED, "<num>",                "Dial Number by AG, e.g. hf d 11223344") \
+    X(stats,   150, stats,          QUEUED, "[b | p <ms>]",         "eSCO link statistics\n"            \
+                                                                    "     b: compact binary dump as hex\n" \
+                                                                    "     p: set the packet statistics poll period in ms") \
+    X(metrics, 160, metrics,        QUEUED, "[reset]",              "show (or reset) the hot-path metrics") \
+    X(dlog,    170, dlog,           QUEUED, "[raw | text]",         "deferred log output mode, raw is decoded by tools/dlog_decode.py") \
+    X(trace,   180, trace,          QUEUED, "[on | off | clear]",   "dump (or control) the event trace, see tools/trace_to_chrome.py") \
+    X(binmode, 190, binmode,        DIRECT, "",                     "binary framed protocol on this UART, see tools/hf_bin_client.py") \
+    X(script,  200, script,         QUEUED, "<op> [<name>] [<steps>]", "command scripts stored in NVS\n" \
+                                                                    "     add <name> <step, step, ...>: e.g. script add up con, wait slc_connected 5000, cona\n" \
+                                                                    "     del <name> | list | run <name> | boot <name|off> | report\n" \
+                                                                    "     steps: any command, wait <event> <ms>, delay <ms>") \
+    X(call,    210, call,           QUEUED, "[ring [<num>] | alert | hold | resume]", "call state, or drive it\n" \
+                                                                    "     ring: a call comes in, alert: the dialed party rings\n" \
+                                                                    "     hold, resume: put the active call on hold and back") \
+    X(floor,   220, floor,          QUEUED, "[take | release | half | full]", "push-to-talk floor, or drive it\n" \
+                                                                    "     take, release: the button, for the connected peer\n" \
+                                                                    "     half: only the talker's direction runs, full: both always run") \
+    X(tasks,   230, tasks,          QUEUED, "",                     "application tasks: core, priority, stack headroom, CPU since last time") \
+    X(mem,     250, mem,            QUEUED, "",                     "task stack headroom, heap and allocations per subsystem")
+
+// table index of each command, a duplicate name fails here
+#define HF_CMD_IDX_ENUM(name, opcode, handler, run, args, text)     HF_CMD_IDX_##name,
+enum {
+    HF_CMD_REGISTRY(HF_CMD_IDX_ENUM)
+    HF_CMD_NUM
+};
 
+// opcode of each handler for the trace, a handler used by two commands fails here
+#define HF_CMD_OP_ENUM(name, opcode, handler, run, args, text)      HF_CMD_OP_##handler = (opcode),
+enum {
+    HF_CMD_REGISTRY(HF_CMD_OP_ENUM)
+};
 
-#define HF_CMD_HANDLER(cmd)    static int hf_##cmd##_handler(int argn, char **argv)
+#define HF_CMD_CHECK(name, opcode, handler, run, args, text)                                      \
+    _Static_assert((opcode) < HF_BIN_OP_PING, "hf " #name ": opcode taken by the binary protocol"); \
+    _Static_assert(sizeof(text) > 1, "hf " #name ": no help text");
+HF_CMD_REGISTRY(HF_CMD_CHECK)
+_Static_assert(HF_CMD_NUM <= HF_EXEC_CMD_MAX, "the executor keeps latency histograms for HF_EXEC_CMD_MAX commands");
+
+// every handler is wrapped so the console commands show up on the trace timeline by opcode
+#define HF_CMD_HANDLER(cmd)                                                 \
+    static int hf_##cmd##_handler_body(int argn, char **argv);             \
+    static int hf_##cmd##_handler(int argn, char **argv)                    \
+    {                                                                       \
+        BT_APP_TRACE_BEGIN(CMD, HF_CMD_OP_##cmd, argn);                     \
+        int ret = hf_##cmd##_handler_body(argn, argv);                      \
+        BT_APP_TRACE_END(CMD, HF_CMD_OP_##cmd, ret);                        \
+        return ret;                                                         \
+    }                                                                       \
+    static int hf_##cmd##_handler_body(int argn, char **argv)
 
 HF_CMD_HANDLER(help)
 {
@@ -180,6 +246,20 @@ HF_CMD_HANDLER(vra_off)
 //AT+VGS or AT+VGM
 HF_CMD_HANDLER(volume_control)
 {
+    if (argn >= 2 && strcmp(argv[1], "agc") == 0) {
+        if (argn == 3 && (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+            bt_app_gain_agc_enable(BT_APP_GAIN_PATH_OUTGOING, strcmp(argv[2], "on") == 0);
+        } else if (argn != 2) {
+            printf("Invalid argument for agc %s\n", argv[2]);
+            return 1;
+        }
+#if BT_APP_GAIN_AGC_ENABLE
+        printf("AGC %s\n", bt_app_gain_agc_enabled(BT_APP_GAIN_PATH_OUTGOING) ? "on" : "off");
+#else
+        printf("AGC not built, see BT_APP_GAIN_AGC_ENABLE\n");
+#endif
+        return 0;
+    }
     if (argn != 3) {
         printf("Insufficient number of arguments");
         print_mac_address_and_role(hf_peer_addr);
@@ -207,12 +287,30 @@ HF_CMD_HANDLER(volume_control)
     print_mac_address_and_role(hf_peer_addr);
 
     esp_hf_ag_volume_control(hf_peer_addr, target, volume);
+    bt_app_gain_set_level((target == ESP_HF_VOLUME_CONTROL_TARGET_SPK) ? BT_APP_GAIN_PATH_OUTGOING : BT_APP_GAIN_PATH_INCOMING, volume);
     return 0;
 }
 
 //+CIEV
 HF_CMD_HANDLER(ind_change)
 {
+    if (argn == 1) {
+        bt_app_ind_dump();
+        return 0;
+    }
+    if (argn == 3) {
+        int value;
+        bt_app_ind_t ind = bt_app_ind_find(argv[1]);
+        if (ind == BT_APP_IND_NUM) {
+            printf("Invalid indicator %s\n", argv[1]);
+            return 1;
+        }
+        if (sscanf(argv[2], "%d", &value) != 1 || !bt_app_ind_set(ind, value)) {
+            printf("Invalid argument for %s %s\n", argv[1], argv[2]);
+            return 1;
+        }
+        return 0;
+    }
     print_mac_address_and_role(hf_peer_addr);
     if (argn != 5) {
         printf("Insufficient number of arguments");
@@ -247,12 +345,11 @@ HF_CMD_HANDLER(ind_change)
         return 1;
     }
     printf("Device Indicator Changed!\n");
-    // esp_hf_ag_devices_status_indchange(hf_peer_addr, call_state, call_setup_state, ntk_state, signal);  //deprecated
-    esp_hf_ag_ciev_report(hf_peer_addr, ESP_HF_IND_TYPE_CALL, call_state);
-    esp_hf_ag_ciev_report(hf_peer_addr, ESP_HF_IND_TYPE_CALLSETUP, call_setup_state);
-    esp_hf_ag_ciev_report(hf_peer_addr, ESP_HF_IND_TYPE_SERVICE, ntk_state);
-    esp_hf_ag_ciev_report(hf_peer_addr, ESP_HF_IND_TYPE_SIGNAL, signal);
-    // esp_hf_ag_ciev_report(param->ind_upd.remote_addr, ESP_HF_IND_TYPE_BATTCHG, battery);
+    // only the indicators that differ from what each peer was told are sent as +CIEV
+    bt_app_ind_set(BT_APP_IND_CALL, call_state);
+    bt_app_ind_set(BT_APP_IND_CALLSETUP, call_setup_state);
+    bt_app_ind_set(BT_APP_IND_SERVICE, ntk_state);
+    bt_app_ind_set(BT_APP_IND_SIGNAL, signal);
 
     return 0;
 }
@@ -309,19 +406,21 @@ HF_CMD_HANDLER(ac)
 {
     printf("Answer Call from AG.\n");
     print_mac_address_and_role(hf_peer_addr);
-    char *number = {"123456"};
-    esp_hf_ag_answer_call(hf_peer_addr,1,0,1,1,number,0);
-    return 0;
+    return bt_app_call_event(hf_peer_addr, BT_APP_CALL_EVT_ANSWER, NULL) ? 0 : 1;
 }
 
 //Reject Call from AG
 HF_CMD_HANDLER(rc)
 {
+    bt_app_call_info_t info;
     printf("Reject Call from AG.\n");
     print_mac_address_and_role(hf_peer_addr);
-    char *number = {"123456"};
-    esp_hf_ag_reject_call(hf_peer_addr,0,0,0,0,number,0);
-    return 0;
+    bt_app_call_get_info(&info);
+    if (info.state != BT_APP_CALL_INCOMING) {
+        printf("No incoming call\n");
+        return 1;
+    }
+    return bt_app_call_event(hf_peer_addr, BT_APP_CALL_EVT_END, NULL) ? 0 : 1;
 }
 
 //End Call from AG
@@ -329,9 +428,7 @@ HF_CMD_HANDLER(end)
 {
     printf("End Call from AG.\n");
     print_mac_address_and_role(hf_peer_addr);
-    char *number = {"123456"};
-    esp_hf_ag_end_call(hf_peer_addr,0,0,0,0,number,0);
-    return 0;
+    return bt_app_call_event(hf_peer_addr, BT_APP_CALL_EVT_END, NULL) ? 0 : 1;
 }
 
 //Dial Call from AG
@@ -340,241 +437,325 @@ HF_CMD_HANDLER(d)
     print_mac_address_and_role(hf_peer_addr);
     if (argn != 2) {
         printf("Insufficient number of arguments");
+        return 1;
+    }
+    printf("Dial number %s\n", argv[1]);
+    return bt_app_call_event(hf_peer_addr, BT_APP_CALL_EVT_DIAL, argv[1]) ? 0 : 1;
+}
+
+//Link quality
+HF_CMD_HANDLER(stats)
+{
+    if (argn >= 2 && strcmp(argv[1], "b") == 0) {
+        uint8_t buf[64];
+        size_t len = bt_app_link_dump(buf, sizeof(buf));
+        for (size_t i = 0; i < len; i++) {
+            printf("%02x", buf[i]);
+        }
+        printf("\n");
+        return 0;
+    }
+    if (argn >= 2 && strcmp(argv[1], "p") == 0) {
+        int period_ms;
+        if (argn != 3 || sscanf(argv[2], "%d", &period_ms) != 1 || period_ms <= 0) {
+            printf("Invalid argument for period\n");
+            return 1;
+        }
+        bt_app_link_set_period(period_ms);
+        return 0;
+    }
+
+    bt_app_link_stats_t st;
+    bt_app_link_get_stats(&st);
+    printf("link %s, %"PRIu32" polls, window %"PRIu32" ms\n", st.active ? "active" : "idle", st.polls, st.window_ms);
+    printf("  rx total %"PRIu32", ok %"PRIu32", crc err %"PRIu32", none %"PRIu32", lost %"PRIu32"\n",
+           st.delta.rx_total, st.delta.rx_correct, st.delta.rx_err, st.delta.rx_none, st.delta.rx_lost);
+    printf("  tx total %"PRIu32", discarded %"PRIu32"\n", st.delta.tx_total, st.delta.tx_discarded);
+    printf("  loss %"PRIu32".%"PRIu32"%%, throughput %"PRIu32" bit/s, goodput %"PRIu32" bit/s\n",
+           st.loss_permille / 10, st.loss_permille % 10, st.throughput_bps, st.goodput_bps);
+    return 0;
+}
+
+//Hot-path metrics
+HF_CMD_HANDLER(metrics)
+{
+    if (argn >= 2 && strcmp(argv[1], "reset") == 0) {
+        bt_app_metrics_reset();
+        return 0;
+    }
+    bt_app_metrics_dump();
+    hf_exec_dump();
+    return 0;
+}
+
+//Deferred log output mode
+HF_CMD_HANDLER(dlog)
+{
+    if (argn >= 2 && strcmp(argv[1], "raw") == 0) {
+        bt_app_dlog_set_raw(true);
+    } else if (argn >= 2 && strcmp(argv[1], "text") == 0) {
+        bt_app_dlog_set_raw(false);
+    }
+    printf("dlog dropped %"PRIu32"\n", bt_app_dlog_dropped());
+    return 0;
+}
+
+//Event trace
+HF_CMD_HANDLER(trace)
+{
+    if (argn >= 2 && strcmp(argv[1], "on") == 0) {
+        bt_app_trace_enable(true);
+    } else if (argn >= 2 && strcmp(argv[1], "off") == 0) {
+        bt_app_trace_enable(false);
+    } else if (argn >= 2 && strcmp(argv[1], "clear") == 0) {
+        bt_app_trace_clear();
     } else {
-        printf("Dial number %s\n", argv[1]);
-        esp_hf_ag_out_call(hf_peer_addr,1,0,1,2,argv[1],0);
+        bt_app_trace_dump();
     }
     return 0;
 }
 
-static hf_msg_hdl_t hf_cmd_tbl[] = {
-    {0,    "h",            hf_help_handler},
-    {5,    "con",          hf_conn_handler},
-    {10,   "dis",          hf_disc_handler},
-    {20,   "cona",         hf_conn_audio_handler},
-    {30,   "disa",         hf_disc_audio_handler},
-    {40,   "vu",           hf_volume_control_handler},
-    {50,   "ind",          hf_ind_change_handler},
-    {60,   "vron",         hf_vra_on_handler},
-    {70,   "vroff",        hf_vra_off_handler},
-    {80,   "ate",          hf_cme_err_handler},
-    {90,   "iron",         hf_ir_on_handler},
-    {100,  "iroff",        hf_ir_off_handler},
-    {110,  "ac",           hf_ac_handler},
-    {120,  "rc",           hf_rc_handler},
-    {130,  "end",          hf_end_handler},
-    {140,  "d",            hf_d_handler},
+//Binary framed protocol
+HF_CMD_HANDLER(binmode)
+{
+    hf_bin_run();
+    return 0;
+}
+
+//Command scripts
+HF_CMD_HANDLER(script)
+{
+    return hf_scr_cmd(argn, argv);
+}
+
+//Call state
+HF_CMD_HANDLER(call)
+{
+    static const struct {
+        const char *op;
+        bt_app_call_evt_t evt;
+    } ops[] = {
+        {"ring",   BT_APP_CALL_EVT_RING},
+        {"alert",  BT_APP_CALL_EVT_ALERT},
+        {"hold",   BT_APP_CALL_EVT_HOLD},
+        {"resume", BT_APP_CALL_EVT_RESUME},
+    };
+    if (argn >= 2) {
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+            if (strcmp(argv[1], ops[i].op) == 0) {
+                return bt_app_call_event(hf_peer_addr, ops[i].evt, (argn >= 3) ? argv[2] : NULL) ? 0 : 1;
+            }
+        }
+        printf("Invalid argument %s\n", argv[1]);
+        return 1;
+    }
+
+    bt_app_call_info_t info;
+    bt_app_call_get_info(&info);
+    printf("call %s", bt_app_call_state_str(info.state));
+    if (info.state != BT_APP_CALL_IDLE) {
+        printf(", %s %s", info.outgoing ? "to" : "from", info.number);
+    }
+    printf("\n  %"PRIu32" calls, %"PRIu32" rejected events, time-to-talk last %"PRIu32" ms, max %"PRIu32" ms\n",
+           info.calls, info.rejected, info.talk_ms_last, info.talk_ms_max);
+    return 0;
+}
+
+HF_CMD_HANDLER(floor)
+{
+    if (argn >= 2) {
+        if (strcmp(argv[1], "take") == 0) {
+            if (!bt_app_floor_request(hf_peer_addr)) {
+                printf("floor busy\n");
+                return 1;
+            }
+        } else if (strcmp(argv[1], "release") == 0) {
+            bt_app_floor_release(hf_peer_addr);
+        } else if (strcmp(argv[1], "half") == 0) {
+            bt_app_floor_set_mode(BT_APP_FLOOR_HALF_DUPLEX);
+        } else if (strcmp(argv[1], "full") == 0) {
+            bt_app_floor_set_mode(BT_APP_FLOOR_FULL_DUPLEX);
+        } else {
+            printf("Invalid argument %s\n", argv[1]);
+            return 1;
+        }
+        return 0;
+    }
+
+    bt_app_floor_stats_t st;
+    bt_app_floor_get_stats(&st);
+    printf("floor %s, %s", (st.mode == BT_APP_FLOOR_HALF_DUPLEX) ? "half duplex" : "full duplex", st.held ? "held by " : "free");
+    if (st.held) {
+        printf("%02x:%02x:%02x:%02x:%02x:%02x", st.holder[0], st.holder[1], st.holder[2],
+               st.holder[3], st.holder[4], st.holder[5]);
+    }
+    printf("\n  %"PRIu32" requests, %"PRIu32" grants, %"PRIu32" collisions, %"PRIu32" releases\n",
+           st.requests, st.grants, st.collisions, st.releases);
+    printf("  grant to talk last %"PRIu32" ms, max %"PRIu32" ms, %"PRIu32" gated frames\n",
+           st.talk_ms_last, st.talk_ms_max, bt_app_metrics_counter_get(BT_APP_METRIC_FLOOR_GATED_FRAMES));
+    return 0;
+}
+
+//Task topology
+HF_CMD_HANDLER(tasks)
+{
+    bt_app_tasks_print();
+    uint32_t off_plan = bt_app_tasks_check();
+    if (off_plan) {
+        printf("  %"PRIu32" tasks off the core plan\n", off_plan);
+    }
+    return 0;
+}
+
+//Resource monitor
+HF_CMD_HANDLER(mem)
+{
+    bt_app_mem_stats_t st;
+    bt_app_mem_get_stats(&st);
+    printf("heap free %"PRIu32", lowest %"PRIu32", largest block %"PRIu32" (%"PRIu32" samples, %"PRIu32" warnings)\n",
+           st.heap_free, st.heap_min_free, st.heap_largest, st.samples, st.warnings);
+    printf("  %-18s %4s %6s %6s %6s\n", "task", "mem", "stack", "free", "lowest");
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        const bt_app_task_def_t *t = bt_app_tasks_def(i);
+        printf("  %-18s %4s %6"PRIu32, t->name, (BT_APP_MEM_STATIC && t->stat) ? "bss" : "heap", t->stack);
+        if (st.stack_free_min[i] == UINT32_MAX) {
+            printf("   not seen\n");
+        } else {
+            printf(" %6"PRIu32" %6"PRIu32"\n", st.stack_free[i], st.stack_free_min[i]);
+        }
+    }
+    printf("  %-18s %8s %8s %6s %10s\n", "subsystem", "allocs", "frees", "fails", "bytes");
+    for (int i = 0; i < BT_APP_MEM_SUBSYS_NUM; i++) {
+        printf("  %-18s %8"PRIu32" %8"PRIu32" %6"PRIu32" %10"PRIu32"\n", bt_app_mem_subsys_name(i),
+               st.subsys[i].allocs, st.subsys[i].frees, st.subsys[i].fails, st.subsys[i].bytes);
+    }
+    return 0;
+}
+
+#define HF_CMD_TBL_ENTRY(name, opcode, handler, run, args, text)    {opcode, #name, hf_##handler##_handler},
+static const hf_msg_hdl_t hf_cmd_tbl[HF_CMD_NUM] = {
+    HF_CMD_REGISTRY(HF_CMD_TBL_ENTRY)
+};
+
+#define HF_CMD_ARGS_ENTRY(name, opcode, handler, run, args, text)   args,
+static const char *const hf_cmd_args[HF_CMD_NUM] = {
+    HF_CMD_REGISTRY(HF_CMD_ARGS_ENTRY)
+};
+
+#define HF_CMD_TEXT_ENTRY(name, opcode, handler, run, args, text)   text,
+static const char *const hf_cmd_explain[HF_CMD_NUM] = {
+    HF_CMD_REGISTRY(HF_CMD_TEXT_ENTRY)
+};
+
+// console commands are queued to the executor task, binmode keeps the UART and runs in the REPL
+#define HF_CMD_FUNC_QUEUED(handler)     hf_exec_submit
+#define HF_CMD_FUNC_DIRECT(handler)     hf_##handler##_handler
+#define HF_CMD_FUNC_NONE(handler)       NULL
+#define HF_CMD_CONSOLE_ENTRY(name, opcode, handler, run, args, text)                \
+    {                                                                               \
+        .command = #name,                                                           \
+        .help = text,                                                               \
+        .hint = (sizeof(args) > 1) ? args : NULL,                                   \
+        .func = HF_CMD_FUNC_##run(handler),                                         \
+    },
+static const esp_console_cmd_t hf_console_cmds[HF_CMD_NUM] = {
+    HF_CMD_REGISTRY(HF_CMD_CONSOLE_ENTRY)
 };
 
-hf_msg_hdl_t *hf_get_cmd_tbl(void)
+_Static_assert(sizeof(hf_cmd_tbl) / sizeof(hf_cmd_tbl[0]) == sizeof(hf_console_cmds) / sizeof(hf_console_cmds[0]),
+               "command table and console commands out of step");
+
+const hf_msg_hdl_t *hf_get_cmd_tbl(void)
 {
     return hf_cmd_tbl;
 }
 
 size_t hf_get_cmd_tbl_size(void)
 {
-    return sizeof(hf_cmd_tbl) / sizeof(hf_msg_hdl_t);
-}
-
-#define HF_ORDER(name)   name##_cmd
-enum hf_cmd_name {
-    h = 0,      /*show command manual*/
-    con,        /*set up connection with peer device*/
-    dis,        /*disconnection with peer device*/
-    cona,       /*set up audio connection with peer device*/
-    disa,       /*release connection with peer device*/
-    vu,         /*volume update*/
-    ind,        /*unsolicited indication device status to HF Client*/
-    vron,       /*start voice recognition*/
-    vroff,      /*stop voice recognition*/
-    ate,        /*send extended at error code*/
-    iron,       /*in-band ring tone provided*/
-    iroff,      /*in-band ring tone not provided*/
-    ac,         /*Answer Incoming Call from AG*/
-    rc,         /*Reject Incoming Call from AG*/
-    end,        /*End up a call by AG*/
-    d           /*Dial Number by AG, e.g. d 11223344*/
-};
-static char *hf_cmd_explain[] = {
-    "show command manual",
-    "set up connection with peer device",
-    "disconnection with peer device",
-    "set up audio connection with peer device",
-    "release connection with peer device",
-    "volume update",
-    "unsolicited indication device status to HF Client",
-    "start voice recognition",
-    "stop voice recognition",
-    "send extended at error code",
-    "in-band ring tone provided",
-    "in-band ring tone not provided",
-    "Answer Incoming Call from AG",
-    "Reject Incoming Call from AG",
-    "End up a call by AG",
-    "Dial Number by AG, e.g. d 11223344",
+    return HF_CMD_NUM;
+}
+
+/*
+ * The command names in strcmp order, for the binary search of hf_find_cmd. A new command goes into
+ * its place here as well; an unknown name, a missing one or one out of order stops the build.
+ */
+#define HF_CMD_BY_NAME(X)                                                                           \
+    X(ac) X(ate) X(binmode) X(call) X(con) X(cona) X(d) X(dis) X(disa) X(dlog) X(end) X(floor)     \
+    X(h) X(ind) X(iroff) X(iron) X(mem) X(metrics) X(rc) X(script) X(stats) X(tasks)         \
+    X(trace) X(vroff) X(vron) X(vu)
+
+// hf_cmd_tbl indices in name order, an unknown name fails here
+#define HF_CMD_BY_NAME_ENTRY(name)      HF_CMD_IDX_##name,
+static const uint8_t hf_cmd_by_name[] = {
+    HF_CMD_BY_NAME(HF_CMD_BY_NAME_ENTRY)
 };
-typedef struct {
-    struct arg_str *tgt;
-    struct arg_str *vol;
-    struct arg_end *end;
-} vu_args_t;
-
-typedef struct {
-    struct arg_str *call;
-    struct arg_str *ntk;
-    struct arg_str *callsetup;
-    struct arg_str *sig;
-    struct arg_end *end;
-} ind_args_t;
-
-typedef struct {
-    struct arg_str *rep;
-    struct arg_str *err;
-    struct arg_end *end;
-} ate_args_t;
-
-static vu_args_t vu_args;
-static ind_args_t ind_args;
-static ate_args_t ate_args;
+
+_Static_assert(HF_CMD_NUM <= UINT8_MAX, "hf_cmd_by_name holds uint8_t indices");
+_Static_assert(sizeof(hf_cmd_by_name) == HF_CMD_NUM, "HF_CMD_BY_NAME: a command is missing or listed twice");
+
+// every name sorts after the one before it, GCC folds __builtin_strcmp of two literals. Each entry
+// closes the comparison with its predecessor and opens the one with its successor.
+#define HF_CMD_BY_NAME_ORDER(name)                                                                  \
+    #name) < 0, "HF_CMD_BY_NAME: " #name " out of order");                                         \
+    _Static_assert(__builtin_strcmp(#name,
+_Static_assert(__builtin_strcmp("", HF_CMD_BY_NAME(HF_CMD_BY_NAME_ORDER) "~") < 0, "HF_CMD_BY_NAME: names past '~'");
+
+const hf_msg_hdl_t *hf_find_cmd(const char *cmd)
+{
+    size_t lo = 0;
+    size_t hi = HF_CMD_NUM;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const hf_msg_hdl_t *hdl = &hf_cmd_tbl[hf_cmd_by_name[mid]];
+        int c = strcmp(cmd, hdl->str);
+        if (c == 0) {
+            return hdl;
+        }
+        if (c < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+// the compiler picks a jump table or a binary search and rejects duplicate opcodes
+#define HF_CMD_OPCODE_CASE(name, opcode, handler, run, args, text)                  \
+    case (opcode):                                                                  \
+        return &hf_cmd_tbl[HF_CMD_IDX_##name];
+const hf_msg_hdl_t *hf_find_cmd_by_opcode(uint16_t opcode)
+{
+    switch (opcode) {
+    HF_CMD_REGISTRY(HF_CMD_OPCODE_CASE)
+    default:
+        return NULL;
+    }
+}
+
+void hf_msg_show_usage(void)
+{
+    char synopsis[64];
+    printf("########################################################################\n");
+    printf("HFP AG command usage manual\n");
+    printf("HFP AG commands begins with \"hf\" and end with \";\"\n");
+    printf("Supported commands are as follows, arguments are embraced with < and >\n\n");
+    for (size_t i = 0; i < HF_CMD_NUM; i++) {
+        snprintf(synopsis, sizeof(synopsis), "hf %s%s%s;", hf_cmd_tbl[i].str,
+                 hf_cmd_args[i][0] ? " " : "", hf_cmd_args[i]);
+        printf("%-25s -- %s\n", synopsis, hf_cmd_explain[i]);
+    }
+    printf("########################################################################\n");
+}
 
 void register_hfp_ag(void)
 {
+    hf_exec_init();
 
-        const esp_console_cmd_t HF_ORDER(con) = {
-            .command = "con",
-            .help = hf_cmd_explain[con],
-            .hint = NULL,
-            .func = hf_cmd_tbl[con].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(con)));
-
-        const esp_console_cmd_t HF_ORDER(dis) = {
-            .command = "dis",
-            .help = hf_cmd_explain[dis],
-            .hint = NULL,
-            .func = hf_cmd_tbl[dis].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(dis)));
-
-        const esp_console_cmd_t HF_ORDER(cona) = {
-            .command = "cona",
-            .help = hf_cmd_explain[cona],
-            .hint = NULL,
-            .func = hf_cmd_tbl[cona].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(cona)));
-
-        const esp_console_cmd_t HF_ORDER(disa) = {
-            .command = "disa",
-            .help = hf_cmd_explain[disa],
-            .hint = NULL,
-            .func = hf_cmd_tbl[disa].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(disa)));
-
-
-
-        const esp_console_cmd_t HF_ORDER(ac) = {
-            .command = "ac",
-            .help = hf_cmd_explain[ac],
-            .hint = NULL,
-            .func = hf_cmd_tbl[ac].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(ac)));
-
-        const esp_console_cmd_t HF_ORDER(rc) = {
-            .command = "rc",
-            .help = hf_cmd_explain[rc],
-            .hint = NULL,
-            .func = hf_cmd_tbl[rc].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(rc)));
-
-        const esp_console_cmd_t HF_ORDER(d) = {
-            .command = "d",
-            .help = hf_cmd_explain[d],
-            .hint = "<num>",
-            .func = hf_cmd_tbl[d].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(d)));
-
-
-
-        const esp_console_cmd_t HF_ORDER(vron) = {
-            .command = "vron",
-            .help = hf_cmd_explain[vron],
-            .hint = NULL,
-            .func = hf_cmd_tbl[vron].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(vron)));
-
-        const esp_console_cmd_t HF_ORDER(vroff) = {
-            .command = "vroff",
-            .help = hf_cmd_explain[vroff],
-            .hint = NULL,
-            .func = hf_cmd_tbl[vroff].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(vroff)));
-
-        vu_args.tgt = arg_str1(NULL, NULL, "<tgt>", "\n        0-speaker\n        1-microphone");
-        vu_args.vol = arg_str1(NULL, NULL, "<vol>", "volume gain ranges from 0 to 15");
-        vu_args.end = arg_end(1);
-        const esp_console_cmd_t HF_ORDER(vu) = {
-            .command = "vu",
-            .help = hf_cmd_explain[vu],
-            .hint = NULL,
-            .func = hf_cmd_tbl[vu].handler,
-            .argtable = &vu_args
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(vu)));
-
-        const esp_console_cmd_t HF_ORDER(end) = {
-            .command = "end",
-            .help = hf_cmd_explain[end],
-            .hint = NULL,
-            .func = hf_cmd_tbl[end].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(end)));
-
-        const esp_console_cmd_t HF_ORDER(iron) = {
-            .command = "iron",
-            .help = hf_cmd_explain[iron],
-            .hint = NULL,
-            .func = hf_cmd_tbl[iron].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(iron)));
-
-        const esp_console_cmd_t HF_ORDER(iroff) = {
-            .command = "iroff",
-            .help = hf_cmd_explain[iroff],
-            .hint = NULL,
-            .func = hf_cmd_tbl[iroff].handler,
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(iroff)));
-
-        ind_args.call = arg_str1(NULL, NULL, "<call>", "call status [0,1]");
-        ind_args.callsetup = arg_str1(NULL, NULL, "<callsetup>", "call setup status [0,3]");
-        ind_args.ntk = arg_str1(NULL, NULL, "<ntk>", "network status [0,1]");
-        ind_args.sig = arg_str1(NULL, NULL, "<sig>", "signal strength value from 0~5");
-        ind_args.end = arg_end(1);
-        const esp_console_cmd_t HF_ORDER(ind) = {
-            .command = "ind",
-            .help = hf_cmd_explain[ind],
-            .hint = NULL,
-            .func = hf_cmd_tbl[ind].handler,
-            .argtable = &ind_args
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(ind)));
-
-        ate_args.err = arg_str1(NULL, NULL, "<err>", "error code from 0 to 32");
-        ate_args.rep = arg_str1(NULL, NULL, "<rep>", "response code from 0 to 7");
-        ate_args.end = arg_end(1);
-        const esp_console_cmd_t HF_ORDER(ate) = {
-            .command = "ate",
-            .help = hf_cmd_explain[ate],
-            .hint = NULL,
-            .func = hf_cmd_tbl[ate].handler,
-            .argtable = &ate_args
-        };
-        ESP_ERROR_CHECK(esp_console_cmd_register(&HF_ORDER(ate)));
+    for (size_t i = 0; i < HF_CMD_NUM; i++) {
+        if (hf_console_cmds[i].func == NULL) {
+            continue;
+        }
+        ESP_ERROR_CHECK(esp_console_cmd_register(&hf_console_cmds[i]));
+    }
 }
@@ -17,9 +17,23 @@ typedef struct {
     hf_cmd_handler handler;
 } hf_msg_hdl_t;
 
-extern hf_msg_hdl_t *hf_get_cmd_tbl(void);
+extern const hf_msg_hdl_t *hf_get_cmd_tbl(void);
 extern size_t hf_get_cmd_tbl_size(void);
 
+/**
+ * @brief     find a command by name
+ *
+ * @return    the table entry, or NULL if the command does not exist
+ */
+const hf_msg_hdl_t *hf_find_cmd(const char *name);
+
+/**
+ * @brief     find a command by the opcode of its table entry
+ *
+ * @return    the table entry, or NULL if no command has this opcode
+ */
+const hf_msg_hdl_t *hf_find_cmd_by_opcode(uint16_t opcode);
+
 void hf_msg_show_usage(void);
 
 void register_hfp_ag(void);
@@ -0,0 +1,269 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_call.c
+
+Overall Responsibility:
+Call state machine of the AG. In the intercom a call is how the earbuds are told to open the audio
+path, so answer, dial, hang up and AT+CLCC all have to agree on one call instead of each sending
+its own made-up numbers and states.
+
+Important Details:
+
+1. States and events:
+   - idle, incoming, outgoing, alerting, active and held, one call at a time. `bt_app_call_next` is
+     the transition table and has no side effects. An event that is not allowed in the current
+     state changes nothing and is counted as rejected; the caller answers the HF with ERROR.
+
+2. Phone state:
+   - Every transition hands the new phone state (active and held calls, call setup) to the stack.
+     The stack sends RING, +CIEV and OK from the difference to the previous state, to the call's
+     peer only. The indicator model (bt_app_ind) records that peer's copy so it does not repeat
+     those reports, and reports the change to any other HF with an SLC.
+
+3. Audio:
+   - When a call becomes active and audio is not up, audio is connected right away, there is no
+     separate `cona` round. Audio brought up for a call is released when the call ends. The time
+     from active to audio connected is kept as time-to-talk.
+
+4. AT+CLCC:
+   - Answered from the current call (direction, state, number) and closed with the final OK, an
+     empty list when idle.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "freertos/FreeRTOS.h"
+#include "bt_app_call.h"
+#include "bt_app_ind.h"
+#include "bt_app_dlog.h"
+
+#define CALL_NONE                 BT_APP_CALL_STATE_NUM
+
+typedef struct {
+    int num_active;
+    int num_held;
+    esp_hf_call_status_t call;
+    esp_hf_call_setup_status_t setup;
+    int callheld;                           /* +CIEV callheld: 0 none, 1 active and held, 2 held only */
+    esp_hf_current_call_status_t clcc;
+} call_phone_t;
+
+static const call_phone_t s_phone[BT_APP_CALL_STATE_NUM] = {
+    [BT_APP_CALL_IDLE]     = {0, 0, ESP_HF_CALL_STATUS_NO_CALLS,         ESP_HF_CALL_SETUP_STATUS_IDLE,              0, ESP_HF_CURRENT_CALL_STATUS_ACTIVE},
+    [BT_APP_CALL_INCOMING] = {0, 0, ESP_HF_CALL_STATUS_NO_CALLS,         ESP_HF_CALL_SETUP_STATUS_INCOMING,          0, ESP_HF_CURRENT_CALL_STATUS_INCOMING},
+    [BT_APP_CALL_OUTGOING] = {0, 0, ESP_HF_CALL_STATUS_NO_CALLS,         ESP_HF_CALL_SETUP_STATUS_OUTGOING_DIALING,  0, ESP_HF_CURRENT_CALL_STATUS_DIALING},
+    [BT_APP_CALL_ALERTING] = {0, 0, ESP_HF_CALL_STATUS_NO_CALLS,         ESP_HF_CALL_SETUP_STATUS_OUTGOING_ALERTING, 0, ESP_HF_CURRENT_CALL_STATUS_ALERTING},
+    [BT_APP_CALL_ACTIVE]   = {1, 0, ESP_HF_CALL_STATUS_CALL_IN_PROGRESS, ESP_HF_CALL_SETUP_STATUS_IDLE,              0, ESP_HF_CURRENT_CALL_STATUS_ACTIVE},
+    [BT_APP_CALL_HELD]     = {0, 1, ESP_HF_CALL_STATUS_CALL_IN_PROGRESS, ESP_HF_CALL_SETUP_STATUS_IDLE,              2, ESP_HF_CURRENT_CALL_STATUS_HELD},
+};
+
+static const uint8_t s_next[BT_APP_CALL_STATE_NUM][BT_APP_CALL_EVT_NUM] = {
+    /*                          RING                    DIAL                    ALERT                   ANSWER              HOLD              RESUME              END */
+    [BT_APP_CALL_IDLE]     = {BT_APP_CALL_INCOMING,   BT_APP_CALL_OUTGOING,   CALL_NONE,              CALL_NONE,          CALL_NONE,        CALL_NONE,          CALL_NONE},
+    [BT_APP_CALL_INCOMING] = {CALL_NONE,              CALL_NONE,              CALL_NONE,              BT_APP_CALL_ACTIVE, CALL_NONE,        CALL_NONE,          BT_APP_CALL_IDLE},
+    [BT_APP_CALL_OUTGOING] = {CALL_NONE,              CALL_NONE,              BT_APP_CALL_ALERTING,   BT_APP_CALL_ACTIVE, CALL_NONE,        CALL_NONE,          BT_APP_CALL_IDLE},
+    [BT_APP_CALL_ALERTING] = {CALL_NONE,              CALL_NONE,              CALL_NONE,              BT_APP_CALL_ACTIVE, CALL_NONE,        CALL_NONE,          BT_APP_CALL_IDLE},
+    [BT_APP_CALL_ACTIVE]   = {CALL_NONE,              CALL_NONE,              CALL_NONE,              CALL_NONE,          BT_APP_CALL_HELD, CALL_NONE,          BT_APP_CALL_IDLE},
+    [BT_APP_CALL_HELD]     = {CALL_NONE,              CALL_NONE,              CALL_NONE,              CALL_NONE,          CALL_NONE,        BT_APP_CALL_ACTIVE, BT_APP_CALL_IDLE},
+};
+
+static const char *const s_state_str[BT_APP_CALL_STATE_NUM] = {
+    "idle", "incoming", "outgoing", "alerting", "active", "held",
+};
+
+static portMUX_TYPE s_call_lock = portMUX_INITIALIZER_UNLOCKED;
+static bt_app_call_info_t s_call;
+static esp_bd_addr_t s_call_peer;
+static char s_last_number[BT_APP_CALL_NUMBER_MAX];
+static bool s_audio_up;
+static bool s_audio_by_call;                /* audio was connected because the call became active */
+static bool s_talk_pending;                 /* active, waiting for audio to measure time-to-talk */
+static int64_t s_active_us;
+
+/* bounded copy that is cheap enough for the critical sections */
+static void bt_app_call_copy_number(char *dst, const char *src)
+{
+    size_t n = strnlen(src, BT_APP_CALL_NUMBER_MAX - 1);
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+bt_app_call_state_t bt_app_call_next(bt_app_call_state_t state, bt_app_call_evt_t evt)
+{
+    if (state >= BT_APP_CALL_STATE_NUM || evt >= BT_APP_CALL_EVT_NUM) {
+        return CALL_NONE;
+    }
+    return s_next[state][evt];
+}
+
+const char *bt_app_call_state_str(bt_app_call_state_t state)
+{
+    return (state < BT_APP_CALL_STATE_NUM) ? s_state_str[state] : "invalid";
+}
+
+/*
+ * The four esp_hf_ag_*_call functions end in the same phone state update in the stack, which
+ * works out RING, +CIEV and OK from the old and new state. The one named after the transition is
+ * used; the stack has no separate call for ringing, so that goes through answer_call.
+ */
+static void bt_app_call_push(uint8_t *bda, bt_app_call_state_t from, bt_app_call_state_t to, char *number)
+{
+    const call_phone_t *ph = &s_phone[to];
+    if (to == BT_APP_CALL_IDLE && from == BT_APP_CALL_INCOMING) {
+        esp_hf_ag_reject_call(bda, ph->num_active, ph->num_held, ph->call, ph->setup, number, ESP_HF_CALL_ADDR_TYPE_UNKNOWN);
+    } else if (to == BT_APP_CALL_IDLE) {
+        esp_hf_ag_end_call(bda, ph->num_active, ph->num_held, ph->call, ph->setup, number, ESP_HF_CALL_ADDR_TYPE_UNKNOWN);
+    } else if (to == BT_APP_CALL_OUTGOING || to == BT_APP_CALL_ALERTING) {
+        esp_hf_ag_out_call(bda, ph->num_active, ph->num_held, ph->call, ph->setup, number, ESP_HF_CALL_ADDR_TYPE_UNKNOWN);
+    } else {
+        esp_hf_ag_answer_call(bda, ph->num_active, ph->num_held, ph->call, ph->setup, number, ESP_HF_CALL_ADDR_TYPE_UNKNOWN);
+    }
+    // the stack has sent these itself, to this peer only
+    bt_app_ind_set_reported(bda, BT_APP_IND_CALL, ph->call);
+    bt_app_ind_set_reported(bda, BT_APP_IND_CALLSETUP, ph->setup);
+    bt_app_ind_set_reported(bda, BT_APP_IND_CALLHELD, ph->callheld);
+    bt_app_ind_report_all();
+}
+
+bool bt_app_call_event(esp_bd_addr_t bda, bt_app_call_evt_t evt, const char *number)
+{
+    esp_bd_addr_t peer;
+    char call_number[BT_APP_CALL_NUMBER_MAX];
+    bool audio_connect = false;
+    bool audio_disconnect = false;
+
+    portENTER_CRITICAL(&s_call_lock);
+    bt_app_call_state_t from = s_call.state;
+    bt_app_call_state_t to = bt_app_call_next(from, evt);
+    if (to == CALL_NONE) {
+        s_call.rejected++;
+        portEXIT_CRITICAL(&s_call_lock);
+        ESP_LOGW(BT_APP_CALL_TAG, "event %d not allowed while %s", evt, s_state_str[from]);
+        return false;
+    }
+    if (from == BT_APP_CALL_IDLE) {
+        memcpy(s_call_peer, bda, ESP_BD_ADDR_LEN);
+        s_call.outgoing = (evt == BT_APP_CALL_EVT_DIAL);
+        bt_app_call_copy_number(s_call.number, (number && number[0]) ? number : BT_APP_CALL_DEFAULT_NUMBER);
+        if (s_call.outgoing) {
+            bt_app_call_copy_number(s_last_number, s_call.number);
+        }
+    }
+    s_call.state = to;
+    if (to == BT_APP_CALL_ACTIVE && from != BT_APP_CALL_HELD) {
+        s_call.calls++;
+        s_active_us = esp_timer_get_time();
+        s_talk_pending = true;
+        if (s_audio_up) {
+            s_talk_pending = false;
+            s_call.talk_ms_last = 0;
+        } else {
+            audio_connect = true;
+            s_audio_by_call = true;
+        }
+    } else if (to == BT_APP_CALL_IDLE) {
+        s_talk_pending = false;
+        audio_disconnect = s_audio_by_call && s_audio_up;
+        s_audio_by_call = false;
+    }
+    memcpy(peer, s_call_peer, ESP_BD_ADDR_LEN);
+    bt_app_call_copy_number(call_number, s_call.number);
+    portEXIT_CRITICAL(&s_call_lock);
+
+    BT_APP_DLOG(CALL_STATE, BT_APP_DLOG_STR(s_state_str[from]), BT_APP_DLOG_STR(s_state_str[to]));
+    bt_app_call_push(peer, from, to, call_number);
+    if (audio_connect) {
+        esp_hf_ag_audio_connect(peer);
+    } else if (audio_disconnect) {
+        esp_hf_ag_audio_disconnect(peer);
+    }
+    return true;
+}
+
+void bt_app_call_clcc_response(esp_bd_addr_t bda)
+{
+    char number[BT_APP_CALL_NUMBER_MAX];
+
+    portENTER_CRITICAL(&s_call_lock);
+    bt_app_call_state_t state = s_call.state;
+    bool outgoing = s_call.outgoing;
+    bt_app_call_copy_number(number, s_call.number);
+    portEXIT_CRITICAL(&s_call_lock);
+
+    if (state != BT_APP_CALL_IDLE) {
+        esp_hf_ag_clcc_response(bda, 1,
+                                outgoing ? ESP_HF_CURRENT_CALL_DIRECTION_OUTGOING : ESP_HF_CURRENT_CALL_DIRECTION_INCOMING,
+                                s_phone[state].clcc, ESP_HF_CURRENT_CALL_MODE_VOICE, ESP_HF_CURRENT_CALL_MPTY_TYPE_SINGLE,
+                                number, ESP_HF_CALL_ADDR_TYPE_UNKNOWN);
+    }
+    // index 0 ends the list with OK
+    esp_hf_ag_clcc_response(bda, 0, 0, 0, 0, 0, NULL, 0);
+}
+
+void bt_app_call_on_audio(bool connected)
+{
+    portENTER_CRITICAL(&s_call_lock);
+    s_audio_up = connected;
+    bool measured = connected && s_talk_pending;
+    uint32_t talk_ms = 0;
+    if (measured) {
+        talk_ms = (uint32_t)((esp_timer_get_time() - s_active_us) / 1000);
+        s_talk_pending = false;
+        s_call.talk_ms_last = talk_ms;
+        if (talk_ms > s_call.talk_ms_max) {
+            s_call.talk_ms_max = talk_ms;
+        }
+    }
+    if (!connected) {
+        s_audio_by_call = false;
+    }
+    portEXIT_CRITICAL(&s_call_lock);
+
+    if (measured) {
+        BT_APP_DLOG(CALL_TALK, talk_ms);
+    }
+}
+
+void bt_app_call_on_disconnect(esp_bd_addr_t bda)
+{
+    portENTER_CRITICAL(&s_call_lock);
+    bool ended = (s_call.state != BT_APP_CALL_IDLE && memcmp(s_call_peer, bda, ESP_BD_ADDR_LEN) == 0);
+    bt_app_call_state_t from = s_call.state;
+    if (ended) {
+        s_call.state = BT_APP_CALL_IDLE;
+        s_talk_pending = false;
+        s_audio_by_call = false;
+    }
+    portEXIT_CRITICAL(&s_call_lock);
+
+    if (ended) {
+        BT_APP_DLOG(CALL_STATE, BT_APP_DLOG_STR(s_state_str[from]), BT_APP_DLOG_STR(s_state_str[BT_APP_CALL_IDLE]));
+        // nothing was sent, the peer is gone; the others still have to hear the call ended
+        bt_app_ind_set_reported(bda, BT_APP_IND_CALL, ESP_HF_CALL_STATUS_NO_CALLS);
+        bt_app_ind_set_reported(bda, BT_APP_IND_CALLSETUP, ESP_HF_CALL_SETUP_STATUS_IDLE);
+        bt_app_ind_set_reported(bda, BT_APP_IND_CALLHELD, 0);
+        bt_app_ind_report_all();
+    }
+}
+
+const char *bt_app_call_last_number(void)
+{
+    return s_last_number;
+}
+
+void bt_app_call_get_info(bt_app_call_info_t *info)
+{
+    portENTER_CRITICAL(&s_call_lock);
+    *info = s_call;
+    portEXIT_CRITICAL(&s_call_lock);
+}
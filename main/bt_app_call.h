@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_CALL_H__
+#define __BT_APP_CALL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_bt_defs.h"
+
+#define BT_APP_CALL_TAG             "BT_APP_CALL"
+
+#define BT_APP_CALL_NUMBER_MAX      (32)
+
+/* number shown for calls the AG starts without one */
+#define BT_APP_CALL_DEFAULT_NUMBER  "123456"
+
+typedef enum {
+    BT_APP_CALL_IDLE = 0,
+    BT_APP_CALL_INCOMING,           /*!< ringing at the HF */
+    BT_APP_CALL_OUTGOING,           /*!< dialed, remote not reached yet */
+    BT_APP_CALL_ALERTING,           /*!< remote is ringing */
+    BT_APP_CALL_ACTIVE,
+    BT_APP_CALL_HELD,
+    BT_APP_CALL_STATE_NUM,
+} bt_app_call_state_t;
+
+typedef enum {
+    BT_APP_CALL_EVT_RING = 0,       /*!< a call comes in */
+    BT_APP_CALL_EVT_DIAL,           /*!< AG or HF dials */
+    BT_APP_CALL_EVT_ALERT,          /*!< the remote party is ringing */
+    BT_APP_CALL_EVT_ANSWER,         /*!< incoming call answered (ATA or AG), or outgoing call picked up */
+    BT_APP_CALL_EVT_HOLD,
+    BT_APP_CALL_EVT_RESUME,
+    BT_APP_CALL_EVT_END,            /*!< reject, hang up (AT+CHUP or AG) or remote end */
+    BT_APP_CALL_EVT_NUM,
+} bt_app_call_evt_t;
+
+typedef struct {
+    bt_app_call_state_t state;
+    bool outgoing;
+    char number[BT_APP_CALL_NUMBER_MAX];
+    uint32_t calls;                 /*!< calls that became active */
+    uint32_t rejected;              /*!< events not allowed in the state they came in */
+    uint32_t talk_ms_last;          /*!< active to audio connected, last call */
+    uint32_t talk_ms_max;
+} bt_app_call_info_t;
+
+/**
+ * @brief     the state machine without side effects
+ *
+ * @return    the next state, or BT_APP_CALL_STATE_NUM if the event is not allowed in this state
+ */
+bt_app_call_state_t bt_app_call_next(bt_app_call_state_t state, bt_app_call_evt_t evt);
+
+/**
+ * @brief     feed an event for the call with a peer: update the phone state in the stack,
+ *            answer audio and indicators; number is used by RING and DIAL and may be NULL
+ *
+ * @return    false if the event is not allowed in the current state, nothing was changed
+ */
+bool bt_app_call_event(esp_bd_addr_t bda, bt_app_call_evt_t evt, const char *number);
+
+/**
+ * @brief     answer AT+CLCC from the current call
+ */
+void bt_app_call_clcc_response(esp_bd_addr_t bda);
+
+/**
+ * @brief     audio state of the call's peer, to bring audio up when a call becomes active
+ */
+void bt_app_call_on_audio(bool connected);
+
+/**
+ * @brief     SLC of the call's peer is gone, the call ends without telling the stack
+ */
+void bt_app_call_on_disconnect(esp_bd_addr_t bda);
+
+/**
+ * @brief     number of the last outgoing call, for AT+BLDN; empty if there was none
+ */
+const char *bt_app_call_last_number(void);
+
+void bt_app_call_get_info(bt_app_call_info_t *info);
+
+const char *bt_app_call_state_str(bt_app_call_state_t state);
+
+#endif /* __BT_APP_CALL_H__ */
@@ -26,9 +26,14 @@ Important Functions:
      - p_params: Pointer to message parameters.
      - param_len: Length of the parameters.
      - p_copy_cback: Optional deep copy callback.
+   - With BT_APP_MEM_STATIC the parameters are copied into a record of a fixed pool
+     (BT_APP_CORE_PARAM_POOL_SIZE records of BT_APP_CORE_PARAM_SIZE bytes, a bitmask of free
+     records taken with compare and swap); only a larger parameter or an empty pool uses the heap.
+     A message that cannot be queued gives its parameters back.
    
 2. bt_app_send_msg(bt_app_msg_t *msg):
-   - Purpose: Sends a message to the `bt_app_task_queue`.
+   - Purpose: Sends a message to the `bt_app_task_queue` and notifies the task. Only a full queue
+     makes the sender wait, for at least 10 ms (`bt_app_time_ms_to_ticks`) at any tick rate.
    - Parameters:
      - msg: Pointer to the message to send.
    
@@ -40,21 +45,21 @@ Important Functions:
 4. bt_app_task_handler(void *arg):
    - Purpose: Task that waits for and processes messages from the `bt_app_task_queue`.
    - Key Actions:
-     - Waits for a message from the queue.
+     - Waits for its task notification, then takes every message in the queue.
      - Logs the message.
      - Handles the message based on its signature, currently supporting `BT_APP_SIG_WORK_DISPATCH`.
-     - Frees any dynamically allocated parameters in the message.
+     - Gives the parameters of the message back to the pool or the heap.
    
 5. bt_app_task_start_up(void):
    - Purpose: Initializes the task and queue for Bluetooth message handling.
    - Key Actions:
-     - Creates the `bt_app_task_queue`.
+     - Creates the `bt_app_task_queue`, on static storage with BT_APP_MEM_STATIC.
      - Creates the `bt_app_task_handler` task.
    
 6. bt_app_task_shut_down(void):
    - Purpose: De-initializes the task and queue associated with Bluetooth message handling.
    - Key Actions:
-     - Deletes the `bt_app_task_handler` task.
+     - Deletes the `bt_app_task_handler` task through `bt_app_tasks_delete`, which gives its deferred log ring back.
      - Deletes the `bt_app_task_queue`.
 
 From this analysis, the `bt_app_core.c` file focuses on managing the dispatch and handling 
@@ -66,13 +71,22 @@ and shutting down the task.
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
 #include "freertos/xtensa_api.h"
 #include "freertos/FreeRTOSConfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "bt_app_core.h"
+#include "bt_app_metrics.h"
+#include "bt_app_dlog.h"
+#include "bt_app_trace.h"
+#include "bt_app_time.h"
+#include "bt_app_tasks.h"
+#include "bt_app_mem.h"
 
 static void bt_app_task_handler(void *arg);
 static bool bt_app_send_msg(bt_app_msg_t *msg);
@@ -81,6 +95,49 @@ static void bt_app_work_dispatched(bt_app_msg_t *msg);
 static QueueHandle_t bt_app_task_queue = NULL;
 static TaskHandle_t bt_app_task_handle = NULL;
 
+#if BT_APP_MEM_STATIC
+typedef union {
+    uint8_t data[BT_APP_CORE_PARAM_SIZE];
+    max_align_t align;
+} bt_app_param_rec_t;
+
+static StaticQueue_t bt_app_task_queue_buf;
+static uint8_t bt_app_task_queue_storage[BT_APP_CORE_QUEUE_LEN * sizeof(bt_app_msg_t)];
+static bt_app_param_rec_t bt_app_param_pool[BT_APP_CORE_PARAM_POOL_SIZE];
+static atomic_uint bt_app_param_pool_free = (1u << BT_APP_CORE_PARAM_POOL_SIZE) - 1;
+
+_Static_assert(BT_APP_CORE_PARAM_POOL_SIZE <= 32, "bt_app_param_pool_free has one bit per record");
+#endif
+
+static void *bt_app_param_alloc(int len)
+{
+#if BT_APP_MEM_STATIC
+    if (len <= BT_APP_CORE_PARAM_SIZE) {
+        unsigned free_mask = atomic_load_explicit(&bt_app_param_pool_free, memory_order_relaxed);
+        while (free_mask) {
+            unsigned slot = __builtin_ctz(free_mask);
+            if (atomic_compare_exchange_weak_explicit(&bt_app_param_pool_free, &free_mask, free_mask & ~(1u << slot),
+                                                      memory_order_acquire, memory_order_relaxed)) {
+                return bt_app_param_pool[slot].data;
+            }
+        }
+    }
+#endif
+    return bt_app_mem_alloc(BT_APP_MEM_DISPATCH, len);
+}
+
+static void bt_app_param_free(void *p)
+{
+#if BT_APP_MEM_STATIC
+    bt_app_param_rec_t *rec = (bt_app_param_rec_t *)p;
+    if (rec >= &bt_app_param_pool[0] && rec < &bt_app_param_pool[BT_APP_CORE_PARAM_POOL_SIZE]) {
+        atomic_fetch_or_explicit(&bt_app_param_pool_free, 1u << (rec - bt_app_param_pool), memory_order_release);
+        return;
+    }
+#endif
+    bt_app_mem_free(BT_APP_MEM_DISPATCH, p);
+}
+
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback)
 {
     ESP_LOGD(BT_APP_CORE_TAG, "%s event 0x%x, param len %d", __func__, event, param_len);
@@ -95,13 +152,17 @@ bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, i
     if (param_len == 0) {
         return bt_app_send_msg(&msg);
     } else if (p_params && param_len > 0) {
-        if ((msg.param = malloc(param_len)) != NULL) {
+        if ((msg.param = bt_app_param_alloc(param_len)) != NULL) {
             memcpy(msg.param, p_params, param_len);
             /* check if caller has provided a copy callback to do the deep copy */
             if (p_copy_cback) {
                 p_copy_cback(&msg, msg.param, p_params);
             }
-            return bt_app_send_msg(&msg);
+            if (bt_app_send_msg(&msg)) {
+                return true;
+            }
+            // a pool record would be gone for good
+            bt_app_param_free(msg.param);
         }
     }
     return false;
@@ -113,25 +174,39 @@ static bool bt_app_send_msg(bt_app_msg_t *msg)
         return false;
     }
 
-    if (xQueueSend(bt_app_task_queue, msg, 10 / portTICK_PERIOD_MS) != pdTRUE) {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s xQueue send failed", __func__);
+    msg->ts = (uint32_t)esp_timer_get_time();
+    BT_APP_TRACE_INSTANT(DISPATCH, msg->event, msg->sig);
+    // waits only when the queue is full, and then for at least 10 ms whatever the tick rate
+    if (xQueueSend(bt_app_task_queue, msg, bt_app_time_ms_to_ticks(10)) != pdTRUE) {
+        BT_APP_DLOG(CORE_SEND_FAIL);
+        bt_app_metrics_inc(BT_APP_METRIC_DISPATCH_DROPPED);
         return false;
     }
+    xTaskNotifyGive(bt_app_task_handle);
+    bt_app_metrics_inc(BT_APP_METRIC_DISPATCH_ENQUEUED);
     return true;
 }
 
 static void bt_app_work_dispatched(bt_app_msg_t *msg)
 {
+    uint32_t start = (uint32_t)esp_timer_get_time();
+    bt_app_metrics_hist_record(BT_APP_METRIC_DISPATCH_LATENCY_US, start - msg->ts);
+    BT_APP_TRACE_BEGIN(DISPATCH, msg->event, start - msg->ts);
     if (msg->cb) {
         msg->cb(msg->event, msg->param);
     }
+    BT_APP_TRACE_END(DISPATCH, msg->event, 0);
+    bt_app_metrics_hist_record(BT_APP_METRIC_DISPATCH_HANDLER_US, (uint32_t)esp_timer_get_time() - start);
+    bt_app_metrics_inc(BT_APP_METRIC_DISPATCH_HANDLED);
 }
 
 static void bt_app_task_handler(void *arg)
 {
     bt_app_msg_t msg;
     for (;;) {
-        if (pdTRUE == xQueueReceive(bt_app_task_queue, &msg, (TickType_t)portMAX_DELAY)) {
+        // every send notifies; the queue is drained before waiting again
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (pdTRUE == xQueueReceive(bt_app_task_queue, &msg, 0)) {
             ESP_LOGD(BT_APP_CORE_TAG, "%s, sig 0x%x, 0x%x", __func__, msg.sig, msg.event);
             switch (msg.sig) {
             case BT_APP_SIG_WORK_DISPATCH:
@@ -142,24 +217,27 @@ static void bt_app_task_handler(void *arg)
                 break;
             } // switch (msg.sig)
 
-            if (msg.param) {
-                free(msg.param);
-            }
+            bt_app_param_free(msg.param);
         }
     }
 }
 
 void bt_app_task_start_up(void)
 {
-    bt_app_task_queue = xQueueCreate(10, sizeof(bt_app_msg_t));
-    xTaskCreate(bt_app_task_handler, "BtAppT", 2048, NULL, configMAX_PRIORITIES - 3, &bt_app_task_handle);
+#if BT_APP_MEM_STATIC
+    bt_app_task_queue = xQueueCreateStatic(BT_APP_CORE_QUEUE_LEN, sizeof(bt_app_msg_t), bt_app_task_queue_storage,
+                                           &bt_app_task_queue_buf);
+#else
+    bt_app_task_queue = xQueueCreate(BT_APP_CORE_QUEUE_LEN, sizeof(bt_app_msg_t));
+#endif
+    bt_app_tasks_create(BT_APP_TASK_CORE, bt_app_task_handler, NULL, &bt_app_task_handle);
     return;
 }
 
 void bt_app_task_shut_down(void)
 {
     if (bt_app_task_handle) {
-        vTaskDelete(bt_app_task_handle);
+        bt_app_tasks_delete(bt_app_task_handle);
         bt_app_task_handle = NULL;
     }
     if (bt_app_task_queue) {
@@ -15,6 +15,11 @@
 
 #define BT_APP_SIG_WORK_DISPATCH          (0x01)
 
+#define BT_APP_CORE_QUEUE_LEN             (10)
+/* BT_APP_MEM_STATIC: parameter records, a larger parameter or an empty pool falls back to the heap */
+#define BT_APP_CORE_PARAM_POOL_SIZE       (8)
+#define BT_APP_CORE_PARAM_SIZE            (64)
+
 /**
  * @brief     handler for the dispatched work
  */
@@ -25,6 +30,7 @@ typedef struct {
     uint16_t             sig;      /*!< signal to bt_app_task */
     uint16_t             event;    /*!< message event id */
     bt_app_cb_t          cb;       /*!< context switch callback */
+    uint32_t             ts;       /*!< enqueue time in us, for the dispatch latency */
     void                 *param;   /*!< parameter area needs to be last */
 } bt_app_msg_t;
 
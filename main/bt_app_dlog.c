@@ -0,0 +1,315 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_dlog.c
+
+Overall Responsibility:
+Deferred binary logging. `ESP_LOGI` formats and writes to the UART in the calling task, which costs
+milliseconds on the HFP event and audio paths. `BT_APP_DLOG` only records a format id, a timestamp,
+up to four raw 32-bit arguments and the text of %s arguments; the line is produced later by a low
+priority drain task.
+
+Important Details:
+
+1. Formats:
+   - Declared in the BT_APP_DLOG_FORMATS X-macro list of `bt_app_dlog.h`, which generates the ids
+     and the format table. The host decoder reads the same list.
+   - Which arguments are %s is found from the format on the first record of each id and kept. Their
+     text is copied into the record (BT_APP_DLOG_STR_LEN bytes for all of them) and the argument
+     becomes the offset of the copy, so a string may be freed or changed as soon as the call returns.
+
+2. Per-task rings:
+   - Each logging task gets its own single-producer/single-consumer ring on first use (claimed from
+     a static pool with a compare-and-swap on the owner). The writer only advances `head` and the
+     drain task only advances `tail`, so there are no locks. A full ring drops the record and counts
+     it. Tasks that are deleted give their ring back with `bt_app_dlog_release` (through
+     `bt_app_tasks_delete`); the ring is reused once the drain task has emptied it. There is a ring
+     for every task of BT_APP_TASKS_TABLE and for the few stack and system tasks that log.
+
+3. Drain task:
+   - Runs at the lowest application priority every BT_APP_DLOG_DRAIN_PERIOD_MS. It formats each
+     record with the event timestamp ("@sec.ms") and emits it through ESP_LOG, or in raw mode prints
+     it as "DLOG:<hex>" lines for tools/dlog_decode.py, the copied text after the arguments.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_dlog.h"
+#include "bt_app_tasks.h"
+
+#define DLOG_RING_MASK            (BT_APP_DLOG_RING_LEN - 1)
+#define DLOG_OWNER_FREE           ((uintptr_t)0)
+#define DLOG_OWNER_RETIRING       ((uintptr_t)1)
+#define DLOG_LINE_MAX             (160)
+#define DLOG_STR_MASK_KNOWN       (0x80)
+
+#define BT_APP_DLOG_FMT_ENTRY(id, level, tag, fmt)  { level, tag, fmt },
+
+typedef struct {
+    esp_log_level_t level;
+    const char *tag;
+    const char *fmt;
+} dlog_fmt_t;
+
+typedef struct {
+    uint32_t ts_us;
+    uint8_t id;
+    uint8_t nargs;
+    uint8_t core;
+    uint8_t str_len;                /* bytes of str in use */
+    uint32_t args[BT_APP_DLOG_ARGS_MAX];    /* %s: offset into str */
+    char str[BT_APP_DLOG_STR_LEN];
+} dlog_rec_t;
+
+_Static_assert(BT_APP_DLOG_NUM <= UINT8_MAX, "dlog ids are stored in a byte");
+_Static_assert(BT_APP_DLOG_ARGS_MAX < 8, "the %s mask is a byte with a known flag");
+
+typedef struct {
+    atomic_uintptr_t owner;
+    atomic_uint_least32_t head;
+    atomic_uint_least32_t tail;
+    dlog_rec_t recs[BT_APP_DLOG_RING_LEN];
+} dlog_ring_t;
+
+static const dlog_fmt_t s_fmts[BT_APP_DLOG_NUM] = {
+    BT_APP_DLOG_FORMATS(BT_APP_DLOG_FMT_ENTRY)
+};
+
+static dlog_ring_t s_rings[BT_APP_DLOG_RINGS];
+/* per id: bit n set if argument n is %s, DLOG_STR_MASK_KNOWN once worked out */
+static atomic_uint_least8_t s_str_mask[BT_APP_DLOG_NUM];
+static atomic_uint_least32_t s_dropped;
+static volatile bool s_raw;
+static TaskHandle_t s_drain_task_handle;
+
+static dlog_ring_t *dlog_ring_get(void)
+{
+    uintptr_t self = (uintptr_t)xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < BT_APP_DLOG_RINGS; i++) {
+        if (atomic_load_explicit(&s_rings[i].owner, memory_order_relaxed) == self) {
+            return &s_rings[i];
+        }
+    }
+    for (int i = 0; i < BT_APP_DLOG_RINGS; i++) {
+        uintptr_t expected = DLOG_OWNER_FREE;
+        if (atomic_compare_exchange_strong(&s_rings[i].owner, &expected, self)) {
+            return &s_rings[i];
+        }
+    }
+    return NULL;
+}
+
+/* the next conversion character of fmt, *pos moved past it; 0 at the end */
+static char dlog_next_conv(const char **pos)
+{
+    const char *fmt = *pos;
+    while (*fmt) {
+        if (*fmt++ != '%') {
+            continue;
+        }
+        if (*fmt == '%') {
+            fmt++;
+            continue;
+        }
+        while (*fmt && strchr("diuxXcs", *fmt) == NULL) {
+            fmt++;
+        }
+        if (*fmt) {
+            *pos = fmt + 1;
+            return *fmt;
+        }
+    }
+    *pos = fmt;
+    return 0;
+}
+
+static uint32_t dlog_str_mask(bt_app_dlog_id_t id)
+{
+    uint32_t mask = atomic_load_explicit(&s_str_mask[id], memory_order_relaxed);
+    if (mask & DLOG_STR_MASK_KNOWN) {
+        return mask;
+    }
+    // racing writers work out the same value
+    const char *fmt = s_fmts[id].fmt;
+    mask = DLOG_STR_MASK_KNOWN;
+    for (uint32_t a = 0; a < BT_APP_DLOG_ARGS_MAX; a++) {
+        char conv = dlog_next_conv(&fmt);
+        if (conv == 0) {
+            break;
+        }
+        if (conv == 's') {
+            mask |= 1u << a;
+        }
+    }
+    atomic_store_explicit(&s_str_mask[id], mask, memory_order_relaxed);
+    return mask;
+}
+
+void bt_app_dlog_write(bt_app_dlog_id_t id, uint32_t nargs, const uintptr_t *args)
+{
+    dlog_ring_t *r = (xPortInIsrContext() || id >= BT_APP_DLOG_NUM) ? NULL : dlog_ring_get();
+    if (r == NULL) {
+        atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail >= BT_APP_DLOG_RING_LEN) {
+        atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    dlog_rec_t *rec = &r->recs[head & DLOG_RING_MASK];
+    rec->ts_us = (uint32_t)esp_timer_get_time();
+    rec->id = id;
+    rec->nargs = (nargs > BT_APP_DLOG_ARGS_MAX) ? BT_APP_DLOG_ARGS_MAX : nargs;
+    rec->core = xPortGetCoreID();
+    uint32_t mask = dlog_str_mask(id);
+    uint32_t o = 0;
+    for (uint32_t i = 0; i < rec->nargs; i++) {
+        if (!(mask & (1u << i))) {
+            rec->args[i] = (uint32_t)args[i];
+            continue;
+        }
+        // once str is full, later strings share its last NUL and come out empty
+        const char *s = args[i] ? (const char *)(uintptr_t)args[i] : "(null)";
+        uint32_t start = (o < BT_APP_DLOG_STR_LEN) ? o : BT_APP_DLOG_STR_LEN - 1;
+        uint32_t n = 0;
+        while (s[n] && start + n < BT_APP_DLOG_STR_LEN - 1) {
+            rec->str[start + n] = s[n];
+            n++;
+        }
+        rec->str[start + n] = '\0';
+        rec->args[i] = start;
+        o = start + n + 1;
+    }
+    rec->str_len = (o < BT_APP_DLOG_STR_LEN) ? o : BT_APP_DLOG_STR_LEN;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+void bt_app_dlog_release(TaskHandle_t task)
+{
+    for (int i = 0; i < BT_APP_DLOG_RINGS; i++) {
+        uintptr_t expected = (uintptr_t)task;
+        atomic_compare_exchange_strong(&s_rings[i].owner, &expected, DLOG_OWNER_RETIRING);
+    }
+}
+
+void bt_app_dlog_set_raw(bool raw)
+{
+    s_raw = raw;
+}
+
+uint32_t bt_app_dlog_dropped(void)
+{
+    return atomic_load_explicit(&s_dropped, memory_order_relaxed);
+}
+
+/* printf subset: one 32-bit argument per conversion, the type follows the conversion character */
+static void dlog_format(char *out, size_t len, const char *fmt, const dlog_rec_t *rec)
+{
+    size_t o = 0;
+    uint32_t a = 0;
+    while (*fmt && o < len - 1) {
+        if (*fmt != '%') {
+            out[o++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out[o++] = '%';
+            fmt += 2;
+            continue;
+        }
+        char spec[12];
+        size_t s = 0;
+        spec[s++] = *fmt++;
+        while (*fmt && strchr("diuxXcs", *fmt) == NULL && s < sizeof(spec) - 2) {
+            spec[s++] = *fmt++;
+        }
+        if (*fmt == '\0') {
+            break;
+        }
+        char conv = *fmt++;
+        spec[s++] = conv;
+        spec[s] = '\0';
+
+        uint32_t v = (a < rec->nargs) ? rec->args[a] : 0;
+        a++;
+        int n;
+        if (conv == 's') {
+            n = snprintf(out + o, len - o, spec, (v < rec->str_len) ? &rec->str[v] : "");
+        } else if (conv == 'd' || conv == 'i') {
+            n = snprintf(out + o, len - o, spec, (int)v);
+        } else {
+            n = snprintf(out + o, len - o, spec, (unsigned int)v);
+        }
+        if (n < 0) {
+            break;
+        }
+        o += n;
+        if (o >= len) {
+            o = len - 1;
+        }
+    }
+    out[o] = '\0';
+}
+
+static void dlog_emit(const dlog_rec_t *rec)
+{
+    if (s_raw) {
+        printf("DLOG:%08x%04x%02x%02x", (unsigned int)rec->ts_us, rec->id, rec->nargs, rec->core);
+        for (int i = 0; i < rec->nargs; i++) {
+            printf("%08x", (unsigned int)rec->args[i]);
+        }
+        for (int i = 0; i < rec->str_len; i++) {
+            printf("%02x", (unsigned char)rec->str[i]);
+        }
+        printf("\n");
+        return;
+    }
+
+    const dlog_fmt_t *f = &s_fmts[rec->id];
+    char line[DLOG_LINE_MAX];
+    dlog_format(line, sizeof(line), f->fmt, rec);
+    ESP_LOG_LEVEL(f->level, f->tag, "@%u.%03u %s", (unsigned int)(rec->ts_us / 1000000),
+                  (unsigned int)(rec->ts_us / 1000 % 1000), line);
+}
+
+static void bt_app_dlog_drain_task(void *arg)
+{
+    dlog_rec_t rec;
+    for (;;) {
+        for (int i = 0; i < BT_APP_DLOG_RINGS; i++) {
+            dlog_ring_t *r = &s_rings[i];
+            uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+            while (tail != atomic_load_explicit(&r->head, memory_order_acquire)) {
+                rec = r->recs[tail & DLOG_RING_MASK];
+                atomic_store_explicit(&r->tail, ++tail, memory_order_release);
+                dlog_emit(&rec);
+            }
+            uintptr_t expected = DLOG_OWNER_RETIRING;
+            atomic_compare_exchange_strong(&r->owner, &expected, DLOG_OWNER_FREE);
+        }
+        vTaskDelay(pdMS_TO_TICKS(BT_APP_DLOG_DRAIN_PERIOD_MS));
+    }
+}
+
+void bt_app_dlog_init(void)
+{
+    if (s_drain_task_handle) {
+        return;
+    }
+    bt_app_tasks_create(BT_APP_TASK_DLOG, bt_app_dlog_drain_task, NULL, &s_drain_task_handle);
+}
@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_DLOG_H__
+#define __BT_APP_DLOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_tasks.h"
+
+#define BT_APP_DLOG_TAG             "BT_APP_DLOG"
+
+/* tasks outside BT_APP_TASKS_TABLE that log: Bluedroid BTC and BTU, esp_timer, the console REPL */
+#define BT_APP_DLOG_FOREIGN_TASKS   (4)
+/* producer rings, one per logging task */
+#define BT_APP_DLOG_RINGS           (BT_APP_TASK_NUM + BT_APP_DLOG_FOREIGN_TASKS)
+/* records per ring, power of two */
+#define BT_APP_DLOG_RING_LEN        (32)
+#define BT_APP_DLOG_ARGS_MAX        (4)
+/* bytes of %s text a record holds, all its strings together, NUL terminators included */
+#define BT_APP_DLOG_STR_LEN         (24)
+#define BT_APP_DLOG_DRAIN_PERIOD_MS (50)
+
+/*
+ * Deferred log formats: X(id, level, tag, fmt)
+ * Conversions are limited to %d %i %u %x %X %c and %s, one argument each. The text of %s arguments
+ * is copied into the record when it is written, cut to what is left of BT_APP_DLOG_STR_LEN.
+ * tools/dlog_decode.py parses this list, keep one entry per line.
+ */
+#define BT_APP_DLOG_FORMATS(X) \
+    X(HF_EVT,           ESP_LOG_INFO,  "BT_APP_HF",   "APP HFP event: %s") \
+    X(HF_EVT_INVALID,   ESP_LOG_ERROR, "BT_APP_HF",   "APP HFP invalid event %d") \
+    X(HF_CONN_STATE,    ESP_LOG_INFO,  "BT_APP_HF",   "--connection state %s, peer feats 0x%x, chld_feats 0x%x") \
+    X(HF_AUDIO_STATE,   ESP_LOG_INFO,  "BT_APP_HF",   "--Audio State %s") \
+    X(HF_VOLUME,        ESP_LOG_INFO,  "BT_APP_HF",   "--Volume Target: %s, Volume %d") \
+    X(HF_SPEED,         ESP_LOG_INFO,  "BT_APP_HF",   "speed(%u ms ~ %u ms): %u bit/s") \
+    X(HF_PLC,           ESP_LOG_INFO,  "BT_APP_HF",   "plc: concealed %u (missing %u, bad %u), max burst %u") \
+    X(HF_RB_SEND_FAIL,  ESP_LOG_ERROR, "BT_APP_HF",   "rb send fail") \
+    X(CALL_STATE,       ESP_LOG_INFO,  "BT_APP_CALL", "call %s -> %s") \
+    X(CALL_TALK,        ESP_LOG_INFO,  "BT_APP_CALL", "call audio up %u ms after active") \
+    X(CORE_SEND_FAIL,   ESP_LOG_ERROR, "BT_APP_CORE", "bt_app_send_msg xQueue send failed") \
+    X(MEM_STACK_LOW,    ESP_LOG_WARN,  "BT_APP_MEM",  "stack of %s down to %u bytes") \
+    X(MEM_HEAP_LOW,     ESP_LOG_WARN,  "BT_APP_MEM",  "heap free %u bytes, lowest %u") \
+    X(MEM_HEAP_FRAG,    ESP_LOG_WARN,  "BT_APP_MEM",  "heap fragmented: largest block %u of %u free")
+
+#define BT_APP_DLOG_ENUM(id, level, tag, fmt)   BT_APP_DLOG_##id,
+
+typedef enum {
+    BT_APP_DLOG_FORMATS(BT_APP_DLOG_ENUM)
+    BT_APP_DLOG_NUM
+} bt_app_dlog_id_t;
+
+/* cast a string for use as a deferred argument */
+#define BT_APP_DLOG_STR(s)          ((uintptr_t)(s))
+
+/**
+ * @brief     log a deferred record: BT_APP_DLOG(HF_SPEED, from_ms, to_ms, bps)
+ *
+ *            Costs a ring lookup and a copy of the arguments and of the text of %s arguments,
+ *            formatting happens later in the drain task.
+ */
+#define BT_APP_DLOG(id, ...) \
+    bt_app_dlog_write(BT_APP_DLOG_##id, \
+                      sizeof((uintptr_t[]){0, ##__VA_ARGS__}) / sizeof(uintptr_t) - 1, \
+                      (const uintptr_t[]){0, ##__VA_ARGS__} + 1)
+
+/* args are pointer wide so %s arguments survive on a 64-bit host; numbers are kept as 32 bits */
+void bt_app_dlog_write(bt_app_dlog_id_t id, uint32_t nargs, const uintptr_t *args);
+
+/**
+ * @brief     start the low priority drain task
+ */
+void bt_app_dlog_init(void);
+
+/**
+ * @brief     give the ring of a task back before the task is deleted
+ */
+void bt_app_dlog_release(TaskHandle_t task);
+
+/**
+ * @brief     raw mode: the drain task prints records as "DLOG:<hex>" for tools/dlog_decode.py
+ *            instead of formatting them
+ */
+void bt_app_dlog_set_raw(bool raw);
+
+uint32_t bt_app_dlog_dropped(void);
+
+#endif /* __BT_APP_DLOG_H__ */
@@ -0,0 +1,178 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_floor.c
+
+Overall Responsibility:
+Push-to-talk floor control for the intercom. A tap on an earbud sends AT+BVRA (voice recognition
+on/off); here that toggle means "this peer wants to talk" and "done talking". One peer holds the
+floor at a time, and in half-duplex mode the audio path only runs the direction of the talker.
+
+Important Details:
+
+1. Floor:
+   - AT+BVRA=1 (or `floor take`) asks for the floor. It is granted when nobody holds it, or the
+     asking peer already does. A request while another peer talks is a collision: it is denied and
+     the earbud is told with +BVRA: 0, so its voice recognition state goes back off.
+   - AT+BVRA=0, `floor release` or an SLC disconnect frees the floor.
+
+2. Gates:
+   - `bt_app_floor_gates` holds one bit per direction of the audio peer (the peer with the SCO
+     link), read with a relaxed load in the audio callbacks. Full duplex keeps both open. Half
+     duplex opens RX (microphone) only while the audio peer holds the floor and TX (speaker) only
+     while it does not, so the callbacks skip the other direction without touching its data.
+
+3. Latency:
+   - From a grant to the first frame from the talker passing the gate (HCI data path), or to audio
+     connected when the grant had to bring audio up. Kept as last and max and in the
+     floor.talk_ms histogram; grants, collisions and gated frames are counters in `metrics`.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "bt_app_floor.h"
+#include "bt_app_metrics.h"
+
+atomic_uint_least32_t bt_app_floor_gates = BT_APP_FLOOR_GATE_RX | BT_APP_FLOOR_GATE_TX;
+
+static portMUX_TYPE s_floor_lock = portMUX_INITIALIZER_UNLOCKED;
+static bt_app_floor_stats_t s_floor;
+static bool s_audio_up;
+static esp_bd_addr_t s_audio_peer;
+static int64_t s_grant_us;
+
+/* called with s_floor_lock held */
+static void bt_app_floor_update_gates(void)
+{
+    uint32_t gates = atomic_load_explicit(&bt_app_floor_gates, memory_order_relaxed) & BT_APP_FLOOR_GATE_TALK;
+    if (s_floor.mode == BT_APP_FLOOR_FULL_DUPLEX) {
+        gates |= BT_APP_FLOOR_GATE_RX | BT_APP_FLOOR_GATE_TX;
+    } else if (s_floor.held && memcmp(s_floor.holder, s_audio_peer, ESP_BD_ADDR_LEN) == 0) {
+        gates |= BT_APP_FLOOR_GATE_RX;
+    } else {
+        gates |= BT_APP_FLOOR_GATE_TX;
+    }
+    atomic_store_explicit(&bt_app_floor_gates, gates, memory_order_relaxed);
+}
+
+/* called with s_floor_lock held */
+static void bt_app_floor_talk_record(void)
+{
+    uint32_t talk_ms = (uint32_t)((esp_timer_get_time() - s_grant_us) / 1000);
+    atomic_fetch_and_explicit(&bt_app_floor_gates, ~BT_APP_FLOOR_GATE_TALK, memory_order_relaxed);
+    s_floor.talk_ms_last = talk_ms;
+    if (talk_ms > s_floor.talk_ms_max) {
+        s_floor.talk_ms_max = talk_ms;
+    }
+    bt_app_metrics_hist_record(BT_APP_METRIC_FLOOR_TALK_MS, talk_ms);
+}
+
+void bt_app_floor_talk_started(void)
+{
+    portENTER_CRITICAL_SAFE(&s_floor_lock);
+    if (atomic_load_explicit(&bt_app_floor_gates, memory_order_relaxed) & BT_APP_FLOOR_GATE_TALK) {
+        bt_app_floor_talk_record();
+    }
+    portEXIT_CRITICAL_SAFE(&s_floor_lock);
+}
+
+bool bt_app_floor_request(esp_bd_addr_t bda)
+{
+    bool audio_connect = false;
+
+    portENTER_CRITICAL(&s_floor_lock);
+    s_floor.requests++;
+    if (s_floor.held && memcmp(s_floor.holder, bda, ESP_BD_ADDR_LEN) != 0) {
+        s_floor.collisions++;
+        portEXIT_CRITICAL(&s_floor_lock);
+        bt_app_metrics_inc(BT_APP_METRIC_FLOOR_COLLISIONS);
+        return false;
+    }
+    if (!s_floor.held) {
+        s_floor.held = true;
+        s_floor.grants++;
+        memcpy(s_floor.holder, bda, ESP_BD_ADDR_LEN);
+        s_grant_us = esp_timer_get_time();
+        atomic_fetch_or_explicit(&bt_app_floor_gates, BT_APP_FLOOR_GATE_TALK, memory_order_relaxed);
+        audio_connect = !s_audio_up;
+        bt_app_floor_update_gates();
+        bt_app_metrics_inc(BT_APP_METRIC_FLOOR_GRANTS);
+    }
+    portEXIT_CRITICAL(&s_floor_lock);
+
+    if (audio_connect) {
+        esp_hf_ag_audio_connect(bda);
+    }
+    return true;
+}
+
+void bt_app_floor_release(esp_bd_addr_t bda)
+{
+    portENTER_CRITICAL(&s_floor_lock);
+    if (s_floor.held && memcmp(s_floor.holder, bda, ESP_BD_ADDR_LEN) == 0) {
+        s_floor.held = false;
+        s_floor.releases++;
+        atomic_fetch_and_explicit(&bt_app_floor_gates, ~BT_APP_FLOOR_GATE_TALK, memory_order_relaxed);
+        bt_app_floor_update_gates();
+    }
+    portEXIT_CRITICAL(&s_floor_lock);
+}
+
+void bt_app_floor_on_bvra(esp_bd_addr_t bda, bool on)
+{
+    if (!on) {
+        bt_app_floor_release(bda);
+        return;
+    }
+    if (!bt_app_floor_request(bda)) {
+        ESP_LOGI(BT_APP_FLOOR_TAG, "floor busy, request denied");
+        esp_hf_ag_vra_control(bda, 0);
+    }
+}
+
+void bt_app_floor_set_mode(bt_app_floor_mode_t mode)
+{
+    portENTER_CRITICAL(&s_floor_lock);
+    s_floor.mode = mode;
+    bt_app_floor_update_gates();
+    portEXIT_CRITICAL(&s_floor_lock);
+}
+
+void bt_app_floor_on_audio(esp_bd_addr_t bda, bool connected)
+{
+    portENTER_CRITICAL(&s_floor_lock);
+    s_audio_up = connected;
+    if (connected) {
+        memcpy(s_audio_peer, bda, ESP_BD_ADDR_LEN);
+#if !CONFIG_BT_HFP_AUDIO_DATA_PATH_HCI
+        // no frame will pass through here, audio up is as close as it gets
+        if (atomic_load_explicit(&bt_app_floor_gates, memory_order_relaxed) & BT_APP_FLOOR_GATE_TALK) {
+            bt_app_floor_talk_record();
+        }
+#endif
+    }
+    bt_app_floor_update_gates();
+    portEXIT_CRITICAL(&s_floor_lock);
+}
+
+void bt_app_floor_on_disconnect(esp_bd_addr_t bda)
+{
+    bt_app_floor_release(bda);
+}
+
+void bt_app_floor_get_stats(bt_app_floor_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_floor_lock);
+    *stats = s_floor;
+    portEXIT_CRITICAL(&s_floor_lock);
+}
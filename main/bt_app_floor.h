@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_FLOOR_H__
+#define __BT_APP_FLOOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "esp_bt_defs.h"
+
+#define BT_APP_FLOOR_TAG            "BT_APP_FLOOR"
+
+typedef enum {
+    BT_APP_FLOOR_FULL_DUPLEX = 0,   /*!< both directions always run, the floor is only tracked */
+    BT_APP_FLOOR_HALF_DUPLEX,       /*!< only the direction of the current talker runs */
+} bt_app_floor_mode_t;
+
+/* bits of bt_app_floor_gates, read by the audio callbacks */
+#define BT_APP_FLOOR_GATE_RX        (1u << 0)   /* audio from the HF (its microphone) is processed */
+#define BT_APP_FLOOR_GATE_TX        (1u << 1)   /* audio to the HF (its speaker) is produced */
+#define BT_APP_FLOOR_GATE_TALK      (1u << 2)   /* waiting for the first frame after a grant */
+
+typedef struct {
+    bt_app_floor_mode_t mode;
+    bool held;
+    esp_bd_addr_t holder;
+    uint32_t requests;
+    uint32_t grants;
+    uint32_t collisions;            /*!< requests while another peer held the floor, denied */
+    uint32_t releases;
+    uint32_t talk_ms_last;          /*!< grant to the first frame from the talker (or audio up) */
+    uint32_t talk_ms_max;
+} bt_app_floor_stats_t;
+
+extern atomic_uint_least32_t bt_app_floor_gates;
+
+static inline bool bt_app_floor_rx_open(void)
+{
+    return atomic_load_explicit(&bt_app_floor_gates, memory_order_relaxed) & BT_APP_FLOOR_GATE_RX;
+}
+
+static inline bool bt_app_floor_tx_open(void)
+{
+    return atomic_load_explicit(&bt_app_floor_gates, memory_order_relaxed) & BT_APP_FLOOR_GATE_TX;
+}
+
+/**
+ * @brief     a frame from the HF passed the gate, closes the grant latency measurement
+ */
+void bt_app_floor_talk_started(void);
+
+static inline void bt_app_floor_on_rx_frame(void)
+{
+    if (atomic_load_explicit(&bt_app_floor_gates, memory_order_relaxed) & BT_APP_FLOOR_GATE_TALK) {
+        bt_app_floor_talk_started();
+    }
+}
+
+/**
+ * @brief     ask for the floor (AT+BVRA=1 or the button)
+ *
+ * @return    true if granted, false if another peer holds it
+ */
+bool bt_app_floor_request(esp_bd_addr_t bda);
+
+/**
+ * @brief     give the floor back (AT+BVRA=0 or the button), nothing happens if bda does not hold it
+ */
+void bt_app_floor_release(esp_bd_addr_t bda);
+
+/**
+ * @brief     ESP_HF_BVRA_RESPONSE_EVT: a tap on the earbud; a denied request is answered with +BVRA: 0
+ */
+void bt_app_floor_on_bvra(esp_bd_addr_t bda, bool on);
+
+void bt_app_floor_set_mode(bt_app_floor_mode_t mode);
+
+/**
+ * @brief     audio connection of a peer, the gates apply to the peer with audio
+ */
+void bt_app_floor_on_audio(esp_bd_addr_t bda, bool connected);
+
+/**
+ * @brief     SLC of a peer is gone, it loses the floor
+ */
+void bt_app_floor_on_disconnect(esp_bd_addr_t bda);
+
+void bt_app_floor_get_stats(bt_app_floor_stats_t *stats);
+
+#endif /* __BT_APP_FLOOR_H__ */
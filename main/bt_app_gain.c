@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_gain.c
+
+Overall Responsibility:
+Digital gain stage for the audio sent to (outgoing) and received from (incoming) the HF device.
+The HFP volume levels reported by ESP_HF_VOLUME_CONTROL_EVT or set with the `vu` command are
+turned into a real gain on the PCM samples.
+
+Important Details:
+
+1. Gain table:
+   - `s_gain_q15` holds the precomputed Q15 gain of the 16 HFP volume steps, 2 dB per step,
+     level 15 is unity and level 0 is -30 dB. Unity is 32768, so the table is unsigned and level 15
+     turns into exactly GAIN_Q14_ONE, which skips the frame.
+
+2. Ramps:
+   - A level change never jumps. The applied gain moves linearly from the old to the new value
+     across the next frame, which avoids the "zipper" noise of a gain step in the middle of speech.
+
+3. AGC (optional, BT_APP_GAIN_AGC_ENABLE, switched per path with `vu agc`):
+   - Tracks the mean absolute level of each frame with a fast attack / slow release envelope and
+     derives a makeup gain (0.25x .. 4x) that pulls quiet and loud talkers towards the same level.
+   - Below the noise floor the AGC gain is held so that background noise is not amplified.
+
+4. Processing:
+   - `bt_app_gain_process` works on a whole frame at a time. The inner loops are plain
+     multiply/shift/saturate loops without branches on the sample value, so the compiler can
+     unroll or vectorize them.
+   - Only the outgoing path is processed today. The incoming level and AGC switch are kept for the
+     sink that will play the HF's audio; until then nothing consumes those samples.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "bt_app_gain.h"
+
+/* working gain is Q14 so that the AGC can boost up to 4x without overflowing a 32-bit product */
+#define GAIN_Q14_ONE              (16384)
+#define GAIN_Q14_MAX              (65535)
+
+#define AGC_Q12_ONE               (4096)
+#define AGC_Q12_MIN               (AGC_Q12_ONE / 4)
+#define AGC_Q12_MAX               (AGC_Q12_ONE * 4)
+#define AGC_TARGET_LEVEL          (3000)    /* mean absolute sample value, about -20 dBFS */
+#define AGC_NOISE_FLOOR           (100)     /* below this the AGC gain is held */
+#define AGC_ATTACK_SHIFT          (1)
+#define AGC_RELEASE_SHIFT         (4)
+#define AGC_SMOOTH_SHIFT          (3)
+
+/* 32768 * 10^(-(15 - level) * 2 / 20) */
+static const uint16_t s_gain_q15[BT_APP_GAIN_LEVEL_NUM] = {
+     1036,  1305,  1642,  2068,  2603,  3277,  4125,  5193,
+     6538,  8231, 10362, 13045, 16423, 20675, 26029, 32768,
+};
+
+typedef struct {
+    volatile int level;
+    volatile bool agc_enabled;
+    int32_t cur_q14;        /* gain applied at the end of the last frame */
+    int32_t agc_q12;
+    int32_t env;
+} gain_path_t;
+
+static gain_path_t s_path[BT_APP_GAIN_PATH_NUM];
+
+void bt_app_gain_init(void)
+{
+    memset(s_path, 0, sizeof(s_path));
+    for (int i = 0; i < BT_APP_GAIN_PATH_NUM; i++) {
+        s_path[i].level = BT_APP_GAIN_LEVEL_MAX;
+        s_path[i].cur_q14 = GAIN_Q14_ONE;
+        s_path[i].agc_q12 = AGC_Q12_ONE;
+    }
+}
+
+uint16_t bt_app_gain_level_to_q15(int level)
+{
+    if (level < BT_APP_GAIN_LEVEL_MIN) {
+        level = BT_APP_GAIN_LEVEL_MIN;
+    } else if (level > BT_APP_GAIN_LEVEL_MAX) {
+        level = BT_APP_GAIN_LEVEL_MAX;
+    }
+    return s_gain_q15[level];
+}
+
+void bt_app_gain_set_level(bt_app_gain_path_t path, int level)
+{
+    if (path >= BT_APP_GAIN_PATH_NUM) {
+        return;
+    }
+    if (level < BT_APP_GAIN_LEVEL_MIN || level > BT_APP_GAIN_LEVEL_MAX) {
+        ESP_LOGW(BT_APP_GAIN_TAG, "%s invalid level %d", __func__, level);
+        return;
+    }
+    s_path[path].level = level;
+}
+
+int bt_app_gain_get_level(bt_app_gain_path_t path)
+{
+    if (path >= BT_APP_GAIN_PATH_NUM) {
+        return -1;
+    }
+    return s_path[path].level;
+}
+
+void bt_app_gain_agc_enable(bt_app_gain_path_t path, bool enable)
+{
+    if (path >= BT_APP_GAIN_PATH_NUM) {
+        return;
+    }
+    s_path[path].agc_enabled = enable;
+}
+
+bool bt_app_gain_agc_enabled(bt_app_gain_path_t path)
+{
+    return (path < BT_APP_GAIN_PATH_NUM) && s_path[path].agc_enabled;
+}
+
+#if BT_APP_GAIN_AGC_ENABLE
+static void agc_update(gain_path_t *p, const int16_t *samples, uint32_t num)
+{
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        int32_t s = samples[i];
+        sum += (s < 0) ? -s : s;
+    }
+    int32_t level = sum / (int32_t)num;
+
+    if (level > p->env) {
+        p->env += (level - p->env) >> AGC_ATTACK_SHIFT;
+    } else {
+        p->env += (level - p->env) >> AGC_RELEASE_SHIFT;
+    }
+
+    if (p->env < AGC_NOISE_FLOOR) {
+        return;
+    }
+
+    int32_t desired = AGC_TARGET_LEVEL * AGC_Q12_ONE / p->env;
+    if (desired < AGC_Q12_MIN) {
+        desired = AGC_Q12_MIN;
+    } else if (desired > AGC_Q12_MAX) {
+        desired = AGC_Q12_MAX;
+    }
+    p->agc_q12 += (desired - p->agc_q12) >> AGC_SMOOTH_SHIFT;
+}
+#endif /* BT_APP_GAIN_AGC_ENABLE */
+
+static inline int16_t sat16(int32_t v)
+{
+    if (v > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+void bt_app_gain_process(bt_app_gain_path_t path, int16_t *samples, uint32_t num)
+{
+    if (path >= BT_APP_GAIN_PATH_NUM || samples == NULL || num == 0) {
+        return;
+    }
+    gain_path_t *p = &s_path[path];
+
+    int32_t target = s_gain_q15[p->level] >> 1;
+#if BT_APP_GAIN_AGC_ENABLE
+    if (p->agc_enabled) {
+        agc_update(p, samples, num);
+        target = (target * p->agc_q12) >> 12;
+    }
+#endif /* BT_APP_GAIN_AGC_ENABLE */
+    if (target > GAIN_Q14_MAX) {
+        target = GAIN_Q14_MAX;
+    }
+
+    int32_t cur = p->cur_q14;
+    if (cur == target) {
+        if (target == GAIN_Q14_ONE) {
+            return;
+        }
+        for (uint32_t i = 0; i < num; i++) {
+            samples[i] = sat16((samples[i] * target) >> 14);
+        }
+        return;
+    }
+
+    /* linear ramp across the frame, the gain accumulator carries 8 fractional bits; the
+       difference can be negative, so it is scaled with a multiply rather than a shift */
+    int32_t acc = cur * 256;
+    int32_t step = (target - cur) * 256 / (int32_t)num;
+    for (uint32_t i = 0; i < num; i++) {
+        acc += step;
+        samples[i] = sat16((samples[i] * (acc >> 8)) >> 14);
+    }
+    p->cur_q14 = target;
+}
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_GAIN_H__
+#define __BT_APP_GAIN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BT_APP_GAIN_TAG             "BT_APP_GAIN"
+
+/* build the automatic gain control stage, it is still off until `vu agc on` */
+#define BT_APP_GAIN_AGC_ENABLE      1
+
+/* HFP volume levels (AT+VGS / AT+VGM) range from 0 to 15 */
+#define BT_APP_GAIN_LEVEL_MIN       (0)
+#define BT_APP_GAIN_LEVEL_MAX       (15)
+#define BT_APP_GAIN_LEVEL_NUM       (BT_APP_GAIN_LEVEL_MAX + 1)
+
+/* Q15 unity gain, one more than INT16_MAX so that level 15 is exactly unity */
+#define BT_APP_GAIN_Q15_ONE         (32768)
+
+typedef enum {
+    BT_APP_GAIN_PATH_OUTGOING = 0,  /*!< AG -> HF audio, follows the speaker gain (AT+VGS) */
+    BT_APP_GAIN_PATH_INCOMING,      /*!< HF -> AG audio, follows the microphone gain (AT+VGM) */
+    BT_APP_GAIN_PATH_NUM,
+} bt_app_gain_path_t;
+
+/**
+ * @brief     reset both paths to the maximum HFP level with AGC disabled
+ */
+void bt_app_gain_init(void);
+
+/**
+ * @brief     Q15 gain of an HFP volume level, 2 dB per step, level 15 is unity
+ */
+uint16_t bt_app_gain_level_to_q15(int level);
+
+/**
+ * @brief     set the HFP volume level of a path, the applied gain ramps to it over one frame
+ */
+void bt_app_gain_set_level(bt_app_gain_path_t path, int level);
+
+int bt_app_gain_get_level(bt_app_gain_path_t path);
+
+/**
+ * @brief     turn the AGC stage of a path on or off (no effect unless BT_APP_GAIN_AGC_ENABLE)
+ */
+void bt_app_gain_agc_enable(bt_app_gain_path_t path, bool enable);
+
+bool bt_app_gain_agc_enabled(bt_app_gain_path_t path);
+
+/**
+ * @brief     apply gain (and AGC) in place to one frame of 16-bit PCM samples
+ */
+void bt_app_gain_process(bt_app_gain_path_t path, int16_t *samples, uint32_t num);
+
+#endif /* __BT_APP_GAIN_H__ */
@@ -28,6 +28,17 @@ Here are the main points about the code:
     - The sine wave data is stored in `sine_int16` array, and there are functions to send audio data 
     (`bt_app_send_data`), handle the periodic sending of audio data (`bt_app_send_data_task`), 
     and shut down the send data task (`bt_app_send_data_shut_down`).
+    - The send task wakes on a task notification from a periodic esp_timer at the 7.5 ms block
+    boundary and counts due blocks from a bt_app_time deadline, so the tick rate plays no part;
+    how late each wakeup was goes to the hf.gen_late_us histogram.
+    - Each block is generated into a scratch block of the session and sent on its own, so the
+    generator does not allocate. With BT_APP_MEM_STATIC the task, the ring (on static storage)
+    and the timer are made once by `bt_app_hf_audio_init` when the stack comes up; an audio
+    connect then drains the ring, restarts the deadline and starts the timer, a disconnect stops
+    the timer. Without it they are created on every connect and deleted on disconnect.
+    - Incoming audio is counted and goes through the PLC loss detection, but nothing on this board
+    plays it. The PLC therefore runs measurement only (no output callback): the HF_PLC record
+    reports the losses, no concealment is synthesized and no incoming gain is applied.
 
 4. Bluetooth Event Callback: 
     - The main function of interest in the file is `bt_app_hf_cb`, which acts as a callback to 
@@ -71,9 +82,22 @@ part if you're using HCI for audio data path.
 #include "time.h"
 #include "sys/time.h"
 #include "sdkconfig.h"
+#include "bt_app_call.h"
 #include "bt_app_core.h"
 #include "bt_app_hf.h"
-#include "osi/allocator.h"
+#include "bt_app_gain.h"
+#include "bt_app_ind.h"
+#include "bt_app_plc.h"
+#include "bt_app_link.h"
+#include "bt_app_metrics.h"
+#include "bt_app_dlog.h"
+#include "bt_app_floor.h"
+#include "bt_app_trace.h"
+#include "bt_app_time.h"
+#include "bt_app_tasks.h"
+#include "bt_app_mem.h"
+#include "app_hf_msg_bin.h"
+#include "app_hf_msg_scr.h"
 
 const char *c_hf_evt_str[] = {
     "CONNECTION_STATE_EVT",              /*!< SERVICE LEVEL CONNECTION STATE CONTROL */
@@ -188,35 +212,72 @@ static const int16_t sine_int16[TABLE_SIZE] = {
 #define WBS_PCM_INPUT_DATA_SIZE  (WBS_PCM_SAMPLING_RATE_KHZ * PCM_BLOCK_DURATION_US / 1000 * BYTES_PER_SAMPLE) //240
 #define PCM_INPUT_DATA_SIZE      (PCM_SAMPLING_RATE_KHZ * PCM_BLOCK_DURATION_US / 1000 * BYTES_PER_SAMPLE)     //120
 
-#define PCM_GENERATOR_TICK_US        (4000)
-
-static long s_data_num = 0;
-static RingbufHandle_t s_m_rb = NULL;
-static uint64_t s_time_new, s_time_old;
-static esp_timer_handle_t s_periodic_timer;
-static uint64_t s_last_enter_time, s_now_enter_time;
-static uint64_t s_us_duration;
-static SemaphoreHandle_t s_send_data_Semaphore = NULL;
-static TaskHandle_t s_bt_app_send_data_task_handler = NULL;
-static esp_hf_audio_state_t s_audio_code;
+/*
+ * One audio session: everything the data callbacks and the generator task work on, reset on each
+ * audio connect.
+ */
+typedef struct {
+    RingbufHandle_t rb;
+    TaskHandle_t task;
+    esp_timer_handle_t timer;               /* one period per block, notifies the generator task */
+    esp_hf_audio_state_t audio_code;
+    uint64_t last_in_us;
+    uint64_t last_out_us;
+    bt_app_time_deadline_t gen;             /* generator: end of the next block to produce */
+    uint64_t speed_start_us;
+    uint64_t speed_end_us;
+    long speed_bytes;
+    volatile bool running;                  /* between audio connect and disconnect */
+    bool rx_gated;                          /* the floor gate dropped the last incoming frame */
+    // scratch copy of the incoming frame, processed before it is handed on
+    int16_t frame[WBS_PCM_INPUT_DATA_SIZE / BYTES_PER_SAMPLE];
+    // one generated block on its way into the ring
+    uint8_t gen_block[WBS_PCM_INPUT_DATA_SIZE];
+} bt_app_hf_session_t;
+
+static bt_app_hf_session_t s_session;
+#if BT_APP_MEM_STATIC
+static StaticRingbuffer_t s_rb_buf;
+static uint8_t s_rb_storage[ESP_HFP_RINGBUF_SIZE];
+#endif
 
-static void print_speed(void);
+static void print_speed(bt_app_hf_session_t *ss);
 
 static uint32_t bt_app_hf_outgoing_cb(uint8_t *p_buf, uint32_t sz)
 {
+    bt_app_hf_session_t *ss = &s_session;
     size_t item_size = 0;
     uint8_t *data;
-    if (!s_m_rb) {
+    if (!ss->rb) {
         return 0;
     }
-    vRingbufferGetInfo(s_m_rb, NULL, NULL, NULL, NULL, &item_size);
+    BT_APP_TRACE_BEGIN(SCO_OUT, 0, sz);
+    uint64_t now_us = esp_timer_get_time();
+    bt_app_metrics_hist_record(BT_APP_METRIC_SCO_OUT_INTERVAL_US, (uint32_t)(now_us - ss->last_out_us));
+    ss->last_out_us = now_us;
+    if (!bt_app_floor_tx_open()) {
+        // half duplex and the HF has the floor: silence, nothing is read or processed
+        memset(p_buf, 0, sz);
+        bt_app_metrics_inc(BT_APP_METRIC_FLOOR_GATED_FRAMES);
+        BT_APP_TRACE_END(SCO_OUT, 0, 0);
+        return sz;
+    }
+    vRingbufferGetInfo(ss->rb, NULL, NULL, NULL, NULL, &item_size);
     if (item_size >= sz) {
-        data = xRingbufferReceiveUpTo(s_m_rb, &item_size, 0, sz);
+        data = xRingbufferReceiveUpTo(ss->rb, &item_size, 0, sz);
         memcpy(p_buf, data, item_size);
-        vRingbufferReturnItem(s_m_rb, data);
+        vRingbufferReturnItem(ss->rb, data);
+        bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, (int16_t *)p_buf, item_size / BYTES_PER_SAMPLE);
+        bt_app_metrics_inc(BT_APP_METRIC_SCO_OUT_FRAMES);
+        bt_app_metrics_add(BT_APP_METRIC_SCO_OUT_BYTES, sz);
+        bt_app_metrics_add(BT_APP_METRIC_RB_CONSUMED_BYTES, item_size);
+        BT_APP_TRACE_END(SCO_OUT, 0, item_size);
         return sz;
     } else {
         // data not enough, do not read\n
+        bt_app_metrics_inc(BT_APP_METRIC_RB_UNDERRUN);
+        BT_APP_TRACE_INSTANT(RB, BT_APP_TRACE_RB_UNDERRUN, item_size);
+        BT_APP_TRACE_END(SCO_OUT, 0, 0);
         return 0;
     }
     return 0;
@@ -224,11 +285,38 @@ static uint32_t bt_app_hf_outgoing_cb(uint8_t *p_buf, uint32_t sz)
 
 static void bt_app_hf_incoming_cb(const uint8_t *buf, uint32_t sz)
 {
-    s_time_new = esp_timer_get_time();
-    s_data_num += sz;
-    if ((s_time_new - s_time_old) >= 3000000) {
-        print_speed();
+    bt_app_hf_session_t *ss = &s_session;
+    uint32_t len = (sz > sizeof(ss->frame)) ? sizeof(ss->frame) : sz;
+    uint32_t num = len / BYTES_PER_SAMPLE;
+    uint64_t now_us = esp_timer_get_time();
+    BT_APP_TRACE_BEGIN(SCO_IN, 0, sz);
+
+    bt_app_metrics_hist_record(BT_APP_METRIC_SCO_IN_INTERVAL_US, (uint32_t)(now_us - ss->last_in_us));
+    ss->last_in_us = now_us;
+    bt_app_metrics_inc(BT_APP_METRIC_SCO_IN_FRAMES);
+    bt_app_metrics_add(BT_APP_METRIC_SCO_IN_BYTES, sz);
+    if (bt_app_floor_rx_open()) {
+        ss->rx_gated = false;
+        bt_app_floor_on_rx_frame();
+        memcpy(ss->frame, buf, len);
+        // the stack decodes a lost or bad packet to silence and passes no status
+        bt_app_plc_process(ss->frame, num, now_us, bt_app_plc_frame_is_lost(ss->frame, num));
+    } else {
+        // half duplex and the HF is listening; the gap is not a loss, so PLC starts over
+        if (!ss->rx_gated) {
+            ss->rx_gated = true;
+            bt_app_plc_reset();
+        }
+        bt_app_metrics_inc(BT_APP_METRIC_FLOOR_GATED_FRAMES);
     }
+
+    ss->speed_bytes += sz;
+    bt_app_link_add_rx_bytes(sz);
+    ss->speed_end_us = now_us;
+    if ((ss->speed_end_us - ss->speed_start_us) >= 3000000) {
+        print_speed(ss);
+    }
+    BT_APP_TRACE_END(SCO_IN, 0, sz);
 }
 
 static uint32_t bt_app_hf_create_audio_data(uint8_t *p_buf, uint32_t sz)
@@ -245,103 +333,163 @@ static uint32_t bt_app_hf_create_audio_data(uint8_t *p_buf, uint32_t sz)
     return sz;
 }
 
-static void print_speed(void)
+static void print_speed(bt_app_hf_session_t *ss)
 {
-    float tick_s = (s_time_new - s_time_old) / 1000000.0;
-    float speed = s_data_num * 8 / tick_s / 1000.0;
-    ESP_LOGI(BT_HF_TAG, "speed(%fs ~ %fs): %f kbit/s" , s_time_old / 1000000.0, s_time_new / 1000000.0, speed);
-    s_data_num = 0;
-    s_time_old = s_time_new;
+    uint64_t tick_us = ss->speed_end_us - ss->speed_start_us;
+    uint32_t speed_bps = tick_us ? (uint32_t)((uint64_t)ss->speed_bytes * 8 * 1000000 / tick_us) : 0;
+    BT_APP_DLOG(HF_SPEED, (uint32_t)(ss->speed_start_us / 1000), (uint32_t)(ss->speed_end_us / 1000), speed_bps);
+    bt_app_plc_stats_t plc;
+    bt_app_plc_get_stats(&plc);
+    BT_APP_DLOG(HF_PLC, plc.frames_concealed, plc.frames_missing, plc.frames_bad, plc.max_burst);
+    ss->speed_bytes = 0;
+    ss->speed_start_us = ss->speed_end_us;
 }
 
 static void bt_app_send_data_timer_cb(void *arg)
 {
-    if (!xSemaphoreGive(s_send_data_Semaphore)) {
-        ESP_LOGE(BT_HF_TAG, "%s xSemaphoreGive failed", __func__);
-        return;
-    }
-    return;
+    bt_app_hf_session_t *ss = (bt_app_hf_session_t *)arg;
+    xTaskNotifyGive(ss->task);
 }
 
 static void bt_app_send_data_task(void *arg)
 {
-    uint64_t frame_data_num;
+    bt_app_hf_session_t *ss = (bt_app_hf_session_t *)arg;
+    uint32_t block_size;
+    uint32_t blocks;
+    uint32_t sent;
+    int64_t late_us = 0;
     size_t item_size = 0;
-    uint8_t *buf = NULL;
     for (;;) {
-        if (xSemaphoreTake(s_send_data_Semaphore, (TickType_t)portMAX_DELAY)) {
-            s_now_enter_time = esp_timer_get_time();
-            s_us_duration = s_now_enter_time - s_last_enter_time;
-            if(s_audio_code == ESP_HF_AUDIO_STATE_CONNECTED_MSBC) {
+        // the timer notifies once per block, a missed one only adds to the count
+        if (ulTaskNotifyTake(pdTRUE, portMAX_DELAY)) {
+            if (!ss->running) {
+                // a notification left over from before the disconnect
+                continue;
+            }
+            blocks = bt_app_time_deadline_expired(&ss->gen, bt_app_time_us(), &late_us);
+            if (blocks == 0) {
+                continue;
+            }
+            bt_app_metrics_hist_record(BT_APP_METRIC_HF_GEN_LATE_US, (uint32_t)late_us);
+            if(ss->audio_code == ESP_HF_AUDIO_STATE_CONNECTED_MSBC) {
             // time of a frame is 7.5ms, sample is 120, data is 2 (byte/sample), so a frame is 240 byte (HF_SBC_ENC_RAW_DATA_SIZE)
-                frame_data_num = s_us_duration / PCM_BLOCK_DURATION_US * WBS_PCM_INPUT_DATA_SIZE;
-                s_last_enter_time += frame_data_num / WBS_PCM_INPUT_DATA_SIZE * PCM_BLOCK_DURATION_US;
+                block_size = WBS_PCM_INPUT_DATA_SIZE;
             } else {
-                frame_data_num = s_us_duration / PCM_BLOCK_DURATION_US * PCM_INPUT_DATA_SIZE;
-                s_last_enter_time += frame_data_num / PCM_INPUT_DATA_SIZE * PCM_BLOCK_DURATION_US;
+                block_size = PCM_INPUT_DATA_SIZE;
             }
-            if (frame_data_num == 0) {
+            if (!bt_app_floor_tx_open()) {
+                // the outgoing callback sends silence without reading, keep it asking
+                esp_hf_ag_outgoing_data_ready();
                 continue;
             }
-            buf = osi_malloc(frame_data_num);
-            if (!buf) {
-                ESP_LOGE(BT_HF_TAG, "%s, no mem", __FUNCTION__);
-                continue;
+            for (sent = 0; sent < blocks; sent++) {
+                bt_app_hf_create_audio_data(ss->gen_block, block_size);
+                if (!xRingbufferSend(ss->rb, ss->gen_block, block_size, 0)) {
+                    break;
+                }
             }
-            bt_app_hf_create_audio_data(buf, frame_data_num);
-            BaseType_t done = xRingbufferSend(s_m_rb, buf, frame_data_num, 0);
-            if (!done) {
-                ESP_LOGE(BT_HF_TAG, "rb send fail");
+            if (sent < blocks) {
+                BT_APP_DLOG(HF_RB_SEND_FAIL);
+                BT_APP_TRACE_INSTANT(RB, BT_APP_TRACE_RB_SEND_FAIL, (blocks - sent) * block_size);
+                bt_app_metrics_inc(BT_APP_METRIC_RB_SEND_FAIL);
             }
-            osi_free(buf);
-            vRingbufferGetInfo(s_m_rb, NULL, NULL, NULL, NULL, &item_size);
+            bt_app_metrics_add(BT_APP_METRIC_RB_PRODUCED_BYTES, sent * block_size);
+            vRingbufferGetInfo(ss->rb, NULL, NULL, NULL, NULL, &item_size);
+            bt_app_metrics_gauge_set(BT_APP_METRIC_RB_FILL, item_size);
+            BT_APP_TRACE_COUNTER(RB, BT_APP_TRACE_RB_FILL, item_size);
 
-            if(s_audio_code == ESP_HF_AUDIO_STATE_CONNECTED_MSBC) {
-                if(item_size >= WBS_PCM_INPUT_DATA_SIZE) {
-                    esp_hf_ag_outgoing_data_ready();
-                }
-            } else {
-                if(item_size >= PCM_INPUT_DATA_SIZE) {
-                    esp_hf_ag_outgoing_data_ready();
-                }
+            if(item_size >= block_size) {
+                esp_hf_ag_outgoing_data_ready();
             }
         }
     }
 }
-void bt_app_send_data(void)
+
+static void bt_app_send_data_timer_create(bt_app_hf_session_t *ss)
 {
-    s_send_data_Semaphore = xSemaphoreCreateBinary();
-    xTaskCreate(bt_app_send_data_task, "BtAppSendDataTask", 2048, NULL, configMAX_PRIORITIES - 3, &s_bt_app_send_data_task_handler);
-    s_m_rb = xRingbufferCreate(ESP_HFP_RINGBUF_SIZE, RINGBUF_TYPE_BYTEBUF);
     const esp_timer_create_args_t c_periodic_timer_args = {
             .callback = &bt_app_send_data_timer_cb,
+            .arg = ss,
             .name = "periodic"
     };
-    ESP_ERROR_CHECK(esp_timer_create(&c_periodic_timer_args, &s_periodic_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(s_periodic_timer, PCM_GENERATOR_TICK_US));
-    s_last_enter_time = esp_timer_get_time();
+    ESP_ERROR_CHECK(esp_timer_create(&c_periodic_timer_args, &ss->timer));
+}
+
+#if BT_APP_MEM_STATIC
+/* audio of the previous call still in the ring */
+static void bt_app_send_data_rb_drain(RingbufHandle_t rb)
+{
+    size_t len;
+    void *data;
+    while ((data = xRingbufferReceive(rb, &len, 0)) != NULL) {
+        vRingbufferReturnItem(rb, data);
+    }
+}
+#endif
+
+void bt_app_hf_audio_init(void)
+{
+#if BT_APP_MEM_STATIC
+    bt_app_hf_session_t *ss = &s_session;
+    ss->rb = xRingbufferCreateStatic(ESP_HFP_RINGBUF_SIZE, RINGBUF_TYPE_BYTEBUF, s_rb_storage, &s_rb_buf);
+    bt_app_send_data_timer_create(ss);
+    bt_app_tasks_create(BT_APP_TASK_SEND, bt_app_send_data_task, ss, &ss->task);
+#endif
+}
+
+void bt_app_send_data(void)
+{
+    bt_app_hf_session_t *ss = &s_session;
+#if BT_APP_MEM_STATIC
+    if (ss->running) {
+        // connected again without a disconnect in between
+        ss->running = false;
+        esp_timer_stop(ss->timer);
+    }
+    bt_app_send_data_rb_drain(ss->rb);
+#else
+    bt_app_tasks_create(BT_APP_TASK_SEND, bt_app_send_data_task, ss, &ss->task);
+    ss->rb = xRingbufferCreate(ESP_HFP_RINGBUF_SIZE, RINGBUF_TYPE_BYTEBUF);
+    bt_app_send_data_timer_create(ss);
+#endif
+    bt_app_time_deadline_start(&ss->gen, PCM_BLOCK_DURATION_US);
+    ss->running = true;
+    ESP_ERROR_CHECK(esp_timer_start_periodic(ss->timer, PCM_BLOCK_DURATION_US));
     return;
 }
 
 void bt_app_send_data_shut_down(void)
 {
-    if (s_bt_app_send_data_task_handler) {
-        vTaskDelete(s_bt_app_send_data_task_handler);
-        s_bt_app_send_data_task_handler = NULL;
+    bt_app_hf_session_t *ss = &s_session;
+#if BT_APP_MEM_STATIC
+    // task, ring and timer stay for the next call
+    if (ss->running) {
+        ss->running = false;
+        ESP_ERROR_CHECK(esp_timer_stop(ss->timer));
     }
-    if(s_periodic_timer) {
-        ESP_ERROR_CHECK(esp_timer_stop(s_periodic_timer));
-        ESP_ERROR_CHECK(esp_timer_delete(s_periodic_timer));
+#else
+    ss->running = false;
+    // timer first, its callback notifies the task
+    if(ss->timer) {
+        ESP_ERROR_CHECK(esp_timer_stop(ss->timer));
+        ESP_ERROR_CHECK(esp_timer_delete(ss->timer));
+        ss->timer = NULL;
     }
-    if (s_send_data_Semaphore) {
-        vSemaphoreDelete(s_send_data_Semaphore);
-        s_send_data_Semaphore = NULL;
+    if (ss->task) {
+        bt_app_tasks_delete(ss->task);
+        ss->task = NULL;
     }
-    if (s_m_rb) {
-        vRingbufferDelete(s_m_rb);
+    if (ss->rb) {
+        vRingbufferDelete(ss->rb);
+        ss->rb = NULL;
     }
+#endif
     return;
 }
+#else
+void bt_app_hf_audio_init(void)
+{
+}
 #endif /* #if CONFIG_BT_HFP_AUDIO_DATA_PATH_HCI */
 
 /*
@@ -351,38 +499,81 @@ void bt_app_send_data_shut_down(void)
  *
  * These events guide the application on how to respond to various Bluetooth interactions.
  */
+static void bt_app_hf_handle_evt(esp_hf_cb_event_t event, esp_hf_cb_param_t *param);
+
 void bt_app_hf_cb(esp_hf_cb_event_t event, esp_hf_cb_param_t *param)
+{
+    uint32_t start = (uint32_t)esp_timer_get_time();
+    bt_app_metrics_inc(BT_APP_METRIC_HF_EVENTS);
+    BT_APP_TRACE_BEGIN(HF_EVT, event, 0);
+    bt_app_hf_handle_evt(event, param);
+    BT_APP_TRACE_END(HF_EVT, event, 0);
+    bt_app_metrics_hist_record(BT_APP_METRIC_HF_CB_US, (uint32_t)esp_timer_get_time() - start);
+}
+
+static void bt_app_hf_handle_evt(esp_hf_cb_event_t event, esp_hf_cb_param_t *param)
 {
     if (event <= ESP_HF_PKT_STAT_NUMS_GET_EVT) {
-        ESP_LOGI(BT_HF_TAG, "APP HFP event: %s", c_hf_evt_str[event]);
+        BT_APP_DLOG(HF_EVT, BT_APP_DLOG_STR(c_hf_evt_str[event]));
     } else {
-        ESP_LOGE(BT_HF_TAG, "APP HFP invalid event %d", event);
+        BT_APP_DLOG(HF_EVT_INVALID, event);
     }
 
     switch (event) {
         case ESP_HF_CONNECTION_STATE_EVT:
         {
-            ESP_LOGI(BT_HF_TAG, "--connection state %s, peer feats 0x%"PRIx32", chld_feats 0x%"PRIx32,
-                    c_connection_state_str[param->conn_stat.state],
-                    param->conn_stat.peer_feat,
-                    param->conn_stat.chld_feat);
+            BT_APP_DLOG(HF_CONN_STATE, BT_APP_DLOG_STR(c_connection_state_str[param->conn_stat.state]),
+                        param->conn_stat.peer_feat, param->conn_stat.chld_feat);
             memcpy(hf_peer_addr, param->conn_stat.remote_bda, ESP_BD_ADDR_LEN);
+            hf_bin_notify(event, param->conn_stat.state, param->conn_stat.peer_feat);
+            if (param->conn_stat.state == ESP_HF_CONNECTION_STATE_SLC_CONNECTED) {
+                bt_app_metrics_inc(BT_APP_METRIC_SLC_CONNECTED);
+                bt_app_ind_peer_connected(param->conn_stat.remote_bda);
+                hf_scr_post(HF_SCR_EVT_SLC_CONNECTED);
+            } else if (param->conn_stat.state == ESP_HF_CONNECTION_STATE_DISCONNECTED) {
+                bt_app_metrics_inc(BT_APP_METRIC_SLC_DISCONNECTED);
+                bt_app_ind_peer_disconnected(param->conn_stat.remote_bda);
+                bt_app_call_on_disconnect(param->conn_stat.remote_bda);
+                bt_app_floor_on_disconnect(param->conn_stat.remote_bda);
+                hf_scr_post(HF_SCR_EVT_SLC_DISCONNECTED);
+            }
             break;
         }
 
         case ESP_HF_AUDIO_STATE_EVT:
         {
-            ESP_LOGI(BT_HF_TAG, "--Audio State %s", c_audio_state_str[param->audio_stat.state]);
+            BT_APP_DLOG(HF_AUDIO_STATE, BT_APP_DLOG_STR(c_audio_state_str[param->audio_stat.state]));
+            bt_app_metrics_gauge_set(BT_APP_METRIC_AUDIO_STATE, param->audio_stat.state);
+            hf_bin_notify(event, param->audio_stat.state, param->audio_stat.sync_conn_handle);
+            if (param->audio_stat.state == ESP_HF_AUDIO_STATE_CONNECTED ||
+                param->audio_stat.state == ESP_HF_AUDIO_STATE_CONNECTED_MSBC) {
+                bt_app_metrics_inc(BT_APP_METRIC_AUDIO_CONNECTED);
+                bt_app_link_start(param->audio_stat.sync_conn_handle);
+                bt_app_call_on_audio(true);
+                bt_app_floor_on_audio(param->audio_stat.remote_addr, true);
+                hf_scr_post(HF_SCR_EVT_AUDIO_CONNECTED);
+            } else if (param->audio_stat.state == ESP_HF_AUDIO_STATE_DISCONNECTED) {
+                bt_app_metrics_inc(BT_APP_METRIC_AUDIO_DISCONNECTED);
+                bt_app_link_stop();
+                bt_app_call_on_audio(false);
+                bt_app_floor_on_audio(param->audio_stat.remote_addr, false);
+                hf_scr_post(HF_SCR_EVT_AUDIO_DISCONNECTED);
+            }
 #if CONFIG_BT_HFP_AUDIO_DATA_PATH_HCI
             if (param->audio_stat.state == ESP_HF_AUDIO_STATE_CONNECTED ||
                 param->audio_stat.state == ESP_HF_AUDIO_STATE_CONNECTED_MSBC)
             {
                 if(param->audio_stat.state == ESP_HF_AUDIO_STATE_CONNECTED) {
-                    s_audio_code = ESP_HF_AUDIO_STATE_CONNECTED;
+                    s_session.audio_code = ESP_HF_AUDIO_STATE_CONNECTED;
                 } else {
-                    s_audio_code = ESP_HF_AUDIO_STATE_CONNECTED_MSBC;
+                    s_session.audio_code = ESP_HF_AUDIO_STATE_CONNECTED_MSBC;
                 }
-                s_time_old = esp_timer_get_time();
+                s_session.rx_gated = false;
+                s_session.speed_bytes = 0;
+                s_session.speed_start_us = esp_timer_get_time();
+                // nothing plays the HF's audio on this board: PLC only detects and counts losses
+                bt_app_plc_init((s_session.audio_code == ESP_HF_AUDIO_STATE_CONNECTED_MSBC) ? WBS_PCM_SAMPLING_RATE_KHZ : PCM_SAMPLING_RATE_KHZ,
+                                NULL);
                 esp_hf_ag_register_data_callback(bt_app_hf_incoming_cb, bt_app_hf_outgoing_cb);
                 /* Begin send esco data task */
                 bt_app_send_data();
@@ -397,12 +588,19 @@ void bt_app_hf_cb(esp_hf_cb_event_t event, esp_hf_cb_param_t *param)
         case ESP_HF_BVRA_RESPONSE_EVT:
         {
             ESP_LOGI(BT_HF_TAG, "--Voice Recognition is %s", c_vr_state_str[param->vra_rep.value]);
+            bt_app_floor_on_bvra(param->vra_rep.remote_addr, param->vra_rep.value == ESP_HF_VR_STATE_ENABLED);
             break;
         }
 
         case ESP_HF_VOLUME_CONTROL_EVT:
         {
-            ESP_LOGI(BT_HF_TAG, "--Volume Target: %s, Volume %d", c_volume_control_target_str[param->volume_control.type], param->volume_control.volume);
+            BT_APP_DLOG(HF_VOLUME, BT_APP_DLOG_STR(c_volume_control_target_str[param->volume_control.type]),
+                        param->volume_control.volume);
+            if (param->volume_control.type == ESP_HF_VOLUME_CONTROL_TARGET_SPK) {
+                bt_app_gain_set_level(BT_APP_GAIN_PATH_OUTGOING, param->volume_control.volume);
+            } else {
+                bt_app_gain_set_level(BT_APP_GAIN_PATH_INCOMING, param->volume_control.volume);
+            }
             break;
         }
 
@@ -416,31 +614,15 @@ void bt_app_hf_cb(esp_hf_cb_event_t event, esp_hf_cb_param_t *param)
         case ESP_HF_IND_UPDATE_EVT:
         {
             ESP_LOGI(BT_HF_TAG, "--UPDATE INDCATOR!");
-            esp_hf_call_status_t call_state = 1;
-            esp_hf_call_setup_status_t call_setup_state = 2;
-            esp_hf_network_state_t ntk_state = 1;
-            int signal = 2;
-            // esp_hf_ag_devices_status_indchange(param->ind_upd.remote_addr, call_state, call_setup_state, ntk_state, signal); //deprecated
-            esp_hf_ag_ciev_report(param->ind_upd.remote_addr, ESP_HF_IND_TYPE_CALL, call_state);
-            esp_hf_ag_ciev_report(param->ind_upd.remote_addr, ESP_HF_IND_TYPE_CALLSETUP, call_setup_state);
-            esp_hf_ag_ciev_report(param->ind_upd.remote_addr, ESP_HF_IND_TYPE_SERVICE, ntk_state);
-            esp_hf_ag_ciev_report(param->ind_upd.remote_addr, ESP_HF_IND_TYPE_SIGNAL, signal);
-            // esp_hf_ag_ciev_report(param->ind_upd.remote_addr, ESP_HF_IND_TYPE_BATTCHG, battery);
-
+            // only the indicators that changed since this peer last heard of them
+            bt_app_ind_update(param->ind_upd.remote_addr);
             break;
         }
 
         case ESP_HF_CIND_RESPONSE_EVT:
         {
             ESP_LOGI(BT_HF_TAG, "--CIND Start.");
-            esp_hf_call_status_t call_status = 0;
-            esp_hf_call_setup_status_t call_setup_status = 0;
-            esp_hf_network_state_t ntk_state = 1;
-            int signal = 4;
-            esp_hf_roaming_status_t roam = 0;
-            int batt_lev = 3;
-            esp_hf_call_held_status_t call_held_status = 0;
-            esp_hf_ag_cind_response(param->cind_rep.remote_addr,call_status,call_setup_status,ntk_state,signal,roam,batt_lev,call_held_status);
+            bt_app_ind_cind_response(param->cind_rep.remote_addr);
             break;
         }
 
@@ -453,18 +635,8 @@ void bt_app_hf_cb(esp_hf_cb_event_t event, esp_hf_cb_param_t *param)
 
         case ESP_HF_CLCC_RESPONSE_EVT:
         {
-            int index = 1;
-            //mandatory
-            esp_hf_current_call_direction_t dir = 1;
-            esp_hf_current_call_status_t current_call_status = 0;
-            esp_hf_current_call_mode_t mode = 0;
-            esp_hf_current_call_mpty_type_t mpty = 0;
-            //option
-            char *number = {"123456"};
-            esp_hf_call_addr_type_t type = ESP_HF_CALL_ADDR_TYPE_UNKNOWN;
-
             ESP_LOGI(BT_HF_TAG, "--Calling Line Identification.");
-            esp_hf_ag_clcc_response(param->clcc_rep.remote_addr, index, dir, current_call_status, mode, mpty, number, type);
+            bt_app_call_clcc_response(param->clcc_rep.remote_addr);
             break;
         }
 
@@ -511,43 +683,43 @@ void bt_app_hf_cb(esp_hf_cb_event_t event, esp_hf_cb_param_t *param)
         case ESP_HF_ATA_RESPONSE_EVT:
         {
             ESP_LOGI(BT_HF_TAG, "--Asnwer Incoming Call.");
-            char *number = {"123456"};
-            esp_hf_ag_answer_call(param->ata_rep.remote_addr,1,0,1,0,number,0);
+            if (!bt_app_call_event(param->ata_rep.remote_addr, BT_APP_CALL_EVT_ANSWER, NULL)) {
+                esp_hf_ag_cmee_send(param->ata_rep.remote_addr, ESP_HF_AT_RESPONSE_CODE_ERR, ESP_HF_CME_OPERATION_NOT_ALLOWED);
+            }
             break;
         }
 
         case ESP_HF_CHUP_RESPONSE_EVT:
         {
             ESP_LOGI(BT_HF_TAG, "--Reject Incoming Call.");
-            char *number = {"123456"};
-            esp_hf_ag_reject_call(param->chup_rep.remote_addr,0,0,0,0,number,0);
+            if (!bt_app_call_event(param->chup_rep.remote_addr, BT_APP_CALL_EVT_END, NULL)) {
+                esp_hf_ag_cmee_send(param->chup_rep.remote_addr, ESP_HF_AT_RESPONSE_CODE_ERR, ESP_HF_CME_OPERATION_NOT_ALLOWED);
+            }
             break;
         }
 
         case ESP_HF_DIAL_EVT:
         {
+            const char *number = NULL;
             if (param->out_call.num_or_loc) {
                 if (param->out_call.type == ESP_HF_DIAL_NUM) {
                     // dia_num
                     ESP_LOGI(BT_HF_TAG, "--Dial number \"%s\".", param->out_call.num_or_loc);
-                    esp_hf_ag_out_call(param->out_call.remote_addr,1,0,1,0,param->out_call.num_or_loc,0);
+                    number = param->out_call.num_or_loc;
                 } else if (param->out_call.type == ESP_HF_DIAL_MEM) {
-                    // dia_mem
+                    // dia_mem, the intercom keeps no phone book
                     ESP_LOGI(BT_HF_TAG, "--Dial memory \"%s\".", param->out_call.num_or_loc);
-                    // AG found phone number by memory position
-                    bool num_found = true;
-                    if (num_found) {
-                        char *number = "123456";
-                        esp_hf_ag_cmee_send(param->out_call.remote_addr, ESP_HF_AT_RESPONSE_CODE_OK, ESP_HF_CME_AG_FAILURE);
-                        esp_hf_ag_out_call(param->out_call.remote_addr,1,0,1,0,number,0);
-                    } else {
-                        esp_hf_ag_cmee_send(param->out_call.remote_addr, ESP_HF_AT_RESPONSE_CODE_CME, ESP_HF_CME_MEMORY_FAILURE);
-                    }
+                    esp_hf_ag_cmee_send(param->out_call.remote_addr, ESP_HF_AT_RESPONSE_CODE_CME, ESP_HF_CME_MEMORY_FAILURE);
+                    break;
                 }
             } else {
                 //dia_last
-                //refer to dia_mem
                 ESP_LOGI(BT_HF_TAG, "--Dial last number.");
+                number = bt_app_call_last_number();
+            }
+            if (number == NULL || number[0] == '\0' ||
+                !bt_app_call_event(param->out_call.remote_addr, BT_APP_CALL_EVT_DIAL, number)) {
+                esp_hf_ag_cmee_send(param->out_call.remote_addr, ESP_HF_AT_RESPONSE_CODE_ERR, ESP_HF_CME_OPERATION_NOT_ALLOWED);
             }
             break;
         }
@@ -565,7 +737,16 @@ void bt_app_hf_cb(esp_hf_cb_event_t event, esp_hf_cb_param_t *param)
         }
         case ESP_HF_PKT_STAT_NUMS_GET_EVT:
         {
-            ESP_LOGI(BT_HF_TAG, "ESP_HF_PKT_STAT_NUMS_GET_EVT: %d.", event);
+            bt_app_link_pkt_nums_t nums = {
+                .rx_total = param->pkt_nums.rx_total,
+                .rx_correct = param->pkt_nums.rx_correct,
+                .rx_err = param->pkt_nums.rx_err,
+                .rx_none = param->pkt_nums.rx_none,
+                .rx_lost = param->pkt_nums.rx_lost,
+                .tx_total = param->pkt_nums.tx_total,
+                .tx_discarded = param->pkt_nums.tx_discarded,
+            };
+            bt_app_link_on_pkt_nums(&nums, esp_timer_get_time());
             break;
         }
 
@@ -19,4 +19,9 @@ extern esp_bd_addr_t hf_peer_addr; // Declaration of peer device bdaddr
  * @brief     callback function for HF client
  */
 void bt_app_hf_cb(esp_hf_cb_event_t event, esp_hf_cb_param_t *param);
+
+/**
+ * @brief     with BT_APP_MEM_STATIC create the audio task, ring and timer once, before any call
+ */
+void bt_app_hf_audio_init(void);
 #endif /* __BT_APP_HF_H__*/
@@ -0,0 +1,361 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_ind.c
+
+Overall Responsibility:
+Model of the AG indicators (call, callsetup, service, signal, roam, battchg, callheld) and of what
+each connected HF device was last told about them. Everything that changes an indicator goes
+through `bt_app_ind_set`, and only indicators whose value differs from the peer's copy are sent as
++CIEV, so an unchanged value never costs an AT round on the link.
+
+Important Details:
+
+1. Model:
+   - One current value per indicator, ranges and start values in BT_APP_IND_LIST. AT+CIND? is
+     answered from the model (`bt_app_ind_cind_response`), which also sets the peer's copy.
+   - Phone state updates (bt_app_call) make the stack send call, callsetup and callheld itself,
+     but only to the peer they were made for. `bt_app_ind_set_reported` records that peer's copy
+     without a second report, `bt_app_ind_report_all` then brings the other peers up to date.
+
+2. Peers:
+   - Up to BT_APP_IND_PEERS_MAX devices, found by address. A slot is taken on AT+CIND? or on SLC
+     connect and freed on disconnect. +CIEV goes only to peers with an SLC.
+
+3. Rate limit:
+   - Indicators with a min_interval_ms (signal, battchg) are reported to a peer at most once per
+     interval. A change inside the interval is held back and a one-shot esp_timer sends the latest
+     value when the interval is over, so a burst of changes becomes one report.
+   - `bt_app_ind_init` creates the timer when the stack comes up, so no report allocates it; the
+     first held back report creates it only if that was skipped.
+
+4. Counters:
+   - ind.ciev_sent, ind.ciev_unchanged (a set that changed nothing) and ind.ciev_coalesced (a held
+     back value replaced before it was sent) are part of the `metrics` command.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "freertos/FreeRTOS.h"
+#include "bt_app_ind.h"
+#include "bt_app_metrics.h"
+
+#define IND_REPORTS_MAX           (BT_APP_IND_PEERS_MAX * BT_APP_IND_NUM)
+
+_Static_assert(ESP_HF_IND_TYPE_CALLHELD - ESP_HF_IND_TYPE_CALL == BT_APP_IND_CALLHELD,
+               "BT_APP_IND_LIST out of step with esp_hf_ciev_report_type_t");
+
+typedef struct {
+    bool used;
+    bool slc;
+    esp_bd_addr_t bda;
+    int8_t reported[BT_APP_IND_NUM];    /* -1 until the peer heard of the indicator */
+    int64_t last_us[BT_APP_IND_NUM];    /* last report of a rate-limited indicator */
+    uint32_t held;                      /* bit per indicator held back by the rate limit */
+} ind_peer_t;
+
+typedef struct {
+    esp_bd_addr_t bda;
+    bt_app_ind_t ind;
+    int value;
+} ind_report_t;
+
+#define IND_MAX(id, max, initial, min_interval_ms, name)        max,
+#define IND_INITIAL(id, max, initial, min_interval_ms, name)    initial,
+#define IND_INTERVAL(id, max, initial, min_interval_ms, name)   min_interval_ms,
+#define IND_NAME(id, max, initial, min_interval_ms, name)       name,
+
+static const int8_t s_ind_max[BT_APP_IND_NUM] = { BT_APP_IND_LIST(IND_MAX) };
+static const uint32_t s_ind_interval_ms[BT_APP_IND_NUM] = { BT_APP_IND_LIST(IND_INTERVAL) };
+static const char *const s_ind_name[BT_APP_IND_NUM] = { BT_APP_IND_LIST(IND_NAME) };
+
+static portMUX_TYPE s_ind_lock = portMUX_INITIALIZER_UNLOCKED;
+static int8_t s_value[BT_APP_IND_NUM] = { BT_APP_IND_LIST(IND_INITIAL) };
+static ind_peer_t s_peers[BT_APP_IND_PEERS_MAX];
+static esp_timer_handle_t s_flush_timer;
+static int64_t s_flush_due_us;          /* 0 while the timer is not armed */
+
+static void bt_app_ind_flush_cb(void *arg);
+
+static ind_peer_t *bt_app_ind_peer_find(const uint8_t *bda, bool alloc)
+{
+    ind_peer_t *free_slot = NULL;
+    for (int i = 0; i < BT_APP_IND_PEERS_MAX; i++) {
+        if (s_peers[i].used && memcmp(s_peers[i].bda, bda, ESP_BD_ADDR_LEN) == 0) {
+            return &s_peers[i];
+        }
+        if (!s_peers[i].used && free_slot == NULL) {
+            free_slot = &s_peers[i];
+        }
+    }
+    if (!alloc || free_slot == NULL) {
+        return NULL;
+    }
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->used = true;
+    memcpy(free_slot->bda, bda, ESP_BD_ADDR_LEN);
+    memset(free_slot->reported, -1, sizeof(free_slot->reported));
+    return free_slot;
+}
+
+/* collect the reports one peer is owed, called with s_ind_lock held; returns the earliest held back due time */
+static int64_t bt_app_ind_collect(ind_peer_t *peer, int64_t now_us, ind_report_t *out, int *n)
+{
+    int64_t due_us = 0;
+    for (int i = 0; i < BT_APP_IND_NUM; i++) {
+        if (peer->reported[i] == s_value[i]) {
+            peer->held &= ~(1u << i);
+            continue;
+        }
+        if (s_ind_interval_ms[i] && peer->reported[i] >= 0) {
+            int64_t next_us = peer->last_us[i] + (int64_t)s_ind_interval_ms[i] * 1000;
+            if (now_us < next_us) {
+                if (peer->held & (1u << i)) {
+                    bt_app_metrics_inc(BT_APP_METRIC_CIEV_COALESCED);
+                }
+                peer->held |= 1u << i;
+                if (due_us == 0 || next_us < due_us) {
+                    due_us = next_us;
+                }
+                continue;
+            }
+        }
+        memcpy(out[*n].bda, peer->bda, ESP_BD_ADDR_LEN);
+        out[*n].ind = i;
+        out[*n].value = s_value[i];
+        (*n)++;
+        peer->reported[i] = s_value[i];
+        peer->last_us[i] = now_us;
+        peer->held &= ~(1u << i);
+    }
+    return due_us;
+}
+
+static void bt_app_ind_timer_create(void)
+{
+    if (!s_flush_timer) {
+        const esp_timer_create_args_t args = {
+            .callback = &bt_app_ind_flush_cb,
+            .name = "ind_flush"
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &s_flush_timer));
+    }
+}
+
+void bt_app_ind_init(void)
+{
+    bt_app_ind_timer_create();
+}
+
+/* send outside the lock, then make sure the timer fires for the earliest held back report */
+static void bt_app_ind_send(const ind_report_t *reports, int n, int64_t due_us)
+{
+    for (int i = 0; i < n; i++) {
+        esp_hf_ag_ciev_report((uint8_t *)reports[i].bda, ESP_HF_IND_TYPE_CALL + reports[i].ind, reports[i].value);
+        bt_app_metrics_inc(BT_APP_METRIC_CIEV_SENT);
+    }
+    if (due_us == 0) {
+        return;
+    }
+    bt_app_ind_timer_create();
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_ind_lock);
+    bool rearm = (s_flush_due_us == 0 || due_us < s_flush_due_us);
+    if (rearm) {
+        s_flush_due_us = due_us;
+    }
+    portEXIT_CRITICAL(&s_ind_lock);
+    if (rearm) {
+        esp_timer_stop(s_flush_timer);
+        esp_timer_start_once(s_flush_timer, (due_us > now_us) ? due_us - now_us : 1);
+    }
+}
+
+/* report to every peer with an SLC, or only to `bda` */
+static void bt_app_ind_report(const uint8_t *bda)
+{
+    ind_report_t reports[IND_REPORTS_MAX];
+    int n = 0;
+    int64_t due_us = 0;
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_ind_lock);
+    for (int i = 0; i < BT_APP_IND_PEERS_MAX; i++) {
+        ind_peer_t *peer = &s_peers[i];
+        if (!peer->used || !peer->slc || (bda && memcmp(peer->bda, bda, ESP_BD_ADDR_LEN) != 0)) {
+            continue;
+        }
+        int64_t peer_due_us = bt_app_ind_collect(peer, now_us, reports, &n);
+        if (peer_due_us && (due_us == 0 || peer_due_us < due_us)) {
+            due_us = peer_due_us;
+        }
+    }
+    portEXIT_CRITICAL(&s_ind_lock);
+
+    bt_app_ind_send(reports, n, due_us);
+}
+
+static void bt_app_ind_flush_cb(void *arg)
+{
+    portENTER_CRITICAL(&s_ind_lock);
+    s_flush_due_us = 0;
+    portEXIT_CRITICAL(&s_ind_lock);
+    bt_app_ind_report(NULL);
+}
+
+bool bt_app_ind_set(bt_app_ind_t ind, int value)
+{
+    if (ind >= BT_APP_IND_NUM || value < 0 || value > s_ind_max[ind]) {
+        return false;
+    }
+    portENTER_CRITICAL(&s_ind_lock);
+    bool changed = (s_value[ind] != value);
+    s_value[ind] = value;
+    portEXIT_CRITICAL(&s_ind_lock);
+
+    if (!changed) {
+        bt_app_metrics_inc(BT_APP_METRIC_CIEV_UNCHANGED);
+        return true;
+    }
+    bt_app_ind_report(NULL);
+    return true;
+}
+
+void bt_app_ind_set_reported(esp_bd_addr_t bda, bt_app_ind_t ind, int value)
+{
+    if (ind >= BT_APP_IND_NUM || value < 0 || value > s_ind_max[ind]) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_ind_lock);
+    s_value[ind] = value;
+    // gone already when the call ended with the link, then only the model changes
+    ind_peer_t *peer = bt_app_ind_peer_find(bda, false);
+    if (peer) {
+        peer->reported[ind] = value;
+        peer->last_us[ind] = now_us;
+        peer->held &= ~(1u << ind);
+    }
+    portEXIT_CRITICAL(&s_ind_lock);
+}
+
+void bt_app_ind_report_all(void)
+{
+    bt_app_ind_report(NULL);
+}
+
+int bt_app_ind_get(bt_app_ind_t ind)
+{
+    return (ind < BT_APP_IND_NUM) ? s_value[ind] : -1;
+}
+
+bt_app_ind_t bt_app_ind_find(const char *name)
+{
+    for (int i = 0; i < BT_APP_IND_NUM; i++) {
+        if (strcmp(name, s_ind_name[i]) == 0) {
+            return i;
+        }
+    }
+    return BT_APP_IND_NUM;
+}
+
+void bt_app_ind_cind_response(esp_bd_addr_t bda)
+{
+    int8_t v[BT_APP_IND_NUM];
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_ind_lock);
+    memcpy(v, s_value, sizeof(v));
+    ind_peer_t *peer = bt_app_ind_peer_find(bda, true);
+    if (peer) {
+        memcpy(peer->reported, s_value, sizeof(peer->reported));
+        for (int i = 0; i < BT_APP_IND_NUM; i++) {
+            peer->last_us[i] = now_us;
+        }
+        peer->held = 0;
+    }
+    portEXIT_CRITICAL(&s_ind_lock);
+
+    if (!peer) {
+        ESP_LOGW(BT_APP_IND_TAG, "no peer slot, CIND answered without tracking");
+    }
+    esp_hf_ag_cind_response(bda, v[BT_APP_IND_CALL], v[BT_APP_IND_CALLSETUP], v[BT_APP_IND_SERVICE],
+                            v[BT_APP_IND_SIGNAL], v[BT_APP_IND_ROAM], v[BT_APP_IND_BATTCHG],
+                            v[BT_APP_IND_CALLHELD]);
+}
+
+void bt_app_ind_update(esp_bd_addr_t bda)
+{
+    bt_app_ind_report(bda);
+}
+
+void bt_app_ind_peer_connected(esp_bd_addr_t bda)
+{
+    portENTER_CRITICAL(&s_ind_lock);
+    ind_peer_t *peer = bt_app_ind_peer_find(bda, true);
+    if (peer) {
+        peer->slc = true;
+        // no AT+CIND? went through us, the stack answered it with the same model values
+        for (int i = 0; i < BT_APP_IND_NUM; i++) {
+            if (peer->reported[i] < 0) {
+                peer->reported[i] = s_value[i];
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_ind_lock);
+
+    if (!peer) {
+        ESP_LOGW(BT_APP_IND_TAG, "no peer slot, indicators not reported");
+        return;
+    }
+    // changes between AT+CIND? and the end of SLC setup
+    bt_app_ind_report(bda);
+}
+
+void bt_app_ind_peer_disconnected(esp_bd_addr_t bda)
+{
+    portENTER_CRITICAL(&s_ind_lock);
+    ind_peer_t *peer = bt_app_ind_peer_find(bda, false);
+    if (peer) {
+        peer->used = false;
+    }
+    portEXIT_CRITICAL(&s_ind_lock);
+}
+
+void bt_app_ind_dump(void)
+{
+    int8_t v[BT_APP_IND_NUM];
+    ind_peer_t peers[BT_APP_IND_PEERS_MAX];
+
+    portENTER_CRITICAL(&s_ind_lock);
+    memcpy(v, s_value, sizeof(v));
+    memcpy(peers, s_peers, sizeof(peers));
+    portEXIT_CRITICAL(&s_ind_lock);
+
+    printf("%-10s %5s", "indicator", "value");
+    for (int p = 0; p < BT_APP_IND_PEERS_MAX; p++) {
+        if (peers[p].used) {
+            printf("  %02x:%02x:%02x:%02x:%02x:%02x%s", peers[p].bda[0], peers[p].bda[1], peers[p].bda[2],
+                   peers[p].bda[3], peers[p].bda[4], peers[p].bda[5], peers[p].slc ? "" : "(setup)");
+        }
+    }
+    printf("\n");
+    for (int i = 0; i < BT_APP_IND_NUM; i++) {
+        printf("%-10s %5d", s_ind_name[i], v[i]);
+        for (int p = 0; p < BT_APP_IND_PEERS_MAX; p++) {
+            if (peers[p].used) {
+                printf("  %16d%s", peers[p].reported[i], (peers[p].held & (1u << i)) ? "*" : " ");
+            }
+        }
+        printf("\n");
+    }
+}
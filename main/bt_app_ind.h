@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_IND_H__
+#define __BT_APP_IND_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_bt_defs.h"
+
+#define BT_APP_IND_TAG              "BT_APP_IND"
+
+/* HF devices with an SLC at the same time */
+#define BT_APP_IND_PEERS_MAX        (2)
+
+/*
+ * X(id, max, initial, min_interval_ms, name)
+ * same order as esp_hf_ciev_report_type_t; min_interval_ms limits how often a bursty indicator is
+ * reported to a peer, changes in between are coalesced into the next report
+ */
+#define BT_APP_IND_LIST(X)                                  \
+    X(CALL,         1,  0,  0,      "call")                 \
+    X(CALLSETUP,    3,  0,  0,      "callsetup")            \
+    X(SERVICE,      1,  1,  0,      "service")              \
+    X(SIGNAL,       5,  4,  2000,   "signal")               \
+    X(ROAM,         1,  0,  0,      "roam")                 \
+    X(BATTCHG,      5,  3,  10000,  "battchg")              \
+    X(CALLHELD,     2,  0,  0,      "callheld")
+
+#define BT_APP_IND_ENUM(id, max, initial, min_interval_ms, name)    BT_APP_IND_##id,
+
+typedef enum {
+    BT_APP_IND_LIST(BT_APP_IND_ENUM)
+    BT_APP_IND_NUM
+} bt_app_ind_t;
+
+/**
+ * @brief     create the rate limit timer; called once when the stack comes up
+ */
+void bt_app_ind_init(void);
+
+/**
+ * @brief     change an AG indicator and report it to every peer with an SLC, if it changed
+ *
+ * @return    false if the value is out of range for the indicator
+ */
+bool bt_app_ind_set(bt_app_ind_t ind, int value);
+
+/**
+ * @brief     record an indicator the stack has already reported to `bda` (phone state updates send
+ *            call, callsetup and callheld themselves), updates the model and only that peer's copy;
+ *            bt_app_ind_report_all then tells the other peers
+ */
+void bt_app_ind_set_reported(esp_bd_addr_t bda, bt_app_ind_t ind, int value);
+
+/**
+ * @brief     report to every peer with an SLC what changed since it last heard
+ */
+void bt_app_ind_report_all(void);
+
+int bt_app_ind_get(bt_app_ind_t ind);
+
+/**
+ * @brief     find an indicator by its name in BT_APP_IND_LIST
+ *
+ * @return    the indicator, or BT_APP_IND_NUM if there is none
+ */
+bt_app_ind_t bt_app_ind_find(const char *name);
+
+/**
+ * @brief     answer AT+CIND? from the model, the peer then knows every current value
+ */
+void bt_app_ind_cind_response(esp_bd_addr_t bda);
+
+/**
+ * @brief     report the indicators that changed since the peer last heard of them (ESP_HF_IND_UPDATE_EVT)
+ */
+void bt_app_ind_update(esp_bd_addr_t bda);
+
+void bt_app_ind_peer_connected(esp_bd_addr_t bda);
+
+void bt_app_ind_peer_disconnected(esp_bd_addr_t bda);
+
+/**
+ * @brief     print the model and what each peer was told
+ */
+void bt_app_ind_dump(void);
+
+#endif /* __BT_APP_IND_H__ */
@@ -0,0 +1,252 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_link.c
+
+Overall Responsibility:
+Link-quality monitor for the (e)SCO audio link. The controller counts received, erroneous, lost and
+sent packets; this module asks for those counts periodically while audio is up and turns them into
+rolling figures that can be read from the console.
+
+Important Details:
+
+1. Polling:
+   - `bt_app_link_start` is called on audio connect with the sync connection handle. An esp_timer
+     then calls `esp_hf_ag_pkt_stat_nums_get` every BT_APP_LINK_POLL_PERIOD_MS (changeable at
+     runtime with `bt_app_link_set_period`). `bt_app_link_stop` ends the polling on disconnect.
+   - `bt_app_link_init` creates the timer when the stack comes up, so a call does not allocate it;
+     `bt_app_link_start` creates it only if that was skipped.
+
+2. Rolling window:
+   - The controller reports cumulative totals. The last BT_APP_LINK_WINDOW + 1 reports are kept and
+     the window figures are the difference between the newest and the oldest one. A total that goes
+     backwards means a new link, and the window starts over.
+
+3. Figures:
+   - loss rate = (CRC errors + empty slots + partially lost) / received, in per mille.
+   - throughput = audio bytes delivered by the incoming data callback over the window, the same
+     measure `print_speed` logs.
+   - goodput = throughput scaled by the share of correctly received packets.
+
+4. Output:
+   - `bt_app_link_get_stats` for the `stats` console command, `bt_app_link_dump` for a compact
+     binary record (BT_APP_LINK_DUMP_VERSION) meant for host tools.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "freertos/FreeRTOS.h"
+#include "bt_app_link.h"
+
+#define LINK_DUMP_SIZE            (48)
+
+typedef struct {
+    uint64_t time_us;
+    uint32_t rx_bytes;
+    bt_app_link_pkt_nums_t nums;
+} link_sample_t;
+
+static portMUX_TYPE s_link_lock = portMUX_INITIALIZER_UNLOCKED;
+static link_sample_t s_samples[BT_APP_LINK_WINDOW + 1];
+static uint32_t s_head;             /* next slot to write */
+static uint32_t s_count;            /* valid samples */
+static uint32_t s_polls;
+static volatile uint32_t s_rx_bytes;
+static bool s_active;
+static uint16_t s_sync_conn_handle;
+static uint32_t s_period_ms = BT_APP_LINK_POLL_PERIOD_MS;
+static esp_timer_handle_t s_poll_timer;
+
+static void bt_app_link_poll_cb(void *arg)
+{
+    esp_hf_ag_pkt_stat_nums_get(s_sync_conn_handle);
+}
+
+static void bt_app_link_timer_create(void)
+{
+    if (!s_poll_timer) {
+        const esp_timer_create_args_t args = {
+            .callback = &bt_app_link_poll_cb,
+            .name = "link_poll"
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &s_poll_timer));
+    }
+}
+
+void bt_app_link_init(void)
+{
+    bt_app_link_timer_create();
+}
+
+void bt_app_link_start(uint16_t sync_conn_handle)
+{
+    bt_app_link_timer_create();
+
+    portENTER_CRITICAL(&s_link_lock);
+    s_head = 0;
+    s_count = 0;
+    s_polls = 0;
+    s_sync_conn_handle = sync_conn_handle;
+    s_active = true;
+    portEXIT_CRITICAL(&s_link_lock);
+
+    esp_timer_stop(s_poll_timer);
+    ESP_ERROR_CHECK(esp_timer_start_periodic(s_poll_timer, (uint64_t)s_period_ms * 1000));
+    ESP_LOGI(BT_APP_LINK_TAG, "polling sync conn 0x%x every %"PRIu32" ms", sync_conn_handle, s_period_ms);
+}
+
+void bt_app_link_stop(void)
+{
+    if (s_poll_timer) {
+        esp_timer_stop(s_poll_timer);
+    }
+    portENTER_CRITICAL(&s_link_lock);
+    s_active = false;
+    portEXIT_CRITICAL(&s_link_lock);
+}
+
+void bt_app_link_set_period(uint32_t period_ms)
+{
+    if (period_ms == 0) {
+        return;
+    }
+    s_period_ms = period_ms;
+    portENTER_CRITICAL(&s_link_lock);
+    bool active = s_active;
+    portEXIT_CRITICAL(&s_link_lock);
+    if (active && s_poll_timer) {
+        esp_timer_stop(s_poll_timer);
+        ESP_ERROR_CHECK(esp_timer_start_periodic(s_poll_timer, (uint64_t)s_period_ms * 1000));
+    }
+}
+
+void bt_app_link_add_rx_bytes(uint32_t bytes)
+{
+    s_rx_bytes += bytes;
+}
+
+static bool nums_went_backwards(const bt_app_link_pkt_nums_t *prev, const bt_app_link_pkt_nums_t *cur)
+{
+    return cur->rx_total < prev->rx_total || cur->rx_correct < prev->rx_correct ||
+           cur->rx_err < prev->rx_err || cur->rx_none < prev->rx_none ||
+           cur->rx_lost < prev->rx_lost || cur->tx_total < prev->tx_total ||
+           cur->tx_discarded < prev->tx_discarded;
+}
+
+void bt_app_link_on_pkt_nums(const bt_app_link_pkt_nums_t *nums, uint64_t now_us)
+{
+    portENTER_CRITICAL(&s_link_lock);
+    if (s_count > 0) {
+        const link_sample_t *last = &s_samples[(s_head + BT_APP_LINK_WINDOW) % (BT_APP_LINK_WINDOW + 1)];
+        if (nums_went_backwards(&last->nums, nums)) {
+            s_count = 0;
+        }
+    }
+    link_sample_t *slot = &s_samples[s_head];
+    slot->time_us = now_us;
+    slot->rx_bytes = s_rx_bytes;
+    slot->nums = *nums;
+    s_head = (s_head + 1) % (BT_APP_LINK_WINDOW + 1);
+    if (s_count < BT_APP_LINK_WINDOW + 1) {
+        s_count++;
+    }
+    s_polls++;
+    portEXIT_CRITICAL(&s_link_lock);
+}
+
+void bt_app_link_get_stats(bt_app_link_stats_t *stats)
+{
+    link_sample_t oldest, newest;
+    uint32_t count;
+
+    memset(stats, 0, sizeof(bt_app_link_stats_t));
+
+    portENTER_CRITICAL(&s_link_lock);
+    stats->active = s_active;
+    stats->polls = s_polls;
+    count = s_count;
+    if (count >= 2) {
+        newest = s_samples[(s_head + BT_APP_LINK_WINDOW) % (BT_APP_LINK_WINDOW + 1)];
+        oldest = s_samples[(s_head + BT_APP_LINK_WINDOW + 1 - count) % (BT_APP_LINK_WINDOW + 1)];
+    }
+    portEXIT_CRITICAL(&s_link_lock);
+
+    if (count < 2) {
+        return;
+    }
+
+    bt_app_link_pkt_nums_t *d = &stats->delta;
+    d->rx_total = newest.nums.rx_total - oldest.nums.rx_total;
+    d->rx_correct = newest.nums.rx_correct - oldest.nums.rx_correct;
+    d->rx_err = newest.nums.rx_err - oldest.nums.rx_err;
+    d->rx_none = newest.nums.rx_none - oldest.nums.rx_none;
+    d->rx_lost = newest.nums.rx_lost - oldest.nums.rx_lost;
+    d->tx_total = newest.nums.tx_total - oldest.nums.tx_total;
+    d->tx_discarded = newest.nums.tx_discarded - oldest.nums.tx_discarded;
+
+    uint64_t window_us = newest.time_us - oldest.time_us;
+    stats->window_ms = (uint32_t)(window_us / 1000);
+
+    if (d->rx_total > 0) {
+        uint64_t bad = (uint64_t)d->rx_err + d->rx_none + d->rx_lost;
+        stats->loss_permille = (uint32_t)(bad * 1000 / d->rx_total);
+    }
+    if (window_us > 0) {
+        uint64_t bits = (uint64_t)(newest.rx_bytes - oldest.rx_bytes) * 8;
+        stats->throughput_bps = (uint32_t)(bits * 1000000 / window_us);
+        if (d->rx_total > 0) {
+            stats->goodput_bps = (uint32_t)((uint64_t)stats->throughput_bps * d->rx_correct / d->rx_total);
+        }
+    }
+}
+
+static uint8_t *put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+size_t bt_app_link_dump(uint8_t *buf, size_t len)
+{
+    if (buf == NULL || len < LINK_DUMP_SIZE) {
+        return 0;
+    }
+    bt_app_link_stats_t st;
+    bt_app_link_get_stats(&st);
+
+    uint8_t *p = buf;
+    *p++ = BT_APP_LINK_DUMP_VERSION;
+    *p++ = st.active ? 1 : 0;
+    p = put_le16(p, (uint16_t)st.loss_permille);
+    p = put_le32(p, st.window_ms);
+    p = put_le32(p, st.delta.rx_total);
+    p = put_le32(p, st.delta.rx_correct);
+    p = put_le32(p, st.delta.rx_err);
+    p = put_le32(p, st.delta.rx_none);
+    p = put_le32(p, st.delta.rx_lost);
+    p = put_le32(p, st.delta.tx_total);
+    p = put_le32(p, st.delta.tx_discarded);
+    p = put_le32(p, st.throughput_bps);
+    p = put_le32(p, st.goodput_bps);
+    p = put_le32(p, st.polls);
+    return p - buf;
+}
@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_LINK_H__
+#define __BT_APP_LINK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BT_APP_LINK_TAG             "BT_APP_LINK"
+
+/* default period for requesting the (e)SCO packet statistics while audio is up */
+#define BT_APP_LINK_POLL_PERIOD_MS  (1000)
+
+/* number of polls the rolling figures are computed over */
+#define BT_APP_LINK_WINDOW          (10)
+
+#define BT_APP_LINK_DUMP_VERSION    (1)
+
+/* cumulative packet counts as reported by ESP_HF_PKT_STAT_NUMS_GET_EVT */
+typedef struct {
+    uint32_t rx_total;
+    uint32_t rx_correct;
+    uint32_t rx_err;            /*!< received with CRC error */
+    uint32_t rx_none;           /*!< nothing received in the slot */
+    uint32_t rx_lost;           /*!< partially lost */
+    uint32_t tx_total;
+    uint32_t tx_discarded;
+} bt_app_link_pkt_nums_t;
+
+/* figures over the rolling window */
+typedef struct {
+    bool active;
+    uint32_t window_ms;
+    bt_app_link_pkt_nums_t delta;   /*!< packet counts within the window */
+    uint32_t loss_permille;         /*!< (err + none + lost) / rx_total */
+    uint32_t throughput_bps;        /*!< audio bytes delivered by the incoming data callback */
+    uint32_t goodput_bps;           /*!< throughput scaled by the share of correctly received packets */
+    uint32_t polls;
+} bt_app_link_stats_t;
+
+/**
+ * @brief     create the poll timer; called once when the stack comes up
+ */
+void bt_app_link_init(void);
+
+/**
+ * @brief     start polling the packet statistics of an (e)SCO connection
+ */
+void bt_app_link_start(uint16_t sync_conn_handle);
+
+void bt_app_link_stop(void);
+
+/**
+ * @brief     change the poll period, takes effect immediately if polling
+ */
+void bt_app_link_set_period(uint32_t period_ms);
+
+/**
+ * @brief     feed one ESP_HF_PKT_STAT_NUMS_GET_EVT report
+ */
+void bt_app_link_on_pkt_nums(const bt_app_link_pkt_nums_t *nums, uint64_t now_us);
+
+/**
+ * @brief     account audio bytes delivered by the incoming data callback
+ */
+void bt_app_link_add_rx_bytes(uint32_t bytes);
+
+void bt_app_link_get_stats(bt_app_link_stats_t *stats);
+
+/**
+ * @brief     pack the current stats into a compact little-endian record
+ *
+ * @return    number of bytes written, 0 if buf is too small
+ */
+size_t bt_app_link_dump(uint8_t *buf, size_t len);
+
+#endif /* __BT_APP_LINK_H__ */
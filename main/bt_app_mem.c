@@ -0,0 +1,212 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_mem.c
+
+Overall Responsibility:
+Resource monitor. The task stacks were sized by guess and the audio path allocated on every block;
+this keeps the numbers needed to size stacks properly and to show which paths still allocate.
+
+Important Details:
+
+1. Sampling:
+   - A periodic esp_timer takes a sample every BT_APP_MEM_SAMPLE_MS: the stack high water mark of
+     every task in BT_APP_TASKS_TABLE (found by name, as FreeRTOS shortens it, in a static system
+     state snapshot, so a deleted task is never touched), free heap, lowest free heap since boot
+     and the largest free block. Stack numbers need CONFIG_FREERTOS_USE_TRACE_FACILITY.
+
+2. Warnings:
+   - A stack with less than BT_APP_MEM_STACK_WARN_BYTES left, free heap under
+     BT_APP_MEM_HEAP_WARN_BYTES, or a largest block under 1/BT_APP_MEM_FRAG_WARN_DIV of the free
+     heap is reported through the deferred log when it first happens, again only after it cleared.
+
+3. Allocation counts:
+   - `bt_app_mem_alloc` / `bt_app_mem_free` count allocations, frees, failures and bytes per
+     subsystem (BT_APP_MEM_SUBSYSTEMS) with relaxed atomics, so they are cheap on any path. The
+     audio generator writes from a scratch block in its session and has no subsystem of its own.
+
+4. Reporting:
+   - The `mem` command prints the last sample and the counters.
+
+5. Static mode (BT_APP_MEM_STATIC):
+   - Long lived tasks get their stack and TCB from .bss (the `stat` column of BT_APP_TASKS_TABLE),
+     the core and executor queues and the audio ring are created static, dispatch parameters come
+     from a fixed pool in bt_app_core.c. The audio task, ring and timer are set up once when the
+     stack comes up, so a call adds nothing to the heap and cannot fragment it. Only esp_timer has
+     no static variant; its few timers are created once at init and never deleted.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "bt_app_mem.h"
+#include "bt_app_tasks.h"
+#include "bt_app_dlog.h"
+
+#define BT_APP_MEM_NAME_ENTRY(id, name)     name,
+static const char *const s_subsys_name[BT_APP_MEM_SUBSYS_NUM] = {
+    BT_APP_MEM_SUBSYSTEMS(BT_APP_MEM_NAME_ENTRY)
+};
+
+typedef struct {
+    atomic_uint_least32_t allocs;
+    atomic_uint_least32_t frees;
+    atomic_uint_least32_t fails;
+    atomic_uint_least32_t bytes;
+} bt_app_mem_counters_t;
+
+static bt_app_mem_counters_t s_counters[BT_APP_MEM_SUBSYS_NUM];
+static portMUX_TYPE s_mem_lock = portMUX_INITIALIZER_UNLOCKED;
+static bt_app_mem_stats_t s_mem;
+static uint32_t s_warned_stack;             /* one bit per task */
+static bool s_warned_heap;
+static bool s_warned_frag;
+static esp_timer_handle_t s_sample_timer;
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+static TaskStatus_t s_ts[BT_APP_MEM_TASKS_MAX];     /* sampling only */
+#endif
+
+_Static_assert(BT_APP_TASK_NUM <= 32, "s_warned_stack has one bit per task");
+
+void *bt_app_mem_alloc(bt_app_mem_subsys_t sub, size_t size)
+{
+    void *p = malloc(size);
+    if (!p) {
+        atomic_fetch_add_explicit(&s_counters[sub].fails, 1, memory_order_relaxed);
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&s_counters[sub].allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s_counters[sub].bytes, size, memory_order_relaxed);
+    return p;
+}
+
+void bt_app_mem_free(bt_app_mem_subsys_t sub, void *p)
+{
+    if (p) {
+        atomic_fetch_add_explicit(&s_counters[sub].frees, 1, memory_order_relaxed);
+        free(p);
+    }
+}
+
+const char *bt_app_mem_subsys_name(bt_app_mem_subsys_t sub)
+{
+    return (sub < BT_APP_MEM_SUBSYS_NUM) ? s_subsys_name[sub] : "invalid";
+}
+
+void bt_app_mem_sample(void)
+{
+    uint32_t stack_free[BT_APP_TASK_NUM] = {0};
+    uint32_t stack_low = 0;
+    bool heap_low = false;
+    bool frag = false;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    // 0 if there are more tasks than fit, then this sample has no stack numbers
+    UBaseType_t num = uxTaskGetSystemState(s_ts, BT_APP_MEM_TASKS_MAX, NULL);
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        for (UBaseType_t j = 0; j < num; j++) {
+            if (bt_app_tasks_name_is(s_ts[j].pcTaskName, i)) {
+                stack_free[i] = s_ts[j].usStackHighWaterMark;
+                break;
+            }
+        }
+    }
+#endif
+    uint32_t heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    uint32_t heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    uint32_t heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    portENTER_CRITICAL(&s_mem_lock);
+    s_mem.samples++;
+    s_mem.heap_free = heap_free;
+    s_mem.heap_min_free = heap_min_free;
+    s_mem.heap_largest = heap_largest;
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        s_mem.stack_free[i] = stack_free[i];
+        if (stack_free[i] == 0) {
+            // not running, the next instance of the task warns on its own
+            s_warned_stack &= ~(1u << i);
+            continue;
+        }
+        if (stack_free[i] < s_mem.stack_free_min[i]) {
+            s_mem.stack_free_min[i] = stack_free[i];
+        }
+        if (stack_free[i] < BT_APP_MEM_STACK_WARN_BYTES) {
+            if (!(s_warned_stack & (1u << i))) {
+                stack_low |= 1u << i;
+            }
+            s_warned_stack |= 1u << i;
+        } else {
+            s_warned_stack &= ~(1u << i);
+        }
+    }
+    if (heap_free < BT_APP_MEM_HEAP_WARN_BYTES) {
+        heap_low = !s_warned_heap;
+        s_warned_heap = true;
+    } else {
+        s_warned_heap = false;
+    }
+    if (heap_largest < heap_free / BT_APP_MEM_FRAG_WARN_DIV) {
+        frag = !s_warned_frag;
+        s_warned_frag = true;
+    } else {
+        s_warned_frag = false;
+    }
+    s_mem.warnings += __builtin_popcount(stack_low) + heap_low + frag;
+    portEXIT_CRITICAL(&s_mem_lock);
+
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        if (stack_low & (1u << i)) {
+            BT_APP_DLOG(MEM_STACK_LOW, BT_APP_DLOG_STR(bt_app_tasks_def(i)->name), stack_free[i]);
+        }
+    }
+    if (heap_low) {
+        BT_APP_DLOG(MEM_HEAP_LOW, heap_free, heap_min_free);
+    }
+    if (frag) {
+        BT_APP_DLOG(MEM_HEAP_FRAG, heap_largest, heap_free);
+    }
+}
+
+static void bt_app_mem_sample_timer_cb(void *arg)
+{
+    bt_app_mem_sample();
+}
+
+void bt_app_mem_init(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = &bt_app_mem_sample_timer_cb,
+        .name = "mem_sample",
+    };
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        s_mem.stack_free_min[i] = UINT32_MAX;
+    }
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_sample_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(s_sample_timer, (uint64_t)BT_APP_MEM_SAMPLE_MS * 1000));
+}
+
+void bt_app_mem_get_stats(bt_app_mem_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_mem_lock);
+    *stats = s_mem;
+    portEXIT_CRITICAL(&s_mem_lock);
+    for (int i = 0; i < BT_APP_MEM_SUBSYS_NUM; i++) {
+        stats->subsys[i].allocs = atomic_load_explicit(&s_counters[i].allocs, memory_order_relaxed);
+        stats->subsys[i].frees = atomic_load_explicit(&s_counters[i].frees, memory_order_relaxed);
+        stats->subsys[i].fails = atomic_load_explicit(&s_counters[i].fails, memory_order_relaxed);
+        stats->subsys[i].bytes = atomic_load_explicit(&s_counters[i].bytes, memory_order_relaxed);
+    }
+}
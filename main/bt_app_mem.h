@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_MEM_H__
+#define __BT_APP_MEM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "bt_app_tasks.h"
+
+#define BT_APP_MEM_TAG              "BT_APP_MEM"
+
+/*
+ * 1: task stacks, queues, the audio ring and the dispatch parameters come from static storage and
+ * exist from boot; an audio connect or disconnect only resets state.
+ * 0: the audio task, ring and timer are created on each audio connect and deleted after.
+ */
+#ifndef BT_APP_MEM_STATIC
+#define BT_APP_MEM_STATIC           (1)
+#endif
+
+#define BT_APP_MEM_SAMPLE_MS        (2000)
+/* tasks in the system state snapshot, the rest is not looked at */
+#define BT_APP_MEM_TASKS_MAX        (40)
+
+/* warnings when a sample crosses these, once per crossing */
+#define BT_APP_MEM_STACK_WARN_BYTES (256)
+#define BT_APP_MEM_HEAP_WARN_BYTES  (16 * 1024)
+/* largest free block below 1/n of the free heap */
+#define BT_APP_MEM_FRAG_WARN_DIV    (4)
+
+/* X(id, name): who allocates through bt_app_mem_alloc */
+#define BT_APP_MEM_SUBSYSTEMS(X)                            \
+    X(DISPATCH,             "dispatch")                     \
+    X(CONSOLE,              "console")
+
+#define BT_APP_MEM_ENUM(id, name)   BT_APP_MEM_##id,
+typedef enum {
+    BT_APP_MEM_SUBSYSTEMS(BT_APP_MEM_ENUM)
+    BT_APP_MEM_SUBSYS_NUM
+} bt_app_mem_subsys_t;
+
+typedef struct {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t fails;
+    uint32_t bytes;                 /*!< total allocated, not live */
+} bt_app_mem_subsys_stats_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t warnings;
+    uint32_t heap_free;
+    uint32_t heap_min_free;         /*!< lowest since boot */
+    uint32_t heap_largest;          /*!< largest free block */
+    uint32_t stack_free[BT_APP_TASK_NUM];       /*!< headroom at the last sample, 0 if not running */
+    uint32_t stack_free_min[BT_APP_TASK_NUM];   /*!< lowest seen, UINT32_MAX if never running */
+    bt_app_mem_subsys_stats_t subsys[BT_APP_MEM_SUBSYS_NUM];
+} bt_app_mem_stats_t;
+
+/**
+ * @brief     start sampling every BT_APP_MEM_SAMPLE_MS
+ */
+void bt_app_mem_init(void);
+
+/**
+ * @brief     malloc counted against a subsystem
+ */
+void *bt_app_mem_alloc(bt_app_mem_subsys_t sub, size_t size);
+
+/**
+ * @brief     free a block from bt_app_mem_alloc of the same subsystem, NULL is fine
+ */
+void bt_app_mem_free(bt_app_mem_subsys_t sub, void *p);
+
+/**
+ * @brief     take a sample now; only the sampling timer calls this on the target
+ */
+void bt_app_mem_sample(void);
+
+void bt_app_mem_get_stats(bt_app_mem_stats_t *stats);
+
+const char *bt_app_mem_subsys_name(bt_app_mem_subsys_t sub);
+
+#endif /* __BT_APP_MEM_H__ */
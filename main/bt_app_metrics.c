@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_metrics.c
+
+Overall Responsibility:
+A small registry of named counters, gauges and latency histograms for the hot paths
+(dispatcher, audio ring buffer, SCO data callbacks, connection events).
+
+Important Details:
+
+1. Registration:
+   - Metrics are declared once in the X-macro lists of `bt_app_metrics.h`. The ids, the names and
+     the storage are all generated from those lists, nothing is allocated or registered at runtime.
+
+2. Updates:
+   - Counters and histogram buckets live in one cache-line-aligned slot per core. An update is a
+     single relaxed atomic add on the slot of the calling core, so two cores never bounce the
+     same line and no lock is ever taken.
+   - Gauges are a single relaxed atomic store, the last writer wins.
+
+3. Reading:
+   - `bt_app_metrics_dump` (the `metrics` console command) sums the per-core slots. The snapshot is
+     not atomic across metrics, which is fine for monitoring.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "bt_app_metrics.h"
+
+#define BT_APP_METRICS_NAME(id, name)   name,
+
+bt_app_metrics_slot_t bt_app_metrics_slots[portNUM_PROCESSORS];
+atomic_int_least32_t bt_app_metrics_gauges[BT_APP_METRIC_GAUGE_NUM];
+
+static const char *s_counter_names[] = {
+    BT_APP_METRICS_COUNTERS(BT_APP_METRICS_NAME)
+};
+
+static const char *s_gauge_names[] = {
+    BT_APP_METRICS_GAUGES(BT_APP_METRICS_NAME)
+};
+
+static const char *s_hist_names[] = {
+    BT_APP_METRICS_HISTOGRAMS(BT_APP_METRICS_NAME)
+};
+
+uint32_t bt_app_metrics_counter_get(bt_app_metric_counter_t id)
+{
+    uint32_t sum = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        sum += atomic_load_explicit(&bt_app_metrics_slots[core].counters[id], memory_order_relaxed);
+    }
+    return sum;
+}
+
+void bt_app_metrics_reset(void)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        bt_app_metrics_slot_t *slot = &bt_app_metrics_slots[core];
+        for (int i = 0; i < BT_APP_METRIC_COUNTER_NUM; i++) {
+            atomic_store_explicit(&slot->counters[i], 0, memory_order_relaxed);
+        }
+        for (int i = 0; i < BT_APP_METRIC_HIST_NUM; i++) {
+            for (int b = 0; b < BT_APP_METRICS_HIST_BUCKETS; b++) {
+                atomic_store_explicit(&slot->hist[i][b], 0, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void bt_app_metrics_dump(void)
+{
+    for (int i = 0; i < BT_APP_METRIC_COUNTER_NUM; i++) {
+        printf("%-26s %"PRIu32"\n", s_counter_names[i], bt_app_metrics_counter_get(i));
+    }
+    for (int i = 0; i < BT_APP_METRIC_GAUGE_NUM; i++) {
+        printf("%-26s %"PRId32"\n", s_gauge_names[i],
+               (int32_t)atomic_load_explicit(&bt_app_metrics_gauges[i], memory_order_relaxed));
+    }
+    for (int i = 0; i < BT_APP_METRIC_HIST_NUM; i++) {
+        uint32_t buckets[BT_APP_METRICS_HIST_BUCKETS] = {0};
+        uint32_t total = 0;
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            for (int b = 0; b < BT_APP_METRICS_HIST_BUCKETS; b++) {
+                buckets[b] += atomic_load_explicit(&bt_app_metrics_slots[core].hist[i][b], memory_order_relaxed);
+            }
+        }
+        for (int b = 0; b < BT_APP_METRICS_HIST_BUCKETS; b++) {
+            total += buckets[b];
+        }
+        printf("%-26s n=%"PRIu32"\n", s_hist_names[i], total);
+        if (total == 0) {
+            continue;
+        }
+        for (int b = 0; b < BT_APP_METRICS_HIST_BUCKETS; b++) {
+            if (buckets[b] == 0) {
+                continue;
+            }
+            uint32_t lo = (b == 0) ? 0 : (1u << (b - 1));
+            if (b == BT_APP_METRICS_HIST_BUCKETS - 1) {
+                printf("    [%6"PRIu32", inf) %"PRIu32"\n", lo, buckets[b]);
+            } else {
+                printf("    [%6"PRIu32", %6"PRIu32") %"PRIu32"\n", lo, 1u << b, buckets[b]);
+            }
+        }
+    }
+}
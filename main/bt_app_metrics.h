@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_METRICS_H__
+#define __BT_APP_METRICS_H__
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+
+#define BT_APP_METRICS_TAG          "BT_APP_METRICS"
+
+/* ESP32 data cache line, keeps the per-core slots from sharing a line */
+#define BT_APP_METRICS_CACHE_LINE   (32)
+
+/* histogram buckets are powers of two: [0,1), [1,2), [2,4) ... [2^14, inf) */
+#define BT_APP_METRICS_HIST_BUCKETS (16)
+
+/* X(id, name) */
+#define BT_APP_METRICS_COUNTERS(X)                          \
+    X(DISPATCH_ENQUEUED,    "dispatch.enqueued")            \
+    X(DISPATCH_DROPPED,     "dispatch.dropped")             \
+    X(DISPATCH_HANDLED,     "dispatch.handled")             \
+    X(RB_PRODUCED_BYTES,    "rb.produced_bytes")            \
+    X(RB_SEND_FAIL,         "rb.send_fail")                 \
+    X(RB_CONSUMED_BYTES,    "rb.consumed_bytes")            \
+    X(RB_UNDERRUN,          "rb.underrun")                  \
+    X(SCO_IN_FRAMES,        "sco.in_frames")                \
+    X(SCO_IN_BYTES,         "sco.in_bytes")                 \
+    X(SCO_OUT_FRAMES,       "sco.out_frames")               \
+    X(SCO_OUT_BYTES,        "sco.out_bytes")                \
+    X(HF_EVENTS,            "hf.events")                    \
+    X(SLC_CONNECTED,        "conn.slc_connected")           \
+    X(SLC_DISCONNECTED,     "conn.slc_disconnected")        \
+    X(AUDIO_CONNECTED,      "conn.audio_connected")         \
+    X(AUDIO_DISCONNECTED,   "conn.audio_disconnected")      \
+    X(CIEV_SENT,            "ind.ciev_sent")                \
+    X(CIEV_UNCHANGED,       "ind.ciev_unchanged")           \
+    X(CIEV_COALESCED,       "ind.ciev_coalesced")           \
+    X(FLOOR_GRANTS,         "floor.grants")                 \
+    X(FLOOR_COLLISIONS,     "floor.collisions")             \
+    X(FLOOR_GATED_FRAMES,   "floor.gated_frames")
+
+#define BT_APP_METRICS_GAUGES(X)                            \
+    X(RB_FILL,              "rb.fill_bytes")                \
+    X(AUDIO_STATE,          "conn.audio_state")
+
+#define BT_APP_METRICS_HISTOGRAMS(X)                        \
+    X(DISPATCH_LATENCY_US,  "dispatch.latency_us")          \
+    X(DISPATCH_HANDLER_US,  "dispatch.handler_us")          \
+    X(SCO_IN_INTERVAL_US,   "sco.in_interval_us")           \
+    X(SCO_OUT_INTERVAL_US,  "sco.out_interval_us")          \
+    X(HF_CB_US,             "hf.cb_us")                     \
+    X(HF_GEN_LATE_US,       "hf.gen_late_us")               \
+    X(FLOOR_TALK_MS,        "floor.talk_ms")
+
+#define BT_APP_METRICS_ENUM(id, name)   BT_APP_METRIC_##id,
+
+typedef enum {
+    BT_APP_METRICS_COUNTERS(BT_APP_METRICS_ENUM)
+    BT_APP_METRIC_COUNTER_NUM
+} bt_app_metric_counter_t;
+
+typedef enum {
+    BT_APP_METRICS_GAUGES(BT_APP_METRICS_ENUM)
+    BT_APP_METRIC_GAUGE_NUM
+} bt_app_metric_gauge_t;
+
+typedef enum {
+    BT_APP_METRICS_HISTOGRAMS(BT_APP_METRICS_ENUM)
+    BT_APP_METRIC_HIST_NUM
+} bt_app_metric_hist_t;
+
+/* one per core, written with relaxed atomics only */
+typedef struct {
+    atomic_uint_least32_t counters[BT_APP_METRIC_COUNTER_NUM];
+    atomic_uint_least32_t hist[BT_APP_METRIC_HIST_NUM][BT_APP_METRICS_HIST_BUCKETS];
+} __attribute__((aligned(BT_APP_METRICS_CACHE_LINE))) bt_app_metrics_slot_t;
+
+extern bt_app_metrics_slot_t bt_app_metrics_slots[portNUM_PROCESSORS];
+extern atomic_int_least32_t bt_app_metrics_gauges[BT_APP_METRIC_GAUGE_NUM];
+
+static inline void bt_app_metrics_add(bt_app_metric_counter_t id, uint32_t v)
+{
+    atomic_fetch_add_explicit(&bt_app_metrics_slots[xPortGetCoreID()].counters[id], v, memory_order_relaxed);
+}
+
+static inline void bt_app_metrics_inc(bt_app_metric_counter_t id)
+{
+    bt_app_metrics_add(id, 1);
+}
+
+static inline void bt_app_metrics_gauge_set(bt_app_metric_gauge_t id, int32_t v)
+{
+    atomic_store_explicit(&bt_app_metrics_gauges[id], v, memory_order_relaxed);
+}
+
+static inline void bt_app_metrics_hist_record(bt_app_metric_hist_t id, uint32_t v)
+{
+    uint32_t bucket = (v == 0) ? 0 : 32 - __builtin_clz(v);
+    if (bucket >= BT_APP_METRICS_HIST_BUCKETS) {
+        bucket = BT_APP_METRICS_HIST_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&bt_app_metrics_slots[xPortGetCoreID()].hist[id][bucket], 1, memory_order_relaxed);
+}
+
+/**
+ * @brief     print every metric, counters and histograms summed over the cores
+ */
+void bt_app_metrics_dump(void);
+
+/**
+ * @brief     zero counters and histograms, gauges keep their value
+ */
+void bt_app_metrics_reset(void);
+
+uint32_t bt_app_metrics_counter_get(bt_app_metric_counter_t id);
+
+#endif /* __BT_APP_METRICS_H__ */
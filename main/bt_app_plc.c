@@ -0,0 +1,301 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_plc.c
+
+Overall Responsibility:
+Packet loss concealment for the incoming eSCO audio. When the link drops a frame the HCI data
+callback either is not called at all or receives a zero-filled payload. Forwarding that as-is
+produces an audible click, so the missing audio is synthesized from the recent past instead.
+
+Important Details:
+
+1. Loss detection:
+   - From arrival timing: a gap of more than 1.5 frame periods between two incoming frames means
+     frames went missing, their number is rounded from the gap. Gaps longer than
+     BT_APP_PLC_MAX_GAP_FRAMES are a stream restart and are not filled.
+   - From frame status: the caller flags bad frames, `bt_app_plc_frame_is_lost` recognises the
+     zero-filled payloads the stack hands up for lost packets. Zeros are also what genuine silence
+     looks like, so only an isolated zero frame right after audio counts as lost; the rest of a
+     run of zero frames passes through as silence.
+   - A stream stopped on purpose (the half duplex floor gate) calls `bt_app_plc_reset`, then the
+     frames not received are not concealed, whatever the length of the gap.
+
+2. Synthesis (pitch-based waveform repetition, after ITU-T G.711 Appendix I):
+   - On the first lost frame the pitch period is estimated by normalized cross-correlation over
+     the history and the last pitch period is repeated.
+   - After 10 ms of loss the repeated section grows to two periods, after 20 ms to three, which
+     keeps long losses from sounding buzzy.
+   - The output is kept at full level for 10 ms, then faded out linearly to silence at 60 ms.
+   - The first good frame after a loss is cross-faded from the synthetic signal; the fade is
+     longer the longer the loss was.
+
+3. Rates:
+   - 8 kHz (CVSD) and 16 kHz (mSBC) are both supported, all lengths are derived from the rate.
+
+4. Measurement only:
+   - Without an output callback nothing takes the audio, so losses are detected and counted but
+     nothing is synthesized and no history is kept. This is how bt_app_hf.c runs it: this board
+     has no sink for the HF's audio, the stats are all the PLC delivers there.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "bt_app_plc.h"
+
+#define PLC_RATE_KHZ_MAX          (16)
+#define PLC_FRAME_MAX             (PLC_RATE_KHZ_MAX * 15)           /* 15 ms frames at most */
+
+/* pitch search range 2.5 ms .. 15 ms, correlation window 5 ms, all in samples per kHz */
+#define PLC_PITCH_MIN_X2_PER_KHZ  (5)
+#define PLC_PITCH_MAX_PER_KHZ     (15)
+#define PLC_CORR_LEN_PER_KHZ      (5)
+#define PLC_PITCH_MAX             (PLC_RATE_KHZ_MAX * PLC_PITCH_MAX_PER_KHZ)
+#define PLC_HIST_MAX              (3 * PLC_PITCH_MAX)
+
+#define PLC_FULL_LEVEL_MS         (10)
+#define PLC_SILENT_MS             (60)
+#define PLC_PERIOD_STEP_MS        (10)
+#define PLC_OLA_MS                (4)
+#define PLC_OLA_MAX_MS            (10)
+
+typedef struct {
+    uint32_t rate_khz;
+    bt_app_plc_output_cb_t cb;
+
+    int16_t hist[PLC_HIST_MAX];         /* last real output, newest sample at the end */
+    uint32_t hist_len;
+    uint32_t hist_fill;
+
+    int16_t pitch_buf[PLC_HIST_MAX];    /* snapshot of the history taken when a loss starts */
+    uint32_t pitch;
+    uint32_t pos;
+
+    uint32_t lost_frames;               /* consecutive frames concealed so far */
+    uint32_t lost_samples;
+    uint64_t last_arrival_us;
+    bool prev_zero;                     /* the previous frame was all zero */
+
+    bt_app_plc_stats_t stats;
+} plc_state_t;
+
+static plc_state_t s_plc;
+static int16_t s_plc_scratch[PLC_FRAME_MAX];
+
+void bt_app_plc_init(uint32_t sample_rate_khz, bt_app_plc_output_cb_t cb)
+{
+    if (sample_rate_khz == 0 || sample_rate_khz > PLC_RATE_KHZ_MAX) {
+        ESP_LOGW(BT_APP_PLC_TAG, "%s unsupported rate %"PRIu32" kHz", __func__, sample_rate_khz);
+        sample_rate_khz = PLC_RATE_KHZ_MAX;
+    }
+    memset(&s_plc, 0, sizeof(s_plc));
+    s_plc.rate_khz = sample_rate_khz;
+    s_plc.cb = cb;
+    s_plc.hist_len = 3 * PLC_PITCH_MAX_PER_KHZ * sample_rate_khz;
+}
+
+bool bt_app_plc_frame_is_lost(const int16_t *samples, uint32_t num)
+{
+    int16_t acc = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        acc |= samples[i];
+    }
+    bool lost = (acc == 0) && !s_plc.prev_zero;
+    s_plc.prev_zero = (acc == 0);
+    return lost;
+}
+
+void bt_app_plc_reset(void)
+{
+    s_plc.lost_frames = 0;
+    s_plc.lost_samples = 0;
+    s_plc.hist_fill = 0;
+    s_plc.last_arrival_us = 0;
+    s_plc.prev_zero = false;
+}
+
+void bt_app_plc_get_stats(bt_app_plc_stats_t *stats)
+{
+    if (stats) {
+        memcpy(stats, &s_plc.stats, sizeof(bt_app_plc_stats_t));
+    }
+}
+
+static void hist_append(const int16_t *samples, uint32_t num)
+{
+    uint32_t len = s_plc.hist_len;
+    if (num >= len) {
+        memcpy(s_plc.hist, samples + num - len, len * sizeof(int16_t));
+    } else {
+        memmove(s_plc.hist, s_plc.hist + num, (len - num) * sizeof(int16_t));
+        memcpy(s_plc.hist + len - num, samples, num * sizeof(int16_t));
+    }
+    s_plc.hist_fill = (s_plc.hist_fill + num > len) ? len : s_plc.hist_fill + num;
+}
+
+static uint32_t estimate_pitch(void)
+{
+    const uint32_t pmin = s_plc.rate_khz * PLC_PITCH_MIN_X2_PER_KHZ / 2;
+    const uint32_t pmax = s_plc.rate_khz * PLC_PITCH_MAX_PER_KHZ;
+    const uint32_t win = s_plc.rate_khz * PLC_CORR_LEN_PER_KHZ;
+    const int16_t *ref = s_plc.hist + s_plc.hist_len - win;
+
+    uint32_t best = pmax;
+    float best_score = 0.0f;
+    for (uint32_t t = pmin; t <= pmax; t++) {
+        const int16_t *cand = ref - t;
+        float corr = 0.0f;
+        float energy = 1.0f;
+        for (uint32_t i = 0; i < win; i++) {
+            corr += (float)ref[i] * cand[i];
+            energy += (float)cand[i] * cand[i];
+        }
+        /* compare corr^2 / energy without a square root, negative correlation never wins */
+        if (corr > 0.0f) {
+            float score = corr * corr / energy;
+            if (score > best_score) {
+                best_score = score;
+                best = t;
+            }
+        }
+    }
+    return best;
+}
+
+/* Q15 attenuation after `elapsed` samples of loss */
+static int32_t loss_gain_q15(uint32_t elapsed)
+{
+    const uint32_t full = s_plc.rate_khz * PLC_FULL_LEVEL_MS;
+    const uint32_t silent = s_plc.rate_khz * PLC_SILENT_MS;
+    if (elapsed <= full) {
+        return 32767;
+    }
+    if (elapsed >= silent) {
+        return 0;
+    }
+    return (int32_t)(32767 * (silent - elapsed) / (silent - full));
+}
+
+/* next synthetic sample, repeating the last one to three pitch periods of the snapshot */
+static inline int16_t synth_next(void)
+{
+    uint32_t periods = 1 + s_plc.lost_samples / (s_plc.rate_khz * PLC_PERIOD_STEP_MS);
+    if (periods > 3) {
+        periods = 3;
+    }
+    uint32_t span = periods * s_plc.pitch;
+    int16_t v = s_plc.pitch_buf[s_plc.hist_len - span + (s_plc.pos % span)];
+    s_plc.pos++;
+    return v;
+}
+
+static void conceal(int16_t *out, uint32_t num)
+{
+    if (s_plc.lost_frames == 0) {
+        s_plc.pos = 0;
+        s_plc.lost_samples = 0;
+        if (s_plc.cb == NULL || s_plc.hist_fill < s_plc.hist_len) {
+            /* measurement only, or not enough history for a pitch estimate yet */
+            s_plc.pitch = 0;
+        } else {
+            s_plc.pitch = estimate_pitch();
+            memcpy(s_plc.pitch_buf, s_plc.hist, s_plc.hist_len * sizeof(int16_t));
+        }
+        s_plc.stats.bursts++;
+    }
+
+    if (s_plc.cb == NULL) {
+        /* counted only */
+    } else if (s_plc.pitch == 0) {
+        memset(out, 0, num * sizeof(int16_t));
+    } else {
+        int32_t g0 = loss_gain_q15(s_plc.lost_samples);
+        int32_t g1 = loss_gain_q15(s_plc.lost_samples + num);
+        for (uint32_t i = 0; i < num; i++) {
+            int32_t g = g0 + (g1 - g0) * (int32_t)i / (int32_t)num;
+            out[i] = (int16_t)((synth_next() * g) >> 15);
+        }
+    }
+
+    s_plc.lost_frames++;
+    s_plc.lost_samples += num;
+    s_plc.stats.frames_concealed++;
+    if (s_plc.lost_frames > s_plc.stats.max_burst) {
+        s_plc.stats.max_burst = s_plc.lost_frames;
+    }
+}
+
+/* cross-fade the first good frame after a loss from the synthetic signal */
+static void recover(int16_t *samples, uint32_t num)
+{
+    if (s_plc.pitch != 0) {
+        uint32_t ola = s_plc.rate_khz * (PLC_OLA_MS + PLC_OLA_MS * (s_plc.lost_samples / (s_plc.rate_khz * PLC_PERIOD_STEP_MS)));
+        if (ola > s_plc.rate_khz * PLC_OLA_MAX_MS) {
+            ola = s_plc.rate_khz * PLC_OLA_MAX_MS;
+        }
+        if (ola > num) {
+            ola = num;
+        }
+        int32_t g = loss_gain_q15(s_plc.lost_samples);
+        for (uint32_t i = 0; i < ola; i++) {
+            int32_t synth = (synth_next() * g) >> 15;
+            samples[i] = (int16_t)((synth * (int32_t)(ola - i) + samples[i] * (int32_t)i) / (int32_t)ola);
+        }
+    }
+    s_plc.lost_frames = 0;
+    s_plc.lost_samples = 0;
+}
+
+void bt_app_plc_process(int16_t *samples, uint32_t num, uint64_t arrival_us, bool bad)
+{
+    if (samples == NULL || num == 0 || num > PLC_FRAME_MAX || s_plc.rate_khz == 0) {
+        return;
+    }
+
+    uint64_t frame_us = (uint64_t)num * 1000 / s_plc.rate_khz;
+    if (s_plc.last_arrival_us != 0 && arrival_us > s_plc.last_arrival_us) {
+        uint64_t gap = arrival_us - s_plc.last_arrival_us;
+        if (gap >= frame_us * 3 / 2) {
+            uint32_t missing = (uint32_t)((gap + frame_us / 2) / frame_us) - 1;
+            if (missing > BT_APP_PLC_MAX_GAP_FRAMES) {
+                /* the stream paused rather than lost packets, start over */
+                s_plc.lost_frames = 0;
+                s_plc.lost_samples = 0;
+                s_plc.hist_fill = 0;
+            } else {
+                s_plc.stats.frames_missing += missing;
+                for (uint32_t i = 0; i < missing; i++) {
+                    conceal(s_plc_scratch, num);
+                    if (s_plc.cb) {
+                        s_plc.cb(s_plc_scratch, num);
+                    }
+                }
+            }
+        }
+    }
+    s_plc.last_arrival_us = arrival_us;
+
+    if (bad) {
+        s_plc.stats.frames_bad++;
+        conceal(samples, num);
+    } else {
+        if (s_plc.lost_frames) {
+            recover(samples, num);
+        }
+        s_plc.stats.frames_good++;
+        if (s_plc.cb) {
+            hist_append(samples, num);
+        }
+    }
+
+    if (s_plc.cb) {
+        s_plc.cb(samples, num);
+    }
+}
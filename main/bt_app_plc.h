@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_PLC_H__
+#define __BT_APP_PLC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BT_APP_PLC_TAG              "BT_APP_PLC"
+
+/* longest gap (in frames) that is filled in one go, longer gaps are treated as a restart */
+#define BT_APP_PLC_MAX_GAP_FRAMES   (8)
+
+/**
+ * @brief     receives every frame leaving the PLC, real or concealed
+ */
+typedef void (* bt_app_plc_output_cb_t)(int16_t *samples, uint32_t num);
+
+typedef struct {
+    uint32_t frames_good;           /*!< frames passed through unchanged */
+    uint32_t frames_concealed;      /*!< frames synthesized, all causes */
+    uint32_t frames_bad;            /*!< frames delivered but flagged bad or zero-filled */
+    uint32_t frames_missing;        /*!< frames detected missing from arrival timing */
+    uint32_t bursts;                /*!< loss bursts (runs of consecutive concealed frames) */
+    uint32_t max_burst;             /*!< longest run of consecutive concealed frames */
+} bt_app_plc_stats_t;
+
+/**
+ * @brief     reset the concealment state for a new audio connection
+ *
+ * @param     sample_rate_khz: 8 for CVSD, 16 for mSBC
+ * @param     cb: frame output; NULL to only detect and count losses, nothing is synthesized
+ */
+void bt_app_plc_init(uint32_t sample_rate_khz, bt_app_plc_output_cb_t cb);
+
+/**
+ * @brief     true when a frame looks like a lost packet: all zero right after a frame with audio
+ *
+ *            The stack decodes a lost packet to zeros, but the HF also sends zeros for real
+ *            silence. Only the first zero frame after audio is reported lost, a run of them is
+ *            silence and passes through. Call once per received frame, in order.
+ */
+bool bt_app_plc_frame_is_lost(const int16_t *samples, uint32_t num);
+
+/**
+ * @brief     forget the history and arrival time, as if the stream started again
+ *
+ *            For a stream that is stopped on purpose (half duplex gate), so the frames not
+ *            received meanwhile are neither concealed nor cross-faded when it resumes.
+ */
+void bt_app_plc_reset(void);
+
+/**
+ * @brief     feed one received frame
+ *
+ *            Frames missing since the previous call (detected from arrival_us) are concealed and
+ *            emitted first. A frame flagged bad is replaced by a concealed one, a good frame is
+ *            emitted, cross-faded from the synthetic signal if it ends a loss burst.
+ */
+void bt_app_plc_process(int16_t *samples, uint32_t num, uint64_t arrival_us, bool bad);
+
+void bt_app_plc_get_stats(bt_app_plc_stats_t *stats);
+
+#endif /* __BT_APP_PLC_H__ */
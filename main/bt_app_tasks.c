@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_tasks.c
+
+Overall Responsibility:
+Task topology of the application. Bluedroid and the controller are pinned to one core; the tasks
+created here used to float and competed with them. `BT_APP_TASKS_TABLE` in `bt_app_tasks.h` is the
+one place that says where each task runs, at which priority and with how much stack.
+
+Important Details:
+
+1. Placement:
+   - Control tasks (BtAppT, the console executor and scripts) stay on the Bluedroid core, next to
+     the stack they talk to. The audio generator goes to the other core. The deferred log drain may
+     run anywhere. On a single core build everything lands on core 0.
+   - Tasks created by ESP-IDF and Bluedroid are placed by sdkconfig: BT_APP_TASKS_FOREIGN lists
+     them with the core that follows from it. The esp_timer task runs the timer callbacks (link
+     polls, indicator flushes, audio deadlines) and pthreads would run whatever a component gives
+     them, so neither may be pinned to the audio core; the build stops if sdkconfig does that.
+   - `bt_app_tasks_check` runs at boot and with the `tasks` command. It looks at the core every
+     known task is really on and warns for each one off the plan, whoever created it.
+
+2. Creation:
+   - `bt_app_tasks_create` looks the task up in the table and creates it pinned. Modules keep their
+     own handles and delete their tasks with `bt_app_tasks_delete`, which first gives the task's
+     deferred log ring back, so deleted tasks never use up the ring pool.
+   - With BT_APP_MEM_STATIC a task marked `stat` is created with xTaskCreateStaticPinnedToCore on
+     its own stack array and TCB, sized from the table at compile time. Such a task is never deleted,
+     a second create of it fails instead of reusing storage that may still be in use.
+
+3. Reporting (`tasks` command):
+   - Stack headroom from the high water mark and CPU usage since the previous report, in percent
+     of one core, from the FreeRTOS run time counters. Tasks are found by name in the system state,
+     so one that is not running is simply shown as such. FreeRTOS cuts names to
+     configMAX_TASK_NAME_LEN - 1 characters (BtAppSendDataTask is kept as BtAppSendDataTa), so only
+     that much of the table name is compared. Without CONFIG_FREERTOS_USE_TRACE_FACILITY
+     only the table is printed, without CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS no CPU usage.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "bt_app_tasks.h"
+#include "bt_app_mem.h"
+#include "bt_app_dlog.h"
+
+#define BT_APP_TASKS_DEF_ENTRY(id, name, core, prio, stack, stat)   { name, core, prio, stack, stat },
+static const bt_app_task_def_t s_tasks[BT_APP_TASK_NUM] = {
+    BT_APP_TASKS_TABLE(BT_APP_TASKS_DEF_ENTRY)
+};
+
+#define BT_APP_TASKS_FOREIGN_ENTRY(name, core)  { name, core },
+static const struct {
+    const char *name;
+    BaseType_t core;
+} s_foreign[] = {
+    BT_APP_TASKS_FOREIGN(BT_APP_TASKS_FOREIGN_ENTRY)
+};
+
+#if !CONFIG_FREERTOS_UNICORE
+_Static_assert(BT_APP_TASKS_CORE_TIMER != BT_APP_TASKS_CORE_AUDIO,
+               "CONFIG_ESP_TIMER_TASK_AFFINITY puts the timer callbacks on the audio core");
+_Static_assert(BT_APP_TASKS_CORE_PTHREAD != BT_APP_TASKS_CORE_AUDIO,
+               "CONFIG_PTHREAD_TASK_CORE_DEFAULT puts pthreads on the audio core");
+#endif
+
+#if BT_APP_MEM_STATIC
+/* ESP-IDF counts stack depth in bytes, StackType_t is one byte */
+#define BT_APP_TASKS_STACK_DECL(id, name, core, prio, stack, stat)  static StackType_t s_stack_##id[(stat) ? (stack) : 1];
+BT_APP_TASKS_TABLE(BT_APP_TASKS_STACK_DECL)
+
+#define BT_APP_TASKS_STACK_ENTRY(id, name, core, prio, stack, stat) (stat) ? s_stack_##id : NULL,
+static StackType_t *const s_stacks[BT_APP_TASK_NUM] = {
+    BT_APP_TASKS_TABLE(BT_APP_TASKS_STACK_ENTRY)
+};
+static StaticTask_t s_tcbs[BT_APP_TASK_NUM];
+static uint32_t s_created;                  /* static tasks, one bit per task */
+static portMUX_TYPE s_tasks_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+/* counters at the previous report; only the console executor reports */
+static TaskHandle_t s_last_handle[BT_APP_TASK_NUM];
+static configRUN_TIME_COUNTER_TYPE s_last_run[BT_APP_TASK_NUM];
+static configRUN_TIME_COUNTER_TYPE s_last_total;
+#endif
+
+BaseType_t bt_app_tasks_create(bt_app_task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle)
+{
+    const bt_app_task_def_t *t = &s_tasks[id];
+#if BT_APP_MEM_STATIC
+    if (t->stat) {
+        portENTER_CRITICAL(&s_tasks_lock);
+        bool again = s_created & (1u << id);
+        s_created |= 1u << id;
+        portEXIT_CRITICAL(&s_tasks_lock);
+        if (again) {
+            ESP_LOGE(BT_APP_TASKS_TAG, "%s: %s is static and exists already", __func__, t->name);
+            return pdFAIL;
+        }
+        TaskHandle_t h = xTaskCreateStaticPinnedToCore(fn, t->name, t->stack, arg, t->prio, s_stacks[id], &s_tcbs[id], t->core);
+        if (handle) {
+            *handle = h;
+        }
+        return h ? pdPASS : pdFAIL;
+    }
+#endif
+    BaseType_t ret = xTaskCreatePinnedToCore(fn, t->name, t->stack, arg, t->prio, handle, t->core);
+    if (ret != pdPASS) {
+        ESP_LOGE(BT_APP_TASKS_TAG, "%s: no memory for %s", __func__, t->name);
+    }
+    return ret;
+}
+
+void bt_app_tasks_delete(TaskHandle_t handle)
+{
+    bt_app_dlog_release(handle ? handle : xTaskGetCurrentTaskHandle());
+    vTaskDelete(handle);
+}
+
+const bt_app_task_def_t *bt_app_tasks_def(bt_app_task_id_t id)
+{
+    return &s_tasks[id];
+}
+
+bool bt_app_tasks_name_is(const char *task_name, bt_app_task_id_t id)
+{
+    return strncmp(task_name, s_tasks[id].name, configMAX_TASK_NAME_LEN - 1) == 0;
+}
+
+static void bt_app_tasks_core_str(char *buf, size_t len, BaseType_t core)
+{
+    if (core == tskNO_AFFINITY) {
+        snprintf(buf, len, "any");
+    } else {
+        snprintf(buf, len, "%d", (int)core);
+    }
+}
+
+static void bt_app_tasks_print_def(const bt_app_task_def_t *t)
+{
+    char core[12];
+    bt_app_tasks_core_str(core, sizeof(core), t->core);
+    printf("  %-18s %4s %4u %6"PRIu32, t->name, core, (unsigned)t->prio, t->stack);
+}
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+/* planned core of a task found by name in the system state, false for a task not in the plan */
+static bool bt_app_tasks_plan(const char *task_name, BaseType_t *core)
+{
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        if (bt_app_tasks_name_is(task_name, i)) {
+            *core = s_tasks[i].core;
+            return true;
+        }
+    }
+    for (size_t i = 0; i < sizeof(s_foreign) / sizeof(s_foreign[0]); i++) {
+        if (strncmp(task_name, s_foreign[i].name, configMAX_TASK_NAME_LEN - 1) == 0) {
+            *core = s_foreign[i].core;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t bt_app_tasks_check(void)
+{
+    UBaseType_t num = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *st = bt_app_mem_alloc(BT_APP_MEM_CONSOLE, num * sizeof(TaskStatus_t));
+    uint32_t off_plan = 0;
+    if (!st) {
+        return 0;
+    }
+    num = uxTaskGetSystemState(st, num, NULL);
+    for (UBaseType_t j = 0; j < num; j++) {
+        BaseType_t plan;
+        if (!bt_app_tasks_plan(st[j].pcTaskName, &plan)) {
+            continue;
+        }
+        BaseType_t core = xTaskGetCoreID(st[j].xHandle);
+        if (core != plan) {
+            char on[12], want[12];
+            bt_app_tasks_core_str(on, sizeof(on), core);
+            bt_app_tasks_core_str(want, sizeof(want), plan);
+            ESP_LOGW(BT_APP_TASKS_TAG, "%s runs on core %s, planned for %s", st[j].pcTaskName, on, want);
+            off_plan++;
+        }
+    }
+    bt_app_mem_free(BT_APP_MEM_CONSOLE, st);
+    return off_plan;
+}
+
+void bt_app_tasks_print(void)
+{
+    // a few spare entries for tasks created meanwhile
+    UBaseType_t num = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *st = bt_app_mem_alloc(BT_APP_MEM_CONSOLE, num * sizeof(TaskStatus_t));
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    if (!st) {
+        printf("no memory\n");
+        return;
+    }
+    num = uxTaskGetSystemState(st, num, &total);
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    configRUN_TIME_COUNTER_TYPE span = total - s_last_total;
+    s_last_total = total;
+    printf("  %-18s %4s %4s %6s %6s %6s  (last %"PRIu32" ms)\n", "task", "core", "prio", "stack", "free", "cpu%",
+           (uint32_t)(span / 1000));
+#else
+    printf("  %-18s %4s %4s %6s %6s\n", "task", "core", "prio", "stack", "free");
+#endif
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        const TaskStatus_t *ts = NULL;
+        for (UBaseType_t j = 0; j < num; j++) {
+            if (bt_app_tasks_name_is(st[j].pcTaskName, i)) {
+                ts = &st[j];
+                break;
+            }
+        }
+        bt_app_tasks_print_def(&s_tasks[i]);
+        if (!ts) {
+            printf("   not running\n");
+            continue;
+        }
+        printf(" %6u", (unsigned)ts->usStackHighWaterMark);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        // a task created again since the last report starts from zero
+        configRUN_TIME_COUNTER_TYPE run = ts->ulRunTimeCounter;
+        if (ts->xHandle == s_last_handle[i]) {
+            run -= s_last_run[i];
+        }
+        s_last_handle[i] = ts->xHandle;
+        s_last_run[i] = ts->ulRunTimeCounter;
+        uint32_t permille = span ? (uint32_t)((uint64_t)run * 1000 / span) : 0;
+        printf(" %4"PRIu32".%"PRIu32, permille / 10, permille % 10);
+#endif
+        printf("\n");
+    }
+    bt_app_mem_free(BT_APP_MEM_CONSOLE, st);
+}
+#else
+uint32_t bt_app_tasks_check(void)
+{
+    return 0;
+}
+
+void bt_app_tasks_print(void)
+{
+    printf("  %-18s %4s %4s %6s  (no task stats, CONFIG_FREERTOS_USE_TRACE_FACILITY is off)\n", "task", "core", "prio", "stack");
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        bt_app_tasks_print_def(&s_tasks[i]);
+        printf("\n");
+    }
+}
+#endif
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_TASKS_H__
+#define __BT_APP_TASKS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define BT_APP_TASKS_TAG            "BT_APP_TASKS"
+
+/* control stays with Bluedroid, audio goes to the other core */
+#define BT_APP_TASKS_CORE_CTRL      CONFIG_BT_BLUEDROID_PINNED_TO_CORE
+#if CONFIG_FREERTOS_UNICORE
+#define BT_APP_TASKS_CORE_AUDIO     0
+#else
+#define BT_APP_TASKS_CORE_AUDIO     (1 - CONFIG_BT_BLUEDROID_PINNED_TO_CORE)
+#endif
+#define BT_APP_TASKS_CORE_ANY       tskNO_AFFINITY
+
+/* esp_timer callbacks run in the esp_timer task, pinned by CONFIG_ESP_TIMER_TASK_AFFINITY */
+#if CONFIG_ESP_TIMER_TASK_AFFINITY_CPU0
+#define BT_APP_TASKS_CORE_TIMER     0
+#elif CONFIG_ESP_TIMER_TASK_AFFINITY_CPU1
+#define BT_APP_TASKS_CORE_TIMER     1
+#else
+#define BT_APP_TASKS_CORE_TIMER     tskNO_AFFINITY
+#endif
+
+/* pthreads go to CONFIG_PTHREAD_TASK_CORE_DEFAULT, -1 for any core */
+#if CONFIG_PTHREAD_TASK_CORE_DEFAULT < 0
+#define BT_APP_TASKS_CORE_PTHREAD   tskNO_AFFINITY
+#else
+#define BT_APP_TASKS_CORE_PTHREAD   CONFIG_PTHREAD_TASK_CORE_DEFAULT
+#endif
+
+/*
+ * Every application task: X(id, name, core, priority, stack, stat)
+ * The PLC, gain and floor processing run inside the SCO data callbacks on the Bluetooth stack
+ * tasks, so the generator is the only audio task of the application.
+ * stat 1: created once and never deleted, so with BT_APP_MEM_STATIC its stack and TCB are static.
+ * Scripts delete themselves and start again, their stack stays on the heap.
+ */
+#define BT_APP_TASKS_TABLE(X)                                                                       \
+    X(CORE, "BtAppT",            BT_APP_TASKS_CORE_CTRL,  configMAX_PRIORITIES - 3, 2048, 1)       \
+    X(SEND, "BtAppSendDataTask", BT_APP_TASKS_CORE_AUDIO, configMAX_PRIORITIES - 3, 2048, 1)       \
+    X(SCR,  "HfScrT",            BT_APP_TASKS_CORE_CTRL,  configMAX_PRIORITIES - 5, 4096, 0)       \
+    X(EXEC, "HfExecT",           BT_APP_TASKS_CORE_CTRL,  configMAX_PRIORITIES - 6, 4096, 1)       \
+    X(DLOG, "BtAppDlogT",        BT_APP_TASKS_CORE_ANY,   tskIDLE_PRIORITY + 1,     3072, 1)
+
+/*
+ * Tasks ESP-IDF and Bluedroid create on the same cores: X(name, core)
+ * Where they run follows from sdkconfig; bt_app_tasks_check finds them by name and compares.
+ */
+#define BT_APP_TASKS_FOREIGN(X)                                                                     \
+    X("BTC_TASK",                       BT_APP_TASKS_CORE_CTRL)                                     \
+    X("BTU_TASK",                       BT_APP_TASKS_CORE_CTRL)                                     \
+    X("btController",                   CONFIG_BTDM_CTRL_PINNED_TO_CORE)                            \
+    X("esp_timer",                      BT_APP_TASKS_CORE_TIMER)                                    \
+    X(CONFIG_PTHREAD_TASK_NAME_DEFAULT, BT_APP_TASKS_CORE_PTHREAD)
+
+#define BT_APP_TASKS_ENUM(id, name, core, prio, stack, stat)    BT_APP_TASK_##id,
+typedef enum {
+    BT_APP_TASKS_TABLE(BT_APP_TASKS_ENUM)
+    BT_APP_TASK_NUM
+} bt_app_task_id_t;
+
+typedef struct {
+    const char *name;
+    BaseType_t core;
+    UBaseType_t prio;
+    uint32_t stack;
+    bool stat;
+} bt_app_task_def_t;
+
+/**
+ * @brief     create a task from the table, pinned to its core; a static task only once
+ *
+ * @return    pdPASS, errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY, or pdFAIL for a static task created twice
+ */
+BaseType_t bt_app_tasks_create(bt_app_task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle);
+
+/**
+ * @brief     give back the task's deferred log ring, then delete it; every task delete goes here
+ *
+ * @param     handle: the task, NULL for the calling task (which does not return)
+ */
+void bt_app_tasks_delete(TaskHandle_t handle);
+
+/**
+ * @brief     table entry of a task
+ */
+const bt_app_task_def_t *bt_app_tasks_def(bt_app_task_id_t id);
+
+/**
+ * @brief     whether a name from the system state is the task's; FreeRTOS keeps only the first
+ *            configMAX_TASK_NAME_LEN - 1 characters of a name
+ */
+bool bt_app_tasks_name_is(const char *task_name, bt_app_task_id_t id);
+
+/**
+ * @brief     print the table with stack headroom and CPU usage of each task since the last call
+ */
+void bt_app_tasks_print(void);
+
+/**
+ * @brief     compare the core every running task of the table and of BT_APP_TASKS_FOREIGN is on
+ *            with the plan, warn for each one that is elsewhere
+ *
+ * @return    number of tasks off the plan, 0 without CONFIG_FREERTOS_USE_TRACE_FACILITY
+ */
+uint32_t bt_app_tasks_check(void);
+
+#endif /* __BT_APP_TASKS_H__ */
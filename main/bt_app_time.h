@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_time.h
+
+Overall Responsibility:
+Time base for audio deadlines. Frames are 7.5 ms and the FreeRTOS tick is 1 ms at best, so nothing
+on the audio path should be timed in ticks. Everything here is in microseconds from
+esp_timer_get_time (64 bit, monotonic, 1 us resolution, same clock as the frame timestamps).
+
+Important Details:
+
+1. Deadlines:
+   - `bt_app_time_deadline_t` is a periodic deadline anchored at its start, advanced by whole
+     periods, so it does not drift however late the task wakes. `bt_app_time_deadline_expired`
+     says how many periods are due and how late the first one was handled.
+
+2. Wakeups:
+   - A task waiting for a deadline blocks on its task notification, which an esp_timer callback
+     gives. The tick rate only matters for the waits that remain in ticks.
+
+3. Ticks:
+   - `bt_app_time_ms_to_ticks` rounds up and adds the partly elapsed current tick, so a wait in ticks
+     lasts at least the time asked for; `10 / portTICK_PERIOD_MS` is 1 tick at 100 Hz, which may
+     be over right away.
+*/
+
+#ifndef __BT_APP_TIME_H__
+#define __BT_APP_TIME_H__
+
+#include <stdint.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    int64_t next_us;                /*!< next deadline */
+    uint32_t period_us;
+} bt_app_time_deadline_t;
+
+/**
+ * @brief     microseconds since boot, the clock of every audio deadline and timestamp
+ */
+static inline int64_t bt_app_time_us(void)
+{
+    return esp_timer_get_time();
+}
+
+/**
+ * @brief     start a periodic deadline, the first one is a period from now
+ */
+static inline void bt_app_time_deadline_start(bt_app_time_deadline_t *d, uint32_t period_us)
+{
+    d->period_us = period_us;
+    d->next_us = bt_app_time_us() + period_us;
+}
+
+/**
+ * @brief     periods due at now_us; the deadline moves past them
+ *
+ * @param     late_us: how far past the first due deadline now_us is, may be NULL
+ *
+ * @return    number of periods due, 0 if the deadline has not come yet
+ */
+static inline uint32_t bt_app_time_deadline_expired(bt_app_time_deadline_t *d, int64_t now_us, int64_t *late_us)
+{
+    if (now_us < d->next_us) {
+        return 0;
+    }
+    uint32_t due = (uint32_t)((now_us - d->next_us) / d->period_us) + 1;
+    if (late_us) {
+        *late_us = now_us - d->next_us;
+    }
+    d->next_us += (int64_t)due * d->period_us;
+    return due;
+}
+
+/**
+ * @brief     microseconds to the next deadline, 0 if it has passed
+ */
+static inline int64_t bt_app_time_deadline_remaining_us(const bt_app_time_deadline_t *d, int64_t now_us)
+{
+    return (d->next_us > now_us) ? d->next_us - now_us : 0;
+}
+
+/**
+ * @brief     ticks for a wait of at least ms milliseconds at any CONFIG_FREERTOS_HZ
+ */
+static inline TickType_t bt_app_time_ms_to_ticks(uint32_t ms)
+{
+    return (TickType_t)(((uint64_t)ms * configTICK_RATE_HZ + 999) / 1000) + 1;
+}
+
+#endif /* __BT_APP_TIME_H__ */
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+bt_app_trace.c
+
+Overall Responsibility:
+A flight recorder for the HFP state machine and the audio pipeline. Timestamped begin/end, instant
+and counter records go into a fixed ring that can be dumped from the console and turned into a
+Chrome trace (chrome://tracing, ui.perfetto.dev) with tools/trace_to_chrome.py.
+
+Important Details:
+
+1. Trace points:
+   - Dispatcher enqueue (instant) and handling (begin/end), every `bt_app_hf_cb` event, the incoming
+     and outgoing SCO data callbacks, ring buffer fill level and failures, and every console command
+     (through the HF_CMD_HANDLER macro in `app_hf_msg_set.c`).
+
+2. Cost:
+   - A record is claimed with one relaxed atomic increment of the write index and filled in place,
+     16 bytes, no lock and no formatting, so tracing stays on in normal builds. BT_APP_TRACE_ENABLE
+     compiles every trace point out.
+   - Each record carries the handle of the task that wrote it (0 from an ISR), so the host tool
+     gives every task its own track and begin/end pairs nest the way they ran.
+   - A writer also counts itself in `s_trace_writers` for as long as it is inside
+     `bt_app_trace_record`. The count goes up before the enable flag is read (both seq_cst), so once
+     the flag is off and the count seen at zero no writer can still touch the ring.
+   - The index is claimed before the time is read, so records from different tasks or cores can be
+     a few microseconds out of order; the host tool allows for that.
+   - The ring keeps the last BT_APP_TRACE_LEN records and overwrites the oldest.
+
+3. Dump:
+   - `bt_app_trace_dump` pauses recording, waits until the writers already inside
+     `bt_app_trace_record` are done (however long they were preempted), prints the name of every
+     running task against its handle, then the records oldest first, and resumes. Records of a
+     task deleted since show under its handle. `bt_app_trace_clear` waits the same way before it
+     resets the index. The 32-bit microsecond timestamps wrap after ~71 minutes, the host tool
+     unwraps them.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "bt_app_mem.h"
+#include "bt_app_trace.h"
+
+#define TRACE_MASK                (BT_APP_TRACE_LEN - 1)
+#define TRACE_CORE_BIT            (0x80)
+
+static bt_app_trace_rec_t s_trace[BT_APP_TRACE_LEN];
+static atomic_uint_least32_t s_trace_idx;
+static atomic_bool s_trace_on = true;
+static atomic_uint s_trace_writers;         /* inside bt_app_trace_record */
+
+void bt_app_trace_record(bt_app_trace_cat_t cat, bt_app_trace_ph_t ph, uint16_t id, uint32_t arg)
+{
+    atomic_fetch_add(&s_trace_writers, 1);
+    if (!atomic_load(&s_trace_on)) {
+        atomic_fetch_sub_explicit(&s_trace_writers, 1, memory_order_release);
+        return;
+    }
+    uint32_t idx = atomic_fetch_add_explicit(&s_trace_idx, 1, memory_order_relaxed);
+    bt_app_trace_rec_t *rec = &s_trace[idx & TRACE_MASK];
+    rec->ts_us = (uint32_t)esp_timer_get_time();
+    rec->task = xPortInIsrContext() ? 0 : (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    rec->cat = cat | (xPortGetCoreID() ? TRACE_CORE_BIT : 0);
+    rec->ph = ph;
+    rec->id = id;
+    rec->arg = arg;
+    atomic_fetch_sub_explicit(&s_trace_writers, 1, memory_order_release);
+}
+
+/* recording off and every writer out of the ring; returns whether it was on */
+static bool bt_app_trace_pause(void)
+{
+    bool was_on = atomic_exchange(&s_trace_on, false);
+    while (atomic_load(&s_trace_writers) != 0) {
+        vTaskDelay(1);
+    }
+    return was_on;
+}
+
+void bt_app_trace_enable(bool enable)
+{
+    atomic_store_explicit(&s_trace_on, enable, memory_order_relaxed);
+}
+
+void bt_app_trace_clear(void)
+{
+    bool was_on = bt_app_trace_pause();
+    atomic_store(&s_trace_idx, 0);
+    atomic_store(&s_trace_on, was_on);
+}
+
+static void bt_app_trace_dump_tasks(void)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    // a few spare entries for tasks created meanwhile
+    UBaseType_t num = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *st = bt_app_mem_alloc(BT_APP_MEM_CONSOLE, num * sizeof(TaskStatus_t));
+    if (!st) {
+        return;
+    }
+    num = uxTaskGetSystemState(st, num, NULL);
+    for (UBaseType_t i = 0; i < num; i++) {
+        printf("TRACE_TASK:%08x %s\n", (unsigned int)(uintptr_t)st[i].xHandle, st[i].pcTaskName);
+    }
+    bt_app_mem_free(BT_APP_MEM_CONSOLE, st);
+#endif
+}
+
+void bt_app_trace_dump(void)
+{
+    bool was_on = bt_app_trace_pause();
+
+    uint32_t end = atomic_load(&s_trace_idx);
+    uint32_t count = (end > BT_APP_TRACE_LEN) ? BT_APP_TRACE_LEN : end;
+    printf("TRACE_BEGIN %u\n", (unsigned int)count);
+    bt_app_trace_dump_tasks();
+    for (uint32_t i = end - count; i != end; i++) {
+        const bt_app_trace_rec_t *rec = &s_trace[i & TRACE_MASK];
+        printf("TRACE:%08x%02x%02x%04x%08x%08x\n", (unsigned int)rec->ts_us, rec->cat, rec->ph, rec->id,
+               (unsigned int)rec->arg, (unsigned int)rec->task);
+    }
+    printf("TRACE_END\n");
+
+    atomic_store(&s_trace_on, was_on);
+}
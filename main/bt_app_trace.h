@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#ifndef __BT_APP_TRACE_H__
+#define __BT_APP_TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BT_APP_TRACE_TAG            "BT_APP_TRACE"
+
+/* set to 0 to compile every trace point out */
+#define BT_APP_TRACE_ENABLE         (1)
+
+/* records kept, power of two; the oldest are overwritten */
+#define BT_APP_TRACE_LEN            (512)
+
+/* what a record is about, tools/trace_to_chrome.py knows the same list */
+typedef enum {
+    BT_APP_TRACE_CAT_DISPATCH = 0,  /* id: dispatcher event */
+    BT_APP_TRACE_CAT_HF_EVT,        /* id: esp_hf_cb_event_t */
+    BT_APP_TRACE_CAT_SCO_IN,        /* arg: bytes */
+    BT_APP_TRACE_CAT_SCO_OUT,       /* arg: bytes */
+    BT_APP_TRACE_CAT_RB,            /* id: BT_APP_TRACE_RB_*, arg: fill bytes */
+    BT_APP_TRACE_CAT_CMD,           /* id: command opcode */
+    BT_APP_TRACE_CAT_NUM,
+} bt_app_trace_cat_t;
+
+/* Chrome trace phases */
+typedef enum {
+    BT_APP_TRACE_PH_BEGIN = 'B',
+    BT_APP_TRACE_PH_END = 'E',
+    BT_APP_TRACE_PH_INSTANT = 'i',
+    BT_APP_TRACE_PH_COUNTER = 'C',
+} bt_app_trace_ph_t;
+
+enum {
+    BT_APP_TRACE_RB_FILL = 0,
+    BT_APP_TRACE_RB_SEND_FAIL,
+    BT_APP_TRACE_RB_UNDERRUN,
+};
+
+typedef struct {
+    uint32_t ts_us;
+    uint32_t task;                  /* TaskHandle_t of the writer, 0 in an ISR */
+    uint8_t cat;                    /* bt_app_trace_cat_t, bit 7: core */
+    uint8_t ph;                     /* bt_app_trace_ph_t */
+    uint16_t id;
+    uint32_t arg;
+} bt_app_trace_rec_t;
+
+#if BT_APP_TRACE_ENABLE
+#define BT_APP_TRACE_BEGIN(cat, id, arg)    bt_app_trace_record(BT_APP_TRACE_CAT_##cat, BT_APP_TRACE_PH_BEGIN, id, arg)
+#define BT_APP_TRACE_END(cat, id, arg)      bt_app_trace_record(BT_APP_TRACE_CAT_##cat, BT_APP_TRACE_PH_END, id, arg)
+#define BT_APP_TRACE_INSTANT(cat, id, arg)  bt_app_trace_record(BT_APP_TRACE_CAT_##cat, BT_APP_TRACE_PH_INSTANT, id, arg)
+#define BT_APP_TRACE_COUNTER(cat, id, arg)  bt_app_trace_record(BT_APP_TRACE_CAT_##cat, BT_APP_TRACE_PH_COUNTER, id, arg)
+#else
+#define BT_APP_TRACE_BEGIN(cat, id, arg)
+#define BT_APP_TRACE_END(cat, id, arg)
+#define BT_APP_TRACE_INSTANT(cat, id, arg)
+#define BT_APP_TRACE_COUNTER(cat, id, arg)
+#endif
+
+/**
+ * @brief     append one record: an atomic index increment and a 16-byte store, no lock
+ */
+void bt_app_trace_record(bt_app_trace_cat_t cat, bt_app_trace_ph_t ph, uint16_t id, uint32_t arg);
+
+/**
+ * @brief     start or stop recording, recording is on at boot
+ */
+void bt_app_trace_enable(bool enable);
+
+void bt_app_trace_clear(void);
+
+/**
+ * @brief     print the running tasks as "TRACE_TASK:<handle> <name>" lines, then the recorded
+ *            records, oldest first, as "TRACE:<hex>" lines for tools/trace_to_chrome.py.
+ *            Recording is paused while dumping.
+ */
+void bt_app_trace_dump(void);
+
+#endif /* __BT_APP_TRACE_H__ */
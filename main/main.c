@@ -70,8 +70,15 @@ especially related to the Hands-Free Profile (HFP).
 #include "esp_gap_bt_api.h"
 #include "esp_hf_ag_api.h"
 #include "bt_app_hf.h"
+#include "bt_app_gain.h"
+#include "bt_app_ind.h"
+#include "bt_app_link.h"
+#include "bt_app_dlog.h"
+#include "bt_app_mem.h"
+#include "bt_app_tasks.h"
 #include "esp_console.h"
 #include "app_hf_msg_set.h"
+#include "app_hf_msg_scr.h"
 #include "gpio_pcm_config.h"
 
 
@@ -96,9 +103,22 @@ static void bt_hf_hdl_stack_evt(uint16_t event, void *p_param)
 
             esp_hf_ag_register_callback(bt_app_hf_cb);
 
+            /* unity gain on both audio paths until the HF reports its volume */
+            bt_app_gain_init();
+
+            /* indicator rate limit and link poll timers, so no call creates them */
+            bt_app_ind_init();
+            bt_app_link_init();
+
+            /* audio task, ring and timer for every call from now on */
+            bt_app_hf_audio_init();
+
             // init and register for HFP_AG functions
             esp_hf_ag_init();
 
+            /* a boot script may issue commands from here on */
+            hf_scr_post(HF_SCR_EVT_READY);
+
             /*
             * Set default parameters for Legacy Pairing
             * Use variable pin, input pin code when pairing
@@ -252,13 +272,25 @@ void app_main(void){
         return;
     }
 
+    /* start draining deferred logs before any task can produce them */
+    bt_app_dlog_init();
+
+    /* stack and heap sampling for the `mem` command */
+    bt_app_mem_init();
+
     /* create application task */
     bt_app_task_start_up();
 
+    /* script event levels, and the boot script once the stack is up */
+    hf_scr_init();
+
     /* Setup bluetooth device name, connection mode and profile */
     bt_app_work_dispatch(bt_hf_hdl_stack_evt, BT_APP_EVT_STACK_UP, NULL, 0, NULL);
 
     configure_gpio_pins();
 
     start_repl_console();
+
+    /* every task started so far, ours and the stack's, on the core the plan gives it */
+    bt_app_tasks_check();
 }
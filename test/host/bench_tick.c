@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * Model of the audio generator wakeup on the host scheduler, with threads for the tasks: how late
+ * a 7.5 ms block is generated after its boundary with
+ *   - the old 4 ms esp_timer poll through a semaphore, blocks counted from elapsed time,
+ *   - a 7.5 ms esp_timer notifying the task on the block deadline (bt_app_hf.c now),
+ *   - a wait on a 10 ms tick (CONFIG_FREERTOS_HZ 100).
+ * Numbers depend on the machine; it is built but not run by ctest. Usage: bench_tick [blocks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+#define BLOCK_US                    (7500)
+#define TICK_US                     (10000)
+
+typedef enum {
+    MODE_POLL,
+    MODE_NOTIFY,
+    MODE_TICK,
+    MODE_NUM,
+} bench_mode_t;
+
+static const char *const s_mode_str[MODE_NUM] = {
+    "4 ms esp_timer poll + semaphore",
+    "7.5 ms esp_timer + notify",
+    "10 ms tick (HZ=100) wait",
+};
+
+static sem_t s_sem;
+static int64_t s_t0;
+static int64_t s_period;
+static volatile int s_stop;
+
+static int64_t now_us(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000LL + t.tv_nsec / 1000;
+}
+
+static void sleep_until(int64_t us)
+{
+    struct timespec t = {us / 1000000, (us % 1000000) * 1000};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+}
+
+static void *timer_thread(void *arg)
+{
+    for (int64_t next = s_t0 + s_period; !s_stop; next += s_period) {
+        sleep_until(next);
+        sem_post(&s_sem);
+    }
+    return NULL;
+}
+
+static void run(bench_mode_t mode, int blocks_total)
+{
+    pthread_t th;
+    int64_t worst = 0;
+    int64_t sum = 0;
+    int blocks = 0;
+
+    sem_init(&s_sem, 0, 0);
+    s_stop = 0;
+    s_t0 = now_us();
+    s_period = (mode == MODE_POLL) ? 4000 : BLOCK_US;
+    if (mode != MODE_TICK) {
+        pthread_create(&th, NULL, timer_thread, NULL);
+    }
+    int64_t gen = s_t0;
+    while (blocks < blocks_total) {
+        if (mode == MODE_TICK) {
+            sleep_until((now_us() / TICK_US + 1) * TICK_US);
+        } else {
+            sem_wait(&s_sem);
+        }
+        int64_t t = now_us();
+        int64_t due = (t - gen) / BLOCK_US;
+        if (due == 0) {
+            continue;
+        }
+        int64_t late = t - (gen + BLOCK_US);
+        gen += due * BLOCK_US;
+        blocks += due;
+        sum += late;
+        if (late > worst) {
+            worst = late;
+        }
+    }
+    s_stop = 1;
+    if (mode != MODE_TICK) {
+        sem_post(&s_sem);
+        pthread_join(th, NULL);
+    }
+    sem_destroy(&s_sem);
+    printf("%-34s worst %5lld us  mean %5lld us  (%d blocks)\n", s_mode_str[mode], (long long)worst,
+           (long long)(sum / blocks), blocks);
+}
+
+int main(int argc, char **argv)
+{
+    int blocks = (argc > 1) ? atoi(argv[1]) : 400;
+    for (int m = 0; m < MODE_NUM; m++) {
+        run(m, blocks);
+    }
+    return 0;
+}
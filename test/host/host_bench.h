@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * Timing for the cost figures some tests print. They depend on the machine, so the tests print
+ * them and assert only on behaviour; the figures are for the optimized build (the default here).
+ */
+
+#ifndef __HOST_BENCH_H__
+#define __HOST_BENCH_H__
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* keeps the compiler from dropping the work being timed */
+static volatile uint64_t host_bench_sink;
+
+static inline uint64_t host_bench_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+/* CPU cycles where the host has a cycle counter, 0 elsewhere */
+static inline uint64_t host_bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+typedef struct {
+    uint64_t ns;
+    uint64_t cycles;
+} host_bench_t;
+
+static inline void host_bench_start(host_bench_t *b)
+{
+    b->ns = host_bench_ns();
+    b->cycles = host_bench_cycles();
+}
+
+/* per iteration over n iterations since host_bench_start */
+static inline void host_bench_stop(host_bench_t *b, uint64_t n, double *ns_per, double *cycles_per)
+{
+    *ns_per = (double)(host_bench_ns() - b->ns) / (double)n;
+    *cycles_per = (double)(host_bench_cycles() - b->cycles) / (double)n;
+}
+
+#endif /* __HOST_BENCH_H__ */
@@ -0,0 +1,941 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+host_stubs.c
+
+Overall Responsibility:
+Host side of the ESP-IDF and FreeRTOS calls made by main/, so single modules can be built and run
+on the development machine (see CMakeLists.txt next to this file).
+
+Important Details:
+
+1. Overriding:
+   - Every definition here is weak. A test that needs to see the arguments of a call, or to make it
+     fail, defines the function itself and the linker takes that one.
+
+2. Time:
+   - esp_timer_get_time() only moves with host_advance_us() and vTaskDelay(). Advancing runs every
+     timer that came due, in time order, with the clock set to its expiry.
+
+3. Tasks:
+   - Creating a task records it. host_task_run() calls the task function on the test thread as the
+     current task and returns when the function returns, deletes itself, or would block for good (a
+     ulTaskNotifyTake() with nothing pending, or an xQueueReceive() from an empty queue, with
+     portMAX_DELAY). Once the table is full, a deleted task's slot is reused.
+
+4. Heap:
+   - host_heap_allocs counts the kernel objects that come from the heap on the target: dynamic tasks,
+     queues, event groups, ring buffers and esp_timers. The static variants do not count.
+
+5. Everything else:
+   - Queues, event groups and byte ring buffers keep real state and otherwise never block; nvs is one
+     in-memory namespace of strings; the HFP AG calls only count; the UART writes to stdout and never
+     has input.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_hf_ag_api.h"
+#include "esp_console.h"
+#include "driver/uart.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include "freertos/ringbuf.h"
+#include "bt_app_dlog.h"
+
+#define HOST_WEAK                   __attribute__((weak))
+
+#define HOST_TIMERS_MAX             (16)
+#define HOST_NVS_MAX                (32)
+#define HOST_NVS_VALUE_MAX          (512)
+
+/*******************************
+ * esp_err, deferred log
+ ******************************/
+
+HOST_WEAK const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    default:
+        return "ESP_FAIL";
+    }
+}
+
+HOST_WEAK void bt_app_dlog_write(bt_app_dlog_id_t id, uint32_t nargs, const uintptr_t *args)
+{
+}
+
+HOST_WEAK void bt_app_dlog_release(TaskHandle_t task)
+{
+}
+
+/*******************************
+ * esp_timer
+ ******************************/
+
+struct esp_timer {
+    esp_timer_cb_t cb;
+    void *arg;
+    bool used;
+    bool active;
+    int64_t due_us;
+    uint64_t period_us;
+};
+
+static struct esp_timer s_timers[HOST_TIMERS_MAX];
+static int64_t s_now_us;
+
+HOST_WEAK int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+HOST_WEAK esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+        if (!s_timers[i].used) {
+            s_timers[i] = (struct esp_timer) {
+                .cb = create_args->callback,
+                .arg = create_args->arg,
+                .used = true,
+            };
+            *out_handle = &s_timers[i];
+            host_heap_allocs++;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+HOST_WEAK esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->due_us = s_now_us + timeout_us;
+    timer->period_us = 0;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->due_us = s_now_us + period;
+    timer->period_us = period;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->used = false;
+    return ESP_OK;
+}
+
+HOST_WEAK bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->active;
+}
+
+void host_set_time_us(int64_t now_us)
+{
+    s_now_us = now_us;
+}
+
+void host_advance_us(int64_t us)
+{
+    int64_t end = s_now_us + us;
+
+    for (;;) {
+        struct esp_timer *next = NULL;
+        for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+            struct esp_timer *t = &s_timers[i];
+            if (t->used && t->active && t->due_us <= end && (!next || t->due_us < next->due_us)) {
+                next = t;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        s_now_us = next->due_us;
+        if (next->period_us) {
+            next->due_us += next->period_us;
+        } else {
+            next->active = false;
+        }
+        next->cb(next->arg);
+    }
+    s_now_us = end;
+}
+
+/*******************************
+ * heap
+ ******************************/
+
+int host_heap_allocs;
+size_t host_heap_free = 200 * 1024;
+size_t host_heap_min_free = 180 * 1024;
+size_t host_heap_largest = 100 * 1024;
+
+HOST_WEAK size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return host_heap_free;
+}
+
+HOST_WEAK size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return host_heap_min_free;
+}
+
+HOST_WEAK size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return host_heap_largest;
+}
+
+/*******************************
+ * FreeRTOS port and tasks
+ ******************************/
+
+BaseType_t host_core_id;
+struct host_task host_tasks[HOST_TASKS_MAX];
+int host_task_num;
+TaskHandle_t host_current_task;
+
+static jmp_buf *s_task_exit;
+
+HOST_WEAK BaseType_t xPortGetCoreID(void)
+{
+    return host_core_id;
+}
+
+HOST_WEAK BaseType_t xPortInIsrContext(void)
+{
+    return pdFALSE;
+}
+
+void host_tasks_reset(void)
+{
+    memset(host_tasks, 0, sizeof(host_tasks));
+    host_task_num = 0;
+    host_current_task = NULL;
+}
+
+TaskHandle_t host_task_find(const char *name)
+{
+    for (int i = host_task_num - 1; i >= 0; i--) {
+        if (!host_tasks[i].deleted && strncmp(host_tasks[i].name, name, configMAX_TASK_NAME_LEN - 1) == 0) {
+            return &host_tasks[i];
+        }
+    }
+    return NULL;
+}
+
+void host_task_run(TaskHandle_t task)
+{
+    jmp_buf exit;
+    jmp_buf *prev_exit = s_task_exit;
+    TaskHandle_t prev_task = host_current_task;
+
+    s_task_exit = &exit;
+    host_current_task = task;
+    if (!setjmp(exit)) {
+        task->fn(task->arg);
+    }
+    s_task_exit = prev_exit;
+    host_current_task = prev_task;
+}
+
+/* leave the running task function, as if it blocked forever */
+static void host_task_leave(void)
+{
+    if (s_task_exit) {
+        longjmp(*s_task_exit, 1);
+    }
+}
+
+static TaskHandle_t host_task_add(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                  UBaseType_t prio, BaseType_t core, bool is_static)
+{
+    struct host_task *t = NULL;
+    if (host_task_num < HOST_TASKS_MAX) {
+        t = &host_tasks[host_task_num++];
+    } else {
+        // full: the oldest deleted task makes room
+        for (int i = 0; i < HOST_TASKS_MAX && !t; i++) {
+            t = host_tasks[i].deleted ? &host_tasks[i] : NULL;
+        }
+        if (!t) {
+            return NULL;
+        }
+    }
+    *t = (struct host_task) {
+        .fn = fn,
+        .arg = arg,
+        .stack = stack,
+        .prio = prio,
+        .core = core,
+        .is_static = is_static,
+        .stack_free = stack / 2,
+    };
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    return t;
+}
+
+HOST_WEAK BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                             UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+    TaskHandle_t t = host_task_add(fn, name, stack, arg, prio, core, false);
+    if (t) {
+        host_heap_allocs++;
+    }
+    if (handle) {
+        *handle = t;
+    }
+    return t ? pdPASS : errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+}
+
+HOST_WEAK TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                                     UBaseType_t prio, StackType_t *stack_buf, StaticTask_t *tcb, BaseType_t core)
+{
+    return host_task_add(fn, name, stack, arg, prio, core, true);
+}
+
+HOST_WEAK void vTaskDelete(TaskHandle_t task)
+{
+    TaskHandle_t t = task ? task : host_current_task;
+    if (t) {
+        t->deleted = true;
+    }
+    if (!task || task == host_current_task) {
+        host_task_leave();
+    }
+}
+
+HOST_WEAK void vTaskDelay(TickType_t ticks)
+{
+    host_advance_us((int64_t)ticks * 1000 * portTICK_PERIOD_MS);
+}
+
+HOST_WEAK TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_current_task;
+}
+
+HOST_WEAK UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    UBaseType_t num = 0;
+    for (int i = 0; i < host_task_num; i++) {
+        num += !host_tasks[i].deleted;
+    }
+    return num;
+}
+
+HOST_WEAK UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t num, configRUN_TIME_COUNTER_TYPE *total_run_time)
+{
+    UBaseType_t n = 0;
+    configRUN_TIME_COUNTER_TYPE total = 0;
+
+    if (num < uxTaskGetNumberOfTasks()) {
+        return 0;
+    }
+    for (int i = 0; i < host_task_num; i++) {
+        struct host_task *t = &host_tasks[i];
+        if (t->deleted) {
+            continue;
+        }
+        status[n++] = (TaskStatus_t) {
+            .xHandle = t,
+            .pcTaskName = t->name,
+            .xTaskNumber = i,
+            .eCurrentState = eBlocked,
+            .uxCurrentPriority = t->prio,
+            .uxBasePriority = t->prio,
+            .ulRunTimeCounter = t->run_time,
+            .usStackHighWaterMark = t->stack_free,
+            .xCoreID = t->core,
+        };
+        total += t->run_time;
+    }
+    if (total_run_time) {
+        *total_run_time = total;
+    }
+    return n;
+}
+
+HOST_WEAK BaseType_t xTaskGetCoreID(TaskHandle_t task)
+{
+    return task->core;
+}
+
+HOST_WEAK uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *t = host_current_task;
+    if (!t || !t->notify) {
+        if (ticks == portMAX_DELAY) {
+            host_task_leave();
+        }
+        return 0;
+    }
+    uint32_t n = t->notify;
+    t->notify = clear_on_exit ? 0 : n - 1;
+    return n;
+}
+
+HOST_WEAK BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    task->notify++;
+    return pdPASS;
+}
+
+/*******************************
+ * queues, event groups
+ ******************************/
+
+struct host_queue {
+    uint8_t *items;
+    UBaseType_t len;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    bool is_static;
+};
+
+static QueueHandle_t host_queue_init(struct host_queue *q, UBaseType_t len, UBaseType_t item_size, uint8_t *storage)
+{
+    q->items = storage;
+    q->len = len;
+    q->item_size = item_size;
+    q->head = 0;
+    q->count = 0;
+    return q;
+}
+
+HOST_WEAK QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    uint8_t *storage = malloc(len * item_size);
+    if (!q || !storage) {
+        free(q);
+        free(storage);
+        return NULL;
+    }
+    host_heap_allocs++;
+    return host_queue_init(q, len, item_size, storage);
+}
+
+HOST_WEAK QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buf)
+{
+    _Static_assert(sizeof(StaticQueue_t) >= sizeof(struct host_queue), "StaticQueue_t holds a host queue");
+    struct host_queue *q = (struct host_queue *)buf;
+    q->is_static = true;
+    return host_queue_init(q, len, item_size, storage);
+}
+
+HOST_WEAK void vQueueDelete(QueueHandle_t queue)
+{
+    if (!queue->is_static) {
+        free(queue->items);
+        free(queue);
+    }
+}
+
+HOST_WEAK BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    if (queue->count == queue->len) {
+        return errQUEUE_FULL;
+    }
+    memcpy(queue->items + ((queue->head + queue->count) % queue->len) * queue->item_size, item, queue->item_size);
+    queue->count++;
+    return pdPASS;
+}
+
+HOST_WEAK BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    if (queue->count == 0) {
+        if (ticks == portMAX_DELAY) {
+            host_task_leave();
+        }
+        return pdFALSE;
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->len;
+    queue->count--;
+    return pdTRUE;
+}
+
+HOST_WEAK UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
+
+struct host_event_group {
+    EventBits_t bits;
+};
+
+HOST_WEAK EventGroupHandle_t xEventGroupCreate(void)
+{
+    host_heap_allocs++;
+    return calloc(1, sizeof(struct host_event_group));
+}
+
+HOST_WEAK EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    group->bits |= bits;
+    return group->bits;
+}
+
+HOST_WEAK EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t prev = group->bits;
+    group->bits &= ~bits;
+    return prev;
+}
+
+HOST_WEAK EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    return group->bits;
+}
+
+HOST_WEAK EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                          BaseType_t wait_all, TickType_t ticks)
+{
+    EventBits_t prev = group->bits;
+    bool met = wait_all ? (prev & bits) == bits : (prev & bits) != 0;
+    if (met && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return prev;
+}
+
+/*******************************
+ * ring buffers
+ ******************************/
+
+struct host_ringbuf {
+    uint8_t *storage;
+    size_t size;
+    size_t head;
+    size_t count;
+    size_t held;                            /* handed out by a receive, not yet returned */
+    bool is_static;
+};
+
+static RingbufHandle_t host_ringbuf_init(struct host_ringbuf *rb, size_t size, uint8_t *storage)
+{
+    rb->storage = storage;
+    rb->size = size;
+    rb->head = 0;
+    rb->count = 0;
+    rb->held = 0;
+    return rb;
+}
+
+HOST_WEAK RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type)
+{
+    struct host_ringbuf *rb = calloc(1, sizeof(*rb));
+    uint8_t *storage = malloc(size);
+    if (!rb || !storage) {
+        free(rb);
+        free(storage);
+        return NULL;
+    }
+    host_heap_allocs++;
+    return host_ringbuf_init(rb, size, storage);
+}
+
+HOST_WEAK RingbufHandle_t xRingbufferCreateStatic(size_t size, RingbufferType_t type, uint8_t *storage, StaticRingbuffer_t *buf)
+{
+    _Static_assert(sizeof(StaticRingbuffer_t) >= sizeof(struct host_ringbuf), "StaticRingbuffer_t holds a host ring buffer");
+    struct host_ringbuf *rb = (struct host_ringbuf *)buf;
+    rb->is_static = true;
+    return host_ringbuf_init(rb, size, storage);
+}
+
+HOST_WEAK void vRingbufferDelete(RingbufHandle_t rb)
+{
+    if (!rb->is_static) {
+        free(rb->storage);
+        free(rb);
+    }
+}
+
+HOST_WEAK BaseType_t xRingbufferSend(RingbufHandle_t rb, const void *data, size_t size, TickType_t ticks)
+{
+    if (rb->size - rb->count < size) {
+        return pdFALSE;
+    }
+    size_t tail = (rb->head + rb->count) % rb->size;
+    size_t first = size < rb->size - tail ? size : rb->size - tail;
+    memcpy(rb->storage + tail, data, first);
+    memcpy(rb->storage, (const uint8_t *)data + first, size - first);
+    rb->count += size;
+    return pdTRUE;
+}
+
+HOST_WEAK void *xRingbufferReceiveUpTo(RingbufHandle_t rb, size_t *size, TickType_t ticks, size_t max_size)
+{
+    size_t n = rb->size - rb->head;
+    n = n < rb->count ? n : rb->count;
+    n = n < max_size ? n : max_size;
+    if (n == 0 || rb->held) {
+        return NULL;
+    }
+    rb->held = n;
+    *size = n;
+    return rb->storage + rb->head;
+}
+
+HOST_WEAK void *xRingbufferReceive(RingbufHandle_t rb, size_t *size, TickType_t ticks)
+{
+    return xRingbufferReceiveUpTo(rb, size, ticks, rb->size);
+}
+
+HOST_WEAK void vRingbufferReturnItem(RingbufHandle_t rb, void *item)
+{
+    rb->head = (rb->head + rb->held) % rb->size;
+    rb->count -= rb->held;
+    rb->held = 0;
+}
+
+HOST_WEAK void vRingbufferGetInfo(RingbufHandle_t rb, UBaseType_t *uxFree, UBaseType_t *uxRead, UBaseType_t *uxWrite,
+                                  UBaseType_t *uxAcquire, size_t *uxItemsWaiting)
+{
+    if (uxFree) {
+        *uxFree = rb->size - rb->count;
+    }
+    if (uxItemsWaiting) {
+        *uxItemsWaiting = rb->count;
+    }
+}
+
+/*******************************
+ * nvs
+ ******************************/
+
+typedef struct {
+    bool used;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    char value[HOST_NVS_VALUE_MAX];
+} host_nvs_entry_t;
+
+struct nvs_opaque_iterator_t {
+    int idx;
+};
+
+static host_nvs_entry_t s_nvs[HOST_NVS_MAX];
+static struct nvs_opaque_iterator_t s_nvs_it;
+
+static host_nvs_entry_t *host_nvs_find(const char *key)
+{
+    for (int i = 0; i < HOST_NVS_MAX; i++) {
+        if (s_nvs[i].used && strcmp(s_nvs[i].key, key) == 0) {
+            return &s_nvs[i];
+        }
+    }
+    return NULL;
+}
+
+static int host_nvs_next(int from)
+{
+    while (from < HOST_NVS_MAX && !s_nvs[from].used) {
+        from++;
+    }
+    return from;
+}
+
+HOST_WEAK esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+HOST_WEAK void nvs_close(nvs_handle_t handle)
+{
+}
+
+HOST_WEAK esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    host_nvs_entry_t *e = host_nvs_find(key);
+    if (!e) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    size_t need = strlen(e->value) + 1;
+    if (out_value) {
+        if (*length < need) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        memcpy(out_value, e->value, need);
+    }
+    *length = need;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    host_nvs_entry_t *e = host_nvs_find(key);
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE || strlen(value) >= HOST_NVS_VALUE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; !e && i < HOST_NVS_MAX; i++) {
+        if (!s_nvs[i].used) {
+            e = &s_nvs[i];
+        }
+    }
+    if (!e) {
+        return ESP_ERR_NO_MEM;
+    }
+    e->used = true;
+    strcpy(e->key, key);
+    strcpy(e->value, value);
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    host_nvs_entry_t *e = host_nvs_find(key);
+    if (!e) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    e->used = false;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type, nvs_iterator_t *output_iterator)
+{
+    s_nvs_it.idx = host_nvs_next(0);
+    *output_iterator = s_nvs_it.idx < HOST_NVS_MAX ? &s_nvs_it : NULL;
+    return *output_iterator ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+HOST_WEAK esp_err_t nvs_entry_next(nvs_iterator_t *iterator)
+{
+    (*iterator)->idx = host_nvs_next((*iterator)->idx + 1);
+    if ((*iterator)->idx == HOST_NVS_MAX) {
+        *iterator = NULL;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t *out_info)
+{
+    memset(out_info, 0, sizeof(*out_info));
+    strcpy(out_info->key, s_nvs[iterator->idx].key);
+    out_info->type = NVS_TYPE_STR;
+    return ESP_OK;
+}
+
+HOST_WEAK void nvs_release_iterator(nvs_iterator_t iterator)
+{
+}
+
+/*******************************
+ * HFP AG
+ ******************************/
+
+int host_hf_calls[HOST_HF_CALL_NUM];
+
+HOST_WEAK esp_err_t esp_hf_ag_slc_connect(esp_bd_addr_t remote_bda)
+{
+    host_hf_calls[HOST_HF_SLC_CONNECT]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_slc_disconnect(esp_bd_addr_t remote_bda)
+{
+    host_hf_calls[HOST_HF_SLC_DISCONNECT]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_volume_control(esp_bd_addr_t remote_bda, esp_hf_volume_control_target_t type, int volume)
+{
+    host_hf_calls[HOST_HF_VOLUME_CONTROL]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_cmee_send(esp_bd_addr_t remote_bda, esp_hf_at_response_code_t response_code, esp_hf_cme_err_t error_code)
+{
+    host_hf_calls[HOST_HF_CMEE_SEND]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_bsir(esp_bd_addr_t remote_bda, bool state)
+{
+    host_hf_calls[HOST_HF_BSIR]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_ciev_report(esp_bd_addr_t remote_addr, esp_hf_ciev_report_type_t ind_type, int value)
+{
+    host_hf_calls[HOST_HF_CIEV_REPORT]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_cind_response(esp_bd_addr_t remote_addr, esp_hf_call_status_t call_state,
+                                            esp_hf_call_setup_status_t call_setup_state, esp_hf_network_state_t ntk_state,
+                                            int signal, esp_hf_roaming_status_t roam, int batt_lev,
+                                            esp_hf_call_held_status_t call_held_status)
+{
+    host_hf_calls[HOST_HF_CIND_RESPONSE]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_clcc_response(esp_bd_addr_t remote_addr, int index, esp_hf_current_call_direction_t dir,
+                                            esp_hf_current_call_status_t current_call_state, esp_hf_current_call_mode_t mode,
+                                            esp_hf_current_call_mpty_type_t mpty, char *number, esp_hf_call_addr_type_t type)
+{
+    host_hf_calls[HOST_HF_CLCC_RESPONSE]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_answer_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                                          esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type)
+{
+    host_hf_calls[HOST_HF_ANSWER_CALL]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_reject_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                                          esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type)
+{
+    host_hf_calls[HOST_HF_REJECT_CALL]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_out_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                                       esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type)
+{
+    host_hf_calls[HOST_HF_OUT_CALL]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_end_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                                       esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type)
+{
+    host_hf_calls[HOST_HF_END_CALL]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_audio_connect(esp_bd_addr_t remote_bda)
+{
+    host_hf_calls[HOST_HF_AUDIO_CONNECT]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_audio_disconnect(esp_bd_addr_t remote_bda)
+{
+    host_hf_calls[HOST_HF_AUDIO_DISCONNECT]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_vra_control(esp_bd_addr_t remote_bda, esp_hf_vr_state_t value)
+{
+    host_hf_calls[HOST_HF_VRA_CONTROL]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_pkt_stat_nums_get(uint16_t sync_conn_handle)
+{
+    host_hf_calls[HOST_HF_PKT_STAT_NUMS_GET]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_unknown_at_send(esp_bd_addr_t remote_addr, char *unat)
+{
+    host_hf_calls[HOST_HF_UNKNOWN_AT_SEND]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_cops_response(esp_bd_addr_t remote_addr, char *name)
+{
+    host_hf_calls[HOST_HF_COPS_RESPONSE]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_cnum_response(esp_bd_addr_t remote_addr, char *number, int number_type,
+                                            esp_hf_subscriber_service_type_t service_type)
+{
+    host_hf_calls[HOST_HF_CNUM_RESPONSE]++;
+    return ESP_OK;
+}
+
+HOST_WEAK esp_err_t esp_hf_ag_register_data_callback(esp_hf_incoming_data_cb_t recv, esp_hf_outgoing_data_cb_t send)
+{
+    host_hf_calls[HOST_HF_REGISTER_DATA_CALLBACK]++;
+    return ESP_OK;
+}
+
+HOST_WEAK void esp_hf_ag_outgoing_data_ready(void)
+{
+    host_hf_calls[HOST_HF_OUTGOING_DATA_READY]++;
+}
+
+/*******************************
+ * console
+ ******************************/
+
+int host_console_cmds;
+
+HOST_WEAK esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd)
+{
+    host_console_cmds++;
+    return ESP_OK;
+}
+
+/*******************************
+ * uart
+ ******************************/
+
+HOST_WEAK int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    return fwrite(src, 1, size, stdout);
+}
+
+HOST_WEAK int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    return 0;
+}
@@ -0,0 +1,17 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Writes go to stdout, reads return nothing.
+ */
+#ifndef __HOST_UART_H__
+#define __HOST_UART_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+typedef int uart_port_t;
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+
+#endif /* __HOST_UART_H__ */
@@ -0,0 +1,11 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Included by bt_app_hf.c, which calls nothing from it.
+ */
+#ifndef __HOST_ESP_BT_MAIN_H__
+#define __HOST_ESP_BT_MAIN_H__
+
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#endif /* __HOST_ESP_BT_MAIN_H__ */
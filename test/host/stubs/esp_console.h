@@ -0,0 +1,24 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ */
+#ifndef __HOST_ESP_CONSOLE_H__
+#define __HOST_ESP_CONSOLE_H__
+
+#include "esp_err.h"
+
+typedef int (*esp_console_cmd_func_t)(int argc, char **argv);
+
+typedef struct {
+    const char *command;
+    const char *help;
+    const char *hint;
+    esp_console_cmd_func_t func;
+    void *argtable;
+} esp_console_cmd_t;
+
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd);
+
+/* host only: commands registered so far */
+extern int host_console_cmds;
+
+#endif /* __HOST_ESP_CONSOLE_H__ */
@@ -0,0 +1,24 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ */
+#ifndef __HOST_ESP_ERR_H__
+#define __HOST_ESP_ERR_H__
+
+#include <assert.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                      (0)
+#define ESP_FAIL                    (-1)
+#define ESP_ERR_NO_MEM              (0x101)
+#define ESP_ERR_INVALID_ARG         (0x102)
+#define ESP_ERR_INVALID_STATE       (0x103)
+#define ESP_ERR_NOT_FOUND           (0x105)
+#define ESP_ERR_NVS_NOT_FOUND       (0x1102)
+
+#define ESP_ERROR_CHECK(x)          do { esp_err_t err_rc_ = (x); assert(err_rc_ == ESP_OK); (void)err_rc_; } while (0)
+
+const char *esp_err_to_name(esp_err_t code);
+
+#endif /* __HOST_ESP_ERR_H__ */
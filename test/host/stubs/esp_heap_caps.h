@@ -0,0 +1,23 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ */
+#ifndef __HOST_ESP_HEAP_CAPS_H__
+#define __HOST_ESP_HEAP_CAPS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT             (1 << 2)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+/* host only: what the three calls above return */
+extern size_t host_heap_free;
+extern size_t host_heap_min_free;
+extern size_t host_heap_largest;
+/* host only: kernel objects created on the heap (dynamic tasks, queues, event groups, ring buffers, timers) */
+extern int host_heap_allocs;
+
+#endif /* __HOST_ESP_HEAP_CAPS_H__ */
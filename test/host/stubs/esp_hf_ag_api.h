@@ -0,0 +1,289 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Every call is counted in host_hf_calls; tests that need the arguments define their own.
+ */
+#ifndef __HOST_ESP_HF_AG_API_H__
+#define __HOST_ESP_HF_AG_API_H__
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+typedef enum {
+    ESP_HF_IND_TYPE_CALL = 1,
+    ESP_HF_IND_TYPE_CALLSETUP,
+    ESP_HF_IND_TYPE_SERVICE,
+    ESP_HF_IND_TYPE_SIGNAL,
+    ESP_HF_IND_TYPE_ROAM,
+    ESP_HF_IND_TYPE_BATTCHG,
+    ESP_HF_IND_TYPE_CALLHELD,
+} esp_hf_ciev_report_type_t;
+
+typedef enum {
+    ESP_HF_CALL_STATUS_NO_CALLS = 0,
+    ESP_HF_CALL_STATUS_CALL_IN_PROGRESS,
+} esp_hf_call_status_t;
+
+typedef enum {
+    ESP_HF_CALL_SETUP_STATUS_IDLE = 0,
+    ESP_HF_CALL_SETUP_STATUS_INCOMING,
+    ESP_HF_CALL_SETUP_STATUS_OUTGOING_DIALING,
+    ESP_HF_CALL_SETUP_STATUS_OUTGOING_ALERTING,
+} esp_hf_call_setup_status_t;
+
+typedef enum {
+    ESP_HF_NETWORK_STATE_NOT_AVAILABLE = 0,
+    ESP_HF_NETWORK_STATE_AVAILABLE,
+} esp_hf_network_state_t;
+
+typedef enum {
+    ESP_HF_ROAMING_STATUS_INACTIVE = 0,
+    ESP_HF_ROAMING_STATUS_ACTIVE,
+} esp_hf_roaming_status_t;
+
+typedef enum {
+    ESP_HF_CALL_HELD_STATUS_NONE = 0,
+    ESP_HF_CALL_HELD_STATUS_HELD_AND_ACTIVE,
+    ESP_HF_CALL_HELD_STATUS_HELD,
+} esp_hf_call_held_status_t;
+
+typedef enum {
+    ESP_HF_CURRENT_CALL_DIRECTION_OUTGOING = 0,
+    ESP_HF_CURRENT_CALL_DIRECTION_INCOMING,
+} esp_hf_current_call_direction_t;
+
+typedef enum {
+    ESP_HF_CURRENT_CALL_STATUS_ACTIVE = 0,
+    ESP_HF_CURRENT_CALL_STATUS_HELD,
+    ESP_HF_CURRENT_CALL_STATUS_DIALING,
+    ESP_HF_CURRENT_CALL_STATUS_ALERTING,
+    ESP_HF_CURRENT_CALL_STATUS_INCOMING,
+    ESP_HF_CURRENT_CALL_STATUS_WAITING,
+    ESP_HF_CURRENT_CALL_STATUS_HELD_BY_RESP_HOLD,
+} esp_hf_current_call_status_t;
+
+typedef enum {
+    ESP_HF_CURRENT_CALL_MODE_VOICE = 0,
+    ESP_HF_CURRENT_CALL_MODE_DATA,
+    ESP_HF_CURRENT_CALL_MODE_FAX,
+} esp_hf_current_call_mode_t;
+
+typedef enum {
+    ESP_HF_CURRENT_CALL_MPTY_TYPE_SINGLE = 0,
+    ESP_HF_CURRENT_CALL_MPTY_TYPE_MULTI,
+} esp_hf_current_call_mpty_type_t;
+
+typedef enum {
+    ESP_HF_CALL_ADDR_TYPE_UNKNOWN = 0x81,
+    ESP_HF_CALL_ADDR_TYPE_INTERNATIONAL = 0x91,
+} esp_hf_call_addr_type_t;
+
+typedef enum {
+    ESP_HF_VR_STATE_DISABLED = 0,
+    ESP_HF_VR_STATE_ENABLED,
+} esp_hf_vr_state_t;
+
+typedef enum {
+    ESP_HF_VOLUME_CONTROL_TARGET_SPK = 0,
+    ESP_HF_VOLUME_CONTROL_TARGET_MIC,
+} esp_hf_volume_control_target_t;
+
+typedef enum {
+    ESP_HF_AT_RESPONSE_CODE_OK = 0,
+    ESP_HF_AT_RESPONSE_CODE_ERR,
+    ESP_HF_AT_RESPONSE_CODE_NO_CARRIER,
+    ESP_HF_AT_RESPONSE_CODE_BUSY,
+    ESP_HF_AT_RESPONSE_CODE_NO_ANSWER,
+    ESP_HF_AT_RESPONSE_CODE_DELAYED,
+    ESP_HF_AT_RESPONSE_CODE_BLACKLISTED,
+    ESP_HF_AT_RESPONSE_CODE_CME,
+} esp_hf_at_response_code_t;
+
+typedef enum {
+    ESP_HF_CME_AG_FAILURE = 0,
+    ESP_HF_CME_OPERATION_NOT_ALLOWED = 3,
+    ESP_HF_CME_MEMORY_FAILURE = 23,
+    ESP_HF_CME_NETWORK_NOT_ALLOWED = 32,
+} esp_hf_cme_err_t;
+
+typedef enum {
+    ESP_HF_CONNECTION_STATE_EVT = 0,
+    ESP_HF_AUDIO_STATE_EVT,
+    ESP_HF_BVRA_RESPONSE_EVT,
+    ESP_HF_VOLUME_CONTROL_EVT,
+    ESP_HF_UNAT_RESPONSE_EVT,
+    ESP_HF_IND_UPDATE_EVT,
+    ESP_HF_CIND_RESPONSE_EVT,
+    ESP_HF_COPS_RESPONSE_EVT,
+    ESP_HF_CLCC_RESPONSE_EVT,
+    ESP_HF_CNUM_RESPONSE_EVT,
+    ESP_HF_VTS_RESPONSE_EVT,
+    ESP_HF_NREC_RESPONSE_EVT,
+    ESP_HF_ATA_RESPONSE_EVT,
+    ESP_HF_CHUP_RESPONSE_EVT,
+    ESP_HF_DIAL_EVT,
+    ESP_HF_WBS_RESPONSE_EVT,
+    ESP_HF_BCS_RESPONSE_EVT,
+    ESP_HF_PKT_STAT_NUMS_GET_EVT,
+} esp_hf_cb_event_t;
+
+typedef enum {
+    ESP_HF_CONNECTION_STATE_DISCONNECTED = 0,
+    ESP_HF_CONNECTION_STATE_CONNECTING,
+    ESP_HF_CONNECTION_STATE_CONNECTED,
+    ESP_HF_CONNECTION_STATE_SLC_CONNECTED,
+    ESP_HF_CONNECTION_STATE_DISCONNECTING,
+} esp_hf_connection_state_t;
+
+typedef enum {
+    ESP_HF_AUDIO_STATE_DISCONNECTED = 0,
+    ESP_HF_AUDIO_STATE_CONNECTING,
+    ESP_HF_AUDIO_STATE_CONNECTED,
+    ESP_HF_AUDIO_STATE_CONNECTED_MSBC,
+} esp_hf_audio_state_t;
+
+typedef enum {
+    ESP_HF_NREC_STOP = 0,
+    ESP_HF_NREC_START,
+} esp_hf_nrec_t;
+
+typedef enum {
+    ESP_HF_DIAL_NUM = 0,
+    ESP_HF_DIAL_MEM,
+    ESP_HF_DIAL_VOIP,
+} esp_hf_dial_type_t;
+
+typedef enum {
+    ESP_HF_WBS_NONE = 0,
+    ESP_HF_WBS_NO,
+    ESP_HF_WBS_YES,
+} esp_hf_wbs_config_t;
+
+typedef enum {
+    ESP_HF_SUBSCRIBER_SERVICE_TYPE_UNKNOWN = 0,
+    ESP_HF_SUBSCRIBER_SERVICE_TYPE_VOICE,
+    ESP_HF_SUBSCRIBER_SERVICE_TYPE_FAX,
+} esp_hf_subscriber_service_type_t;
+
+/* the members bt_app_hf.c reads, laid out as in ESP-IDF 5.2 */
+typedef union {
+    struct {
+        esp_bd_addr_t remote_bda;
+        esp_hf_connection_state_t state;
+        uint32_t peer_feat;
+        uint32_t chld_feat;
+    } conn_stat;
+    struct {
+        esp_bd_addr_t remote_addr;
+        esp_hf_audio_state_t state;
+        uint16_t sync_conn_handle;
+        uint16_t preferred_frame_size;
+    } audio_stat;
+    struct {
+        esp_bd_addr_t remote_addr;
+        esp_hf_vr_state_t value;
+    } vra_rep;
+    struct {
+        esp_bd_addr_t remote_addr;
+        esp_hf_volume_control_target_t type;
+        int volume;
+    } volume_control;
+    struct {
+        esp_bd_addr_t remote_addr;
+        char *unat;
+    } unat_rep;
+    struct {
+        esp_bd_addr_t remote_addr;
+    } ind_upd, cind_rep, cops_rep, clcc_rep, ata_rep, chup_rep;
+    struct {
+        esp_bd_addr_t remote_addr;
+        char *code;
+    } vts_rep;
+    struct {
+        esp_bd_addr_t remote_addr;
+        esp_hf_nrec_t state;
+    } nrec;
+    struct {
+        esp_bd_addr_t remote_addr;
+        esp_hf_dial_type_t type;
+        char *num_or_loc;
+    } out_call;
+    struct {
+        esp_bd_addr_t remote_addr;
+        esp_hf_wbs_config_t mode;
+    } bcs_rep;
+    struct {
+        uint32_t rx_total;
+        uint32_t rx_correct;
+        uint32_t rx_err;
+        uint32_t rx_none;
+        uint32_t rx_lost;
+        uint32_t tx_total;
+        uint32_t tx_discarded;
+    } pkt_nums;
+} esp_hf_cb_param_t;
+
+typedef void (*esp_hf_incoming_data_cb_t)(const uint8_t *buf, uint32_t len);
+typedef uint32_t (*esp_hf_outgoing_data_cb_t)(uint8_t *buf, uint32_t len);
+
+typedef enum {
+    HOST_HF_SLC_CONNECT,
+    HOST_HF_SLC_DISCONNECT,
+    HOST_HF_VOLUME_CONTROL,
+    HOST_HF_CMEE_SEND,
+    HOST_HF_BSIR,
+    HOST_HF_CIEV_REPORT,
+    HOST_HF_CIND_RESPONSE,
+    HOST_HF_CLCC_RESPONSE,
+    HOST_HF_ANSWER_CALL,
+    HOST_HF_REJECT_CALL,
+    HOST_HF_OUT_CALL,
+    HOST_HF_END_CALL,
+    HOST_HF_AUDIO_CONNECT,
+    HOST_HF_AUDIO_DISCONNECT,
+    HOST_HF_VRA_CONTROL,
+    HOST_HF_PKT_STAT_NUMS_GET,
+    HOST_HF_UNKNOWN_AT_SEND,
+    HOST_HF_COPS_RESPONSE,
+    HOST_HF_CNUM_RESPONSE,
+    HOST_HF_REGISTER_DATA_CALLBACK,
+    HOST_HF_OUTGOING_DATA_READY,
+    HOST_HF_CALL_NUM,
+} host_hf_call_t;
+
+/* host only: how often each call was made */
+extern int host_hf_calls[HOST_HF_CALL_NUM];
+
+esp_err_t esp_hf_ag_slc_connect(esp_bd_addr_t remote_bda);
+esp_err_t esp_hf_ag_slc_disconnect(esp_bd_addr_t remote_bda);
+esp_err_t esp_hf_ag_volume_control(esp_bd_addr_t remote_bda, esp_hf_volume_control_target_t type, int volume);
+esp_err_t esp_hf_ag_cmee_send(esp_bd_addr_t remote_bda, esp_hf_at_response_code_t response_code, esp_hf_cme_err_t error_code);
+esp_err_t esp_hf_ag_bsir(esp_bd_addr_t remote_bda, bool state);
+esp_err_t esp_hf_ag_ciev_report(esp_bd_addr_t remote_addr, esp_hf_ciev_report_type_t ind_type, int value);
+esp_err_t esp_hf_ag_cind_response(esp_bd_addr_t remote_addr, esp_hf_call_status_t call_state,
+                                  esp_hf_call_setup_status_t call_setup_state, esp_hf_network_state_t ntk_state,
+                                  int signal, esp_hf_roaming_status_t roam, int batt_lev,
+                                  esp_hf_call_held_status_t call_held_status);
+esp_err_t esp_hf_ag_clcc_response(esp_bd_addr_t remote_addr, int index, esp_hf_current_call_direction_t dir,
+                                  esp_hf_current_call_status_t current_call_state, esp_hf_current_call_mode_t mode,
+                                  esp_hf_current_call_mpty_type_t mpty, char *number, esp_hf_call_addr_type_t type);
+esp_err_t esp_hf_ag_answer_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                                esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type);
+esp_err_t esp_hf_ag_reject_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                                esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type);
+esp_err_t esp_hf_ag_out_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                             esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type);
+esp_err_t esp_hf_ag_end_call(esp_bd_addr_t remote_addr, int num_active, int num_held, esp_hf_call_status_t call_state,
+                             esp_hf_call_setup_status_t call_setup_state, char *number, esp_hf_call_addr_type_t call_addr_type);
+esp_err_t esp_hf_ag_audio_connect(esp_bd_addr_t remote_bda);
+esp_err_t esp_hf_ag_audio_disconnect(esp_bd_addr_t remote_bda);
+esp_err_t esp_hf_ag_vra_control(esp_bd_addr_t remote_bda, esp_hf_vr_state_t value);
+esp_err_t esp_hf_ag_pkt_stat_nums_get(uint16_t sync_conn_handle);
+esp_err_t esp_hf_ag_unknown_at_send(esp_bd_addr_t remote_addr, char *unat);
+esp_err_t esp_hf_ag_cops_response(esp_bd_addr_t remote_addr, char *name);
+esp_err_t esp_hf_ag_cnum_response(esp_bd_addr_t remote_addr, char *number, int number_type,
+                                  esp_hf_subscriber_service_type_t service_type);
+esp_err_t esp_hf_ag_register_data_callback(esp_hf_incoming_data_cb_t recv, esp_hf_outgoing_data_cb_t send);
+void esp_hf_ag_outgoing_data_ready(void);
+
+#endif /* __HOST_ESP_HF_AG_API_H__ */
@@ -0,0 +1,33 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Warnings and errors are printed, info and below are dropped.
+ */
+#ifndef __HOST_ESP_LOG_H__
+#define __HOST_ESP_LOG_H__
+
+#include <stdio.h>
+#include "esp_err.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#define ESP_LOG_LEVEL(level, tag, format, ...)                                      \
+    do {                                                                            \
+        if ((level) <= ESP_LOG_WARN) {                                              \
+            printf("%c %s: " format "\n", "NEWIDV"[level], tag, ##__VA_ARGS__);     \
+        }                                                                           \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...)  ESP_LOG_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  ESP_LOG_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)  ESP_LOG_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  ESP_LOG_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)  ESP_LOG_LEVEL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#endif /* __HOST_ESP_LOG_H__ */
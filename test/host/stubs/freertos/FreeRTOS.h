@@ -0,0 +1,53 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Single threaded: critical sections are no-ops and nothing ever blocks.
+ */
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOSConfig.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define pdFALSE                     ((BaseType_t)0)
+#define pdTRUE                      ((BaseType_t)1)
+#define pdFAIL                      pdFALSE
+#define pdPASS                      pdTRUE
+#define errQUEUE_EMPTY              ((BaseType_t)0)
+#define errQUEUE_FULL               ((BaseType_t)0)
+#define errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY   (-1)
+
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS          ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define portNUM_PROCESSORS          2
+#define tskIDLE_PRIORITY            ((UBaseType_t)0U)
+#define tskNO_AFFINITY              ((BaseType_t)0x7FFFFFFF)
+
+typedef struct {
+    int owner;
+    int count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { .owner = -1, .count = 0 }
+#define portENTER_CRITICAL(mux)         ((mux)->count++)
+#define portEXIT_CRITICAL(mux)          ((mux)->count--)
+#define portENTER_CRITICAL_SAFE(mux)    portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     portEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_ISR(mux)     portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)      portEXIT_CRITICAL(mux)
+
+BaseType_t xPortGetCoreID(void);
+BaseType_t xPortInIsrContext(void);
+
+/* host only: what xPortGetCoreID() returns */
+extern BaseType_t host_core_id;
+
+#endif /* __HOST_FREERTOS_H__ */
@@ -0,0 +1,12 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ */
+#ifndef __HOST_FREERTOS_CONFIG_H__
+#define __HOST_FREERTOS_CONFIG_H__
+
+#define configTICK_RATE_HZ              CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES            25
+#define configRUN_TIME_COUNTER_TYPE     uint32_t
+#define configMAX_TASK_NAME_LEN         CONFIG_FREERTOS_MAX_TASK_NAME_LEN
+
+#endif /* __HOST_FREERTOS_CONFIG_H__ */
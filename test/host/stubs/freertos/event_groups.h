@@ -0,0 +1,20 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Waiting returns the bits at once, whether or not they are set.
+ */
+#ifndef __HOST_EVENT_GROUPS_H__
+#define __HOST_EVENT_GROUPS_H__
+
+#include "freertos/FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct host_event_group *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_all, TickType_t ticks);
+
+#endif /* __HOST_EVENT_GROUPS_H__ */
@@ -0,0 +1,23 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * A plain FIFO; send on a full queue and receive on an empty one fail at once.
+ */
+#ifndef __HOST_QUEUE_H__
+#define __HOST_QUEUE_H__
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+typedef struct {
+    uint8_t dummy[80];
+} StaticQueue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size);
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buf);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif /* __HOST_QUEUE_H__ */
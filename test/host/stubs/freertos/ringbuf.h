@@ -0,0 +1,34 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Byte buffers only: a plain circular buffer, a receive returns at most the bytes up to the end of
+ * the storage, as the real one does when the data wraps. Nothing blocks.
+ */
+#ifndef __HOST_RINGBUF_H__
+#define __HOST_RINGBUF_H__
+
+#include "freertos/FreeRTOS.h"
+
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT = 0,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+typedef struct host_ringbuf *RingbufHandle_t;
+
+typedef struct {
+    uint8_t dummy[64];
+} StaticRingbuffer_t;
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type);
+RingbufHandle_t xRingbufferCreateStatic(size_t size, RingbufferType_t type, uint8_t *storage, StaticRingbuffer_t *buf);
+void vRingbufferDelete(RingbufHandle_t rb);
+BaseType_t xRingbufferSend(RingbufHandle_t rb, const void *data, size_t size, TickType_t ticks);
+void *xRingbufferReceive(RingbufHandle_t rb, size_t *size, TickType_t ticks);
+void *xRingbufferReceiveUpTo(RingbufHandle_t rb, size_t *size, TickType_t ticks, size_t max_size);
+void vRingbufferReturnItem(RingbufHandle_t rb, void *item);
+/* uxItemsWaiting is a UBaseType_t * on the target, where it has the width of size_t */
+void vRingbufferGetInfo(RingbufHandle_t rb, UBaseType_t *uxFree, UBaseType_t *uxRead, UBaseType_t *uxWrite,
+                        UBaseType_t *uxAcquire, size_t *uxItemsWaiting);
+
+#endif /* __HOST_RINGBUF_H__ */
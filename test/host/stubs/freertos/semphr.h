@@ -0,0 +1,11 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Included by bt_app_hf.c, which no longer uses semaphores.
+ */
+#ifndef __HOST_SEMPHR_H__
+#define __HOST_SEMPHR_H__
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#endif /* __HOST_SEMPHR_H__ */
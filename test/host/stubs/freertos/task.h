@@ -0,0 +1,80 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ * Creating a task only records it; host_task_run() calls its function on the test thread.
+ */
+#ifndef __HOST_TASK_H__
+#define __HOST_TASK_H__
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+typedef struct {
+    uint8_t dummy[64];
+} StaticTask_t;
+
+typedef enum {
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid,
+} eTaskState;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    configRUN_TIME_COUNTER_TYPE ulRunTimeCounter;
+    StackType_t *pxStackBase;
+    uint32_t usStackHighWaterMark;
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                           UBaseType_t prio, StackType_t *stack_buf, StaticTask_t *tcb, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t num, configRUN_TIME_COUNTER_TYPE *total_run_time);
+BaseType_t xTaskGetCoreID(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+#define HOST_TASKS_MAX              16
+
+/* host only: a created task, its function has not run */
+struct host_task {
+    TaskFunction_t fn;
+    void *arg;
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t stack;
+    UBaseType_t prio;
+    BaseType_t core;
+    bool is_static;
+    bool deleted;
+    uint32_t notify;
+    uint32_t stack_free;
+    configRUN_TIME_COUNTER_TYPE run_time;
+};
+
+/* host only: every task created since the last host_tasks_reset(), and the one "running" */
+extern struct host_task host_tasks[HOST_TASKS_MAX];
+extern int host_task_num;
+extern TaskHandle_t host_current_task;
+
+void host_tasks_reset(void);
+/* by name, compared as far as FreeRTOS keeps it */
+TaskHandle_t host_task_find(const char *name);
+/* run the task function as the current task; returns when it returns or deletes itself */
+void host_task_run(TaskHandle_t task);
+
+#endif /* __HOST_TASK_H__ */
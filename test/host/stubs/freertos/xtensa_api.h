@@ -0,0 +1,7 @@
+/*
+ * Host stub of the ESP-IDF API subset used by main/, see test/host/CMakeLists.txt.
+ */
+#ifndef __HOST_XTENSA_API_H__
+#define __HOST_XTENSA_API_H__
+
+#endif /* __HOST_XTENSA_API_H__ */
@@ -0,0 +1,15 @@
+/*
+ * Host build configuration, see test/host/CMakeLists.txt.
+ */
+#define CONFIG_IDF_TARGET_ESP32                     1
+#define CONFIG_FREERTOS_HZ                          1000
+#define CONFIG_FREERTOS_MAX_TASK_NAME_LEN           16
+#define CONFIG_BT_BLUEDROID_PINNED_TO_CORE          0
+#define CONFIG_BTDM_CTRL_PINNED_TO_CORE             0
+#define CONFIG_ESP_TIMER_TASK_AFFINITY_CPU0         1
+#define CONFIG_PTHREAD_TASK_CORE_DEFAULT            -1
+#define CONFIG_PTHREAD_TASK_NAME_DEFAULT            "pthread"
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY          1
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS     1
+#define CONFIG_BT_HFP_AUDIO_DATA_PATH_HCI           1
+#define CONFIG_ESP_CONSOLE_UART_NUM                 0
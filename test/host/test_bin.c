@@ -0,0 +1,320 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * app_hf_msg_bin.c through hf_bin_run, with the UART and the executor faked: requests turned into
+ * argv and answered with the right id and status, frames back to back, split at every byte, text
+ * and stray SOF bytes between them, and a real frame starting inside a frame rejected for its
+ * length or CRC. Prints the cost of a request from UART bytes to the response frame.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "app_hf_msg_bin.h"
+#include "app_hf_msg_set.h"
+#include "app_hf_msg_exec.h"
+#include "host_bench.h"
+
+#define OP_VU                       (40)
+
+/* ---- UART ---- */
+
+static const uint8_t *s_in;
+static size_t s_in_len;
+static size_t s_in_pos;
+static size_t s_chunk;
+
+static uint8_t s_out[1 << 16];
+static size_t s_out_len;
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    size_t n = s_in_len - s_in_pos;
+    n = n < length ? n : length;
+    n = n < s_chunk ? n : s_chunk;
+    if (n == 0) {
+        host_advance_us((int64_t)ticks_to_wait * 1000 * portTICK_PERIOD_MS);
+        return 0;
+    }
+    memcpy(buf, s_in + s_in_pos, n);
+    s_in_pos += n;
+    return n;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    if (s_out_len + size <= sizeof(s_out)) {
+        memcpy(s_out + s_out_len, src, size);
+    }
+    s_out_len += size;
+    return size;
+}
+
+/* ---- commands and the executor ---- */
+
+static int s_argn;
+static char s_argv[4][32];
+static int s_calls;
+static bool s_busy;
+
+static int handler(int argn, char **argv)
+{
+    s_calls++;
+    s_argn = argn;
+    for (int i = 0; i < argn && i < 4; i++) {
+        snprintf(s_argv[i], sizeof(s_argv[i]), "%s", argv[i]);
+    }
+    return argn;
+}
+
+static const hf_msg_hdl_t s_vu = {OP_VU, "vu", handler};
+
+const hf_msg_hdl_t *hf_find_cmd_by_opcode(uint16_t opcode)
+{
+    return opcode == OP_VU ? &s_vu : NULL;
+}
+
+/* runs the command at once, as the executor would later */
+hf_exec_err_t hf_exec_post(const hf_msg_hdl_t *hdl, int argn, char **argv, hf_exec_done_cb_t done, uint32_t ctx)
+{
+    if (s_busy) {
+        return HF_EXEC_ERR_BUSY;
+    }
+    done(hdl, ctx, hdl->handler(argn, argv));
+    return HF_EXEC_OK;
+}
+
+/* ---- frames ---- */
+
+typedef struct {
+    uint8_t type;
+    uint8_t req_id;
+    uint16_t opcode;
+    uint32_t status;
+    uint32_t ret;
+} rsp_t;
+
+static size_t frame(uint8_t *out, uint8_t type, uint8_t req_id, uint16_t opcode, const uint8_t *args, size_t args_len)
+{
+    size_t body_len = HF_BIN_BODY_MIN + args_len;
+    uint8_t *p = out;
+    *p++ = HF_BIN_SOF;
+    *p++ = body_len & 0xff;
+    *p++ = body_len >> 8;
+    *p++ = type;
+    *p++ = req_id;
+    *p++ = opcode & 0xff;
+    *p++ = opcode >> 8;
+    memcpy(p, args, args_len);
+    p += args_len;
+    uint16_t crc = hf_bin_crc16(out + 1, p - out - 1, 0xFFFF);
+    *p++ = crc & 0xff;
+    *p++ = crc >> 8;
+    return p - out;
+}
+
+/* "vu 0 <vol>" as u32 0 and str vol */
+static size_t vu_frame(uint8_t *out, uint8_t req_id, const char *vol)
+{
+    uint8_t args[32] = {HF_BIN_ARG_U32, 0, 0, 0, 0, HF_BIN_ARG_STR, (uint8_t)strlen(vol)};
+    memcpy(&args[7], vol, strlen(vol));
+    return frame(out, HF_BIN_TYPE_REQ, req_id, OP_VU, args, 7 + strlen(vol));
+}
+
+static size_t exit_frame(uint8_t *out)
+{
+    return frame(out, HF_BIN_TYPE_REQ, 0xee, HF_BIN_OP_EXIT, NULL, 0);
+}
+
+/* the response frames sent, checked for SOF, length and CRC */
+static int responses(rsp_t *rsp, int max)
+{
+    int n = 0;
+    for (size_t i = 0; i < s_out_len; n++) {
+        const uint8_t *f = &s_out[i];
+        assert(n < max && f[0] == HF_BIN_SOF);
+        uint16_t len = f[1] | (f[2] << 8);
+        assert(len == HF_BIN_BODY_MIN + 10 && f[7] == HF_BIN_ARG_U32 && f[12] == HF_BIN_ARG_U32);
+        assert(hf_bin_crc16(f + 1, 2 + len, 0xFFFF) == (f[3 + len] | (f[4 + len] << 8)));
+        rsp[n] = (rsp_t) {
+            .type = f[3], .req_id = f[4], .opcode = f[5] | (f[6] << 8),
+            .status = f[8] | (f[9] << 8) | (f[10] << 16) | ((uint32_t)f[11] << 24),
+            .ret = f[13] | (f[14] << 8) | (f[15] << 16) | ((uint32_t)f[16] << 24),
+        };
+        i += 3 + len + 2;
+    }
+    return n;
+}
+
+/* binary mode over the given stream, read in chunks of at most `chunk` bytes */
+static void run(const uint8_t *in, size_t len, size_t chunk)
+{
+    s_in = in;
+    s_in_len = len;
+    s_in_pos = 0;
+    s_chunk = chunk;
+    s_out_len = 0;
+    s_calls = 0;
+    hf_bin_run();
+}
+
+static uint8_t s_stream[1 << 16];
+static rsp_t s_rsp[64];
+
+/* three requests, the last answered by the EXIT response */
+static void check_three(void)
+{
+    int n = responses(s_rsp, 64);
+    assert(n == 4 && s_calls == 3);
+    for (int i = 0; i < 3; i++) {
+        assert(s_rsp[i].type == HF_BIN_TYPE_RSP && s_rsp[i].req_id == i + 1 && s_rsp[i].opcode == OP_VU);
+        assert(s_rsp[i].status == HF_BIN_ST_OK && s_rsp[i].ret == 3);
+    }
+    assert(s_rsp[3].req_id == 0xee && s_rsp[3].opcode == HF_BIN_OP_EXIT);
+    assert(strcmp(s_argv[0], "vu") == 0 && strcmp(s_argv[1], "0") == 0 && strcmp(s_argv[2], "0123") == 0);
+}
+
+static void test_requests(void)
+{
+    size_t n = 0;
+
+    assert(hf_bin_crc16((const uint8_t *)"123456789", 9, 0xFFFF) == 0x29B1);
+
+    // back to back, then every split of the stream into reads
+    for (uint8_t id = 1; id <= 3; id++) {
+        n += vu_frame(&s_stream[n], id, "0123");
+    }
+    n += exit_frame(&s_stream[n]);
+    run(s_stream, n, 64);
+    check_three();
+    for (size_t chunk = 1; chunk <= 17; chunk++) {
+        run(s_stream, n, chunk);
+        check_three();
+    }
+
+    // statuses
+    uint8_t bad_arg[] = {0x07};
+    uint8_t short_u32[] = {HF_BIN_ARG_U32, 1, 2};
+    n = 0;
+    n += frame(&s_stream[n], HF_BIN_TYPE_REQ, 1, 99, NULL, 0);
+    n += frame(&s_stream[n], HF_BIN_TYPE_RSP, 2, OP_VU, NULL, 0);
+    n += frame(&s_stream[n], HF_BIN_TYPE_REQ, 3, OP_VU, bad_arg, sizeof(bad_arg));
+    n += frame(&s_stream[n], HF_BIN_TYPE_REQ, 4, OP_VU, short_u32, sizeof(short_u32));
+    n += frame(&s_stream[n], HF_BIN_TYPE_REQ, 5, HF_BIN_OP_PING, NULL, 0);
+    n += exit_frame(&s_stream[n]);
+    // never read: binary mode has ended
+    n += vu_frame(&s_stream[n], 6, "1");
+    run(s_stream, n, 64);
+    assert(responses(s_rsp, 64) == 6 && s_calls == 0);
+    assert(s_rsp[0].status == HF_BIN_ST_UNKNOWN_OPCODE && s_rsp[1].status == HF_BIN_ST_BAD_TYPE);
+    assert(s_rsp[2].status == HF_BIN_ST_BAD_ARGS && s_rsp[3].status == HF_BIN_ST_BAD_ARGS);
+    assert(s_rsp[4].req_id == 5 && s_rsp[4].status == HF_BIN_ST_OK);
+
+    s_busy = true;
+    n = vu_frame(s_stream, 1, "1");
+    n += exit_frame(&s_stream[n]);
+    run(s_stream, n, 64);
+    assert(responses(s_rsp, 64) == 2 && s_rsp[0].status == HF_BIN_ST_BUSY && s_calls == 0);
+    s_busy = false;
+
+    // no EXIT: binary mode ends after the idle timeout
+    n = vu_frame(s_stream, 1, "1");
+    int64_t start = esp_timer_get_time();
+    run(s_stream, n, 64);
+    assert(responses(s_rsp, 64) == 1 && s_calls == 1);
+    assert(esp_timer_get_time() - start >= (int64_t)HF_BIN_IDLE_TIMEOUT_MS * 1000);
+}
+
+static void test_resync(void)
+{
+    uint8_t f[64];
+    size_t f_len = vu_frame(f, 2, "0123");
+    size_t n = 0;
+
+    // log text with stray SOF bytes in front of the first frame
+    const char *log = "I (123) HF: \xa5 level \xa5\xa5\n";
+    memcpy(&s_stream[n], log, strlen(log));
+    n += strlen(log);
+    n += vu_frame(&s_stream[n], 1, "0123");
+
+    // a stray SOF right before a frame: "A5 A5 len" reads as a length too long
+    s_stream[n++] = HF_BIN_SOF;
+    memcpy(&s_stream[n], f, f_len);
+    n += f_len;
+
+    // a SOF with a plausible length: the next request and the EXIT are taken for its body, and
+    // only the log text after them completes it, with a wrong CRC
+    s_stream[n++] = HF_BIN_SOF;
+    s_stream[n++] = 40;
+    s_stream[n++] = 0;
+    s_stream[n++] = 'x';
+    n += vu_frame(&s_stream[n], 3, "0123");
+    n += exit_frame(&s_stream[n]);
+    memset(&s_stream[n], '.', 16);
+    n += 16;
+
+    for (size_t chunk = 1; chunk <= 64; chunk++) {
+        run(s_stream, n, chunk);
+        check_three();
+    }
+
+    // a corrupt frame (a flipped bit) right before a good one, several times over
+    n = 0;
+    for (uint8_t id = 1; id <= 3; id++) {
+        size_t at = n;
+        n += vu_frame(&s_stream[n], id, "0123");
+        s_stream[at + 8] ^= 0x10;
+        n += vu_frame(&s_stream[n], id, "0123");
+    }
+    n += exit_frame(&s_stream[n]);
+    run(s_stream, n, 7);
+    check_three();
+}
+
+static void bench(void)
+{
+    const int frames = 2000;
+    const int rounds = 200;
+    host_bench_t t;
+    double ns, cycles;
+    size_t n = 0;
+
+    for (int i = 0; i < frames; i++) {
+        n += vu_frame(&s_stream[n], i, "12");
+    }
+    size_t req_len = n / frames;
+    n += exit_frame(&s_stream[n]);
+    // without the mode banner and log line of every run
+    fflush(stdout);
+    int out = dup(1);
+    dup2(open("/dev/null", O_WRONLY), 1);
+    host_bench_start(&t);
+    for (int r = 0; r < rounds; r++) {
+        run(s_stream, n, 64);
+    }
+    host_bench_stop(&t, rounds * frames, &ns, &cycles);
+    fflush(stdout);
+    dup2(out, 1);
+    assert(s_calls == frames);
+    printf("binary request (%u bytes) to response frame: %.0f ns %.0f cycles, %.1f cycles per byte\n",
+           (unsigned int)req_len, ns, cycles, cycles / req_len);
+}
+
+int main(void)
+{
+    test_requests();
+    test_resync();
+    bench();
+    printf("bin ok\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_call.c with bt_app_ind.c: the transition table, audio brought up and released with the
+ * call, AT+CLCC from the current call, and the call indicators reported only to the peers the
+ * stack did not already tell.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "bt_app_call.h"
+#include "bt_app_ind.h"
+
+static int s_ciev[2];
+
+esp_err_t esp_hf_ag_ciev_report(esp_bd_addr_t remote_addr, esp_hf_ciev_report_type_t ind_type, int value)
+{
+    s_ciev[remote_addr[5] - 1]++;
+    return ESP_OK;
+}
+
+static void test_table(void)
+{
+    // END goes idle from everywhere, only RING and DIAL leave idle
+    for (int s = 0; s < BT_APP_CALL_STATE_NUM; s++) {
+        for (int e = 0; e < BT_APP_CALL_EVT_NUM; e++) {
+            bt_app_call_state_t n = bt_app_call_next(s, e);
+            if (s != BT_APP_CALL_IDLE && e == BT_APP_CALL_EVT_END) {
+                assert(n == BT_APP_CALL_IDLE);
+            }
+            if (s == BT_APP_CALL_IDLE) {
+                assert((e == BT_APP_CALL_EVT_RING || e == BT_APP_CALL_EVT_DIAL) == (n != BT_APP_CALL_STATE_NUM));
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    esp_bd_addr_t a = {1, 2, 3, 4, 5, 1};
+    esp_bd_addr_t b = {1, 2, 3, 4, 5, 2};
+    bt_app_call_info_t info;
+
+    test_table();
+    bt_app_ind_cind_response(a);
+    bt_app_ind_peer_connected(a);
+    bt_app_ind_cind_response(b);
+    bt_app_ind_peer_connected(b);
+
+    bt_app_call_clcc_response(a);
+    assert(host_hf_calls[HOST_HF_CLCC_RESPONSE] == 1);
+    assert(!bt_app_call_event(a, BT_APP_CALL_EVT_ANSWER, NULL));
+
+    // the stack tells a about the ring, the indicator model tells b
+    assert(bt_app_call_event(a, BT_APP_CALL_EVT_RING, "555"));
+    assert(s_ciev[0] == 0 && s_ciev[1] == 1);
+    bt_app_call_clcc_response(a);
+    assert(host_hf_calls[HOST_HF_CLCC_RESPONSE] == 3);
+
+    host_set_time_us(1000000);
+    assert(bt_app_call_event(a, BT_APP_CALL_EVT_ANSWER, NULL));
+    assert(host_hf_calls[HOST_HF_AUDIO_CONNECT] == 1);
+    assert(s_ciev[0] == 0 && s_ciev[1] == 3);
+    host_set_time_us(1180000);
+    bt_app_call_on_audio(true);
+    bt_app_call_get_info(&info);
+    assert(info.state == BT_APP_CALL_ACTIVE && info.talk_ms_last == 180 && info.calls == 1);
+
+    assert(bt_app_call_event(a, BT_APP_CALL_EVT_HOLD, NULL));
+    assert(bt_app_call_event(a, BT_APP_CALL_EVT_RESUME, NULL));
+    assert(host_hf_calls[HOST_HF_AUDIO_CONNECT] == 1);
+    assert(bt_app_call_event(a, BT_APP_CALL_EVT_END, NULL));
+    assert(host_hf_calls[HOST_HF_AUDIO_DISCONNECT] == 1);
+    bt_app_call_on_audio(false);
+    assert(s_ciev[0] == 0);
+
+    assert(bt_app_call_event(a, BT_APP_CALL_EVT_DIAL, "777"));
+    assert(strcmp(bt_app_call_last_number(), "777") == 0);
+    assert(bt_app_call_event(a, BT_APP_CALL_EVT_ALERT, NULL));
+
+    // a is gone mid call: nothing goes to a, b hears the call ended
+    int b_before = s_ciev[1];
+    bt_app_ind_peer_disconnected(a);
+    bt_app_call_on_disconnect(a);
+    bt_app_call_get_info(&info);
+    assert(info.state == BT_APP_CALL_IDLE && info.rejected == 1);
+    assert(s_ciev[0] == 0 && s_ciev[1] == b_before + 1);
+    printf("call ok, %d reports to the other peer\n", s_ciev[1]);
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_core.c: with BT_APP_MEM_STATIC dispatch parameters come from the fixed pool, a larger
+ * parameter or an empty pool falls back to the heap, a full queue gives the record back, and a
+ * steady stream of dispatches never touches the heap.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_core.h"
+#include "bt_app_mem.h"
+
+static int s_handled;
+
+static void handler(uint16_t event, void *param)
+{
+    assert(((char *)param)[0] == (char)event);
+    s_handled++;
+}
+
+static void run_core(void)
+{
+    host_task_run(host_task_find("BtAppT"));
+}
+
+static uint32_t heap_allocs(void)
+{
+    bt_app_mem_stats_t st;
+    bt_app_mem_get_stats(&st);
+    return st.subsys[BT_APP_MEM_DISPATCH].allocs;
+}
+
+static uint32_t heap_frees(void)
+{
+    bt_app_mem_stats_t st;
+    bt_app_mem_get_stats(&st);
+    return st.subsys[BT_APP_MEM_DISPATCH].frees;
+}
+
+int main(void)
+{
+    char small[BT_APP_CORE_PARAM_SIZE];
+    char big[BT_APP_CORE_PARAM_SIZE + 1];
+
+    bt_app_task_start_up();
+    assert(host_task_find("BtAppT"));
+
+    for (int i = 0; i < BT_APP_CORE_PARAM_POOL_SIZE; i++) {
+        small[0] = i;
+        assert(bt_app_work_dispatch(handler, i, small, sizeof(small), NULL));
+    }
+    assert(heap_allocs() == (BT_APP_MEM_STATIC ? 0 : BT_APP_CORE_PARAM_POOL_SIZE));
+#if BT_APP_MEM_STATIC
+    big[0] = 8;
+    assert(bt_app_work_dispatch(handler, 8, big, sizeof(big), NULL));
+    assert(heap_allocs() == 1);
+    small[0] = 9;
+    assert(bt_app_work_dispatch(handler, 9, small, 8, NULL));
+    assert(heap_allocs() == 2);
+    // the queue is full, the record goes back
+    small[0] = 10;
+    assert(!bt_app_work_dispatch(handler, 10, small, 8, NULL));
+    assert(heap_allocs() == 3 && heap_frees() == 1);
+    run_core();
+    assert(s_handled == BT_APP_CORE_QUEUE_LEN && heap_frees() == 3);
+
+    for (int r = 0; r < 100; r++) {
+        for (int i = 0; i < BT_APP_CORE_PARAM_POOL_SIZE; i++) {
+            small[0] = i;
+            assert(bt_app_work_dispatch(handler, i, small, 16, NULL));
+        }
+        run_core();
+    }
+    assert(heap_allocs() == 3 && s_handled == BT_APP_CORE_QUEUE_LEN + 100 * BT_APP_CORE_PARAM_POOL_SIZE);
+#endif
+    bt_app_task_shut_down();
+    printf("core ok, %d handled\n", s_handled);
+    return 0;
+}
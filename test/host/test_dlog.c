@@ -0,0 +1,343 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_dlog.c: each task claims its own ring, the pool runs out and drops, a ring given back is
+ * reused only once drained, and bt_app_tasks_delete gives it back (the leak fixed in b99bbf6). A
+ * full ring drops and counts. %s text is copied at write time, cut to BT_APP_DLOG_STR_LEN. Two
+ * producer pthreads against the drain task in a third lose nothing that is not counted and never
+ * show a torn record. Prints the cost of a record against formatting an ESP_LOGI line.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_dlog.h"
+#include "bt_app_tasks.h"
+#include "host_bench.h"
+
+#define PRODUCER_RECS               (200000)
+
+/* each pthread says which task it stands for */
+static _Thread_local TaskHandle_t s_self;
+static _Thread_local bool s_drain_thread;
+static atomic_bool s_stop;
+static _Thread_local bool s_last_pass;
+
+static struct host_task s_fake[BT_APP_DLOG_RINGS + 2];
+static TaskHandle_t s_drain;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_self;
+}
+
+/* the drain task makes one pass per host_task_run; on its own pthread it runs until told to stop */
+void vTaskDelay(TickType_t ticks)
+{
+    if (!s_drain_thread) {
+        vTaskDelete(NULL);
+        return;
+    }
+    if (s_last_pass) {
+        pthread_exit(NULL);
+    }
+    s_last_pass = atomic_load(&s_stop);
+    sched_yield();
+}
+
+static void drain(void)
+{
+    host_task_run(s_drain);
+    s_drain->deleted = false;
+}
+
+/* ---- raw output ---- */
+
+static FILE *s_cap;
+static int s_stdout;
+
+static void capture_start(void)
+{
+    fflush(stdout);
+    s_cap = tmpfile();
+    s_stdout = dup(1);
+    dup2(fileno(s_cap), 1);
+}
+
+static void capture_stop(void)
+{
+    fflush(stdout);
+    dup2(s_stdout, 1);
+    close(s_stdout);
+    rewind(s_cap);
+}
+
+typedef struct {
+    unsigned id;
+    unsigned nargs;
+    uint32_t args[BT_APP_DLOG_ARGS_MAX];
+    char str[BT_APP_DLOG_STR_LEN + 1];
+    unsigned str_len;
+} raw_rec_t;
+
+static bool raw_next(raw_rec_t *r)
+{
+    char line[256];
+    while (fgets(line, sizeof(line), s_cap)) {
+        const char *p = strstr(line, "DLOG:");
+        unsigned ts, core;
+        if (!p || sscanf(p + 5, "%8x%4x%2x%2x", &ts, &r->id, &r->nargs, &core) != 4) {
+            continue;
+        }
+        p += 5 + 16;
+        for (unsigned i = 0; i < r->nargs; i++, p += 8) {
+            assert(sscanf(p, "%8x", &r->args[i]) == 1);
+        }
+        memset(r->str, 0, sizeof(r->str));
+        unsigned c;
+        for (r->str_len = 0; sscanf(p, "%2x", &c) == 1 && p[0] != '\n'; p += 2) {
+            assert(r->str_len < BT_APP_DLOG_STR_LEN);
+            r->str[r->str_len++] = (char)c;
+        }
+        return true;
+    }
+    fclose(s_cap);
+    return false;
+}
+
+/* ---- rings ---- */
+
+static void test_claim_release(void)
+{
+    uint32_t dropped = bt_app_dlog_dropped();
+    raw_rec_t r;
+
+    // every ring taken, one task too many drops
+    for (int i = 0; i < BT_APP_DLOG_RINGS + 1; i++) {
+        s_self = &s_fake[i];
+        BT_APP_DLOG(CALL_TALK, i);
+    }
+    assert(bt_app_dlog_dropped() == dropped + 1);
+    // a task with a ring keeps it
+    s_self = &s_fake[2];
+    BT_APP_DLOG(CALL_TALK, 100);
+    assert(bt_app_dlog_dropped() == dropped + 1);
+
+    // given back through the task delete, but not reused before its records are out
+    bt_app_tasks_delete(&s_fake[2]);
+    assert(s_fake[2].deleted);
+    s_self = &s_fake[BT_APP_DLOG_RINGS + 1];
+    BT_APP_DLOG(CALL_TALK, 200);
+    assert(bt_app_dlog_dropped() == dropped + 2);
+
+    capture_start();
+    drain();
+    s_self = &s_fake[BT_APP_DLOG_RINGS + 1];
+    BT_APP_DLOG(CALL_TALK, 300);
+    drain();
+    capture_stop();
+    assert(bt_app_dlog_dropped() == dropped + 2);
+
+    // all claimed rings came out in order, the freed ring carried the late task's record
+    uint32_t seen = 0, last_of_2 = 0;
+    while (raw_next(&r)) {
+        assert(r.id == BT_APP_DLOG_CALL_TALK && r.nargs == 1 && r.str_len == 0);
+        seen++;
+        if (r.args[0] == 2 || r.args[0] == 100) {
+            assert(r.args[0] > last_of_2);
+            last_of_2 = r.args[0];
+        }
+    }
+    assert(seen == BT_APP_DLOG_RINGS + 1 + 1);
+    assert(last_of_2 == 100);
+
+    // everyone gives their ring back
+    for (int i = 0; i < BT_APP_DLOG_RINGS + 2; i++) {
+        bt_app_dlog_release(&s_fake[i]);
+    }
+    drain();
+}
+
+static void test_full_ring(void)
+{
+    uint32_t dropped = bt_app_dlog_dropped();
+    raw_rec_t r;
+
+    s_self = &s_fake[0];
+    for (uint32_t i = 0; i < BT_APP_DLOG_RING_LEN + 3; i++) {
+        BT_APP_DLOG(CALL_TALK, i);
+    }
+    assert(bt_app_dlog_dropped() == dropped + 3);
+    capture_start();
+    drain();
+    capture_stop();
+    uint32_t n = 0;
+    while (raw_next(&r)) {
+        assert(r.args[0] == n);
+        n++;
+    }
+    assert(n == BT_APP_DLOG_RING_LEN);
+}
+
+static void test_strings(void)
+{
+    char name[40];
+    raw_rec_t r;
+
+    s_self = &s_fake[0];
+    capture_start();
+    // the text is taken at the call, the buffer can change right after
+    strcpy(name, "HfScrT");
+    BT_APP_DLOG(MEM_STACK_LOW, BT_APP_DLOG_STR(name), 312);
+    strcpy(name, "gone");
+    BT_APP_DLOG(CALL_STATE, BT_APP_DLOG_STR("incoming"), BT_APP_DLOG_STR("active"));
+    // the first is cut to fill str, the second comes out empty
+    BT_APP_DLOG(CALL_STATE, BT_APP_DLOG_STR("an_overlong_state_name_for_a_call"), BT_APP_DLOG_STR("x"));
+    BT_APP_DLOG(HF_CONN_STATE, BT_APP_DLOG_STR(NULL), 0x3ef, 0x1f);
+    drain();
+    capture_stop();
+
+    assert(raw_next(&r) && r.id == BT_APP_DLOG_MEM_STACK_LOW);
+    assert(r.args[0] == 0 && strcmp(r.str, "HfScrT") == 0 && r.args[1] == 312 && r.str_len == 7);
+    assert(raw_next(&r) && r.id == BT_APP_DLOG_CALL_STATE);
+    assert(strcmp(&r.str[r.args[0]], "incoming") == 0 && strcmp(&r.str[r.args[1]], "active") == 0);
+    assert(raw_next(&r) && r.str_len == BT_APP_DLOG_STR_LEN);
+    assert(strlen(&r.str[r.args[0]]) == BT_APP_DLOG_STR_LEN - 1 && strncmp(&r.str[r.args[0]], "an_overlong", 11) == 0);
+    assert(r.args[1] == BT_APP_DLOG_STR_LEN - 1 && r.str[r.args[1]] == '\0');
+    assert(raw_next(&r) && strcmp(&r.str[r.args[0]], "(null)") == 0 && r.args[1] == 0x3ef && r.args[2] == 0x1f);
+    assert(!raw_next(&r));
+}
+
+/* ---- producers against the drain task ---- */
+
+static void *producer(void *arg)
+{
+    s_self = &s_fake[(intptr_t)arg];
+    for (uint32_t seq = 0; seq < PRODUCER_RECS; seq++) {
+        BT_APP_DLOG(HF_SPEED, (uint32_t)(intptr_t)arg, seq, ~seq);
+        if ((seq & 63) == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *drainer(void *arg)
+{
+    s_drain_thread = true;
+    s_drain->fn(NULL);
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    uint32_t dropped = bt_app_dlog_dropped();
+    pthread_t p[2], d;
+    uint32_t next[2] = {0, 0};
+    uint32_t got = 0;
+    raw_rec_t r;
+
+    capture_start();
+    pthread_create(&d, NULL, drainer, NULL);
+    pthread_create(&p[0], NULL, producer, (void *)(intptr_t)0);
+    pthread_create(&p[1], NULL, producer, (void *)(intptr_t)1);
+    pthread_join(p[0], NULL);
+    pthread_join(p[1], NULL);
+    atomic_store(&s_stop, true);
+    pthread_join(d, NULL);
+    capture_stop();
+
+    while (raw_next(&r)) {
+        assert(r.id == BT_APP_DLOG_HF_SPEED && r.nargs == 3 && r.args[0] < 2);
+        // in order per producer, and never half of one record and half of another
+        assert(r.args[1] >= next[r.args[0]] && r.args[2] == ~r.args[1]);
+        next[r.args[0]] = r.args[1] + 1;
+        got++;
+    }
+    uint32_t lost = bt_app_dlog_dropped() - dropped;
+    printf("2 producers x %u records: %u drained, %u dropped on a full ring\n",
+           PRODUCER_RECS, (unsigned)got, (unsigned)lost);
+    assert(got + lost == 2 * PRODUCER_RECS);
+    assert(next[0] > 0 && next[1] > 0);
+}
+
+/* ---- cost ---- */
+
+static void bench(void)
+{
+    const int rounds = 20000;
+    const int batch = BT_APP_DLOG_RING_LEN;
+    uint64_t ns[2] = {0}, cycles[2] = {0};
+    FILE *null = fopen("/dev/null", "w");
+
+    s_self = &s_fake[0];
+    bt_app_dlog_set_raw(true);
+    capture_start();
+    for (int n = 0; n < rounds; n++) {
+        for (int k = 0; k < 2; k++) {
+            uint64_t t = host_bench_ns(), c = host_bench_cycles();
+            for (int i = 0; i < batch; i++) {
+                if (k == 0) {
+                    BT_APP_DLOG(HF_SPEED, n, n + 5000, 64000);
+                } else {
+                    BT_APP_DLOG(HF_CONN_STATE, BT_APP_DLOG_STR("SLC_CONNECTED"), 0x3ef, 0x1f);
+                }
+            }
+            ns[k] += host_bench_ns() - t;
+            cycles[k] += host_bench_cycles() - c;
+            drain();
+        }
+    }
+    capture_stop();
+    fclose(s_cap);
+
+    // what ESP_LOGI does before the UART: the prefix and the message formatted into a line
+    char line[160];
+    int len = 0;
+    host_bench_t b;
+    double log_ns, log_cycles;
+    host_bench_start(&b);
+    for (int n = 0; n < rounds * batch; n++) {
+        len = snprintf(line, sizeof(line), "I (%u) %s: speed(%u ms ~ %u ms): %u bit/s\n",
+                       (unsigned)n, "BT_APP_HF", (unsigned)n, (unsigned)n + 5000, 64000u);
+        fputs(line, null);
+    }
+    host_bench_stop(&b, rounds * batch, &log_ns, &log_cycles);
+    fclose(null);
+
+    const double recs = (double)rounds * batch;
+    printf("dlog cost per record, the ring not full:\n");
+    printf("  BT_APP_DLOG 3 numbers      %6.1f ns %6.0f cycles\n", ns[0] / recs, cycles[0] / recs);
+    printf("  BT_APP_DLOG %%s + 2 numbers %6.1f ns %6.0f cycles\n", ns[1] / recs, cycles[1] / recs);
+    printf("  ESP_LOGI formatting only   %6.1f ns %6.0f cycles (%d-byte line)\n", log_ns, log_cycles, len);
+    // 10 bits a character; once the 128-byte TX FIFO is full the caller waits this long per line
+    printf("  ESP_LOGI line on a 115200 baud UART: %.0f us\n", len * 10 * 1e6 / 115200);
+}
+
+int main(void)
+{
+    bt_app_dlog_init();
+    s_drain = host_task_find("BtAppDlogT");
+    assert(s_drain);
+    bt_app_dlog_set_raw(true);
+
+    test_claim_release();
+    test_full_ring();
+    test_strings();
+    test_concurrent();
+    bench();
+    printf("dlog ok\n");
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * app_hf_msg_exec.c: a submitted command returns to the REPL at once while the executor is busy
+ * with a slow one, a full queue, too many arguments or too long a line are rejected and nothing is
+ * cut short, and hf_exec_run queues behind the commands already pending, returns once the executor
+ * has run the step, with the handler return and the handler output left on the console.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "app_hf_msg_set.h"
+#include "app_hf_msg_exec.h"
+
+static char s_ran[256];
+static FILE *s_console;
+static bool s_quiet;
+static TaskHandle_t s_exec;
+
+static int record(int argn, char **argv)
+{
+    // the executor runs every handler, and only binary mode ones without a console
+    assert(xTaskGetCurrentTaskHandle() == s_exec);
+    s_quiet = (stdout != s_console);
+    for (int i = 0; i < argn; i++) {
+        strcat(s_ran, argv[i]);
+        strcat(s_ran, i + 1 < argn ? " " : ";");
+    }
+    return argn;
+}
+
+/* like con, which sleeps between SLC and audio connect */
+static int slow(int argn, char **argv)
+{
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    return record(argn, argv);
+}
+
+static const hf_msg_hdl_t s_cmds[] = {
+    {5, "con", slow},
+    {40, "vu", record},
+};
+
+const hf_msg_hdl_t *hf_get_cmd_tbl(void)
+{
+    return s_cmds;
+}
+
+size_t hf_get_cmd_tbl_size(void)
+{
+    return sizeof(s_cmds) / sizeof(s_cmds[0]);
+}
+
+const hf_msg_hdl_t *hf_find_cmd(const char *name)
+{
+    for (size_t i = 0; i < sizeof(s_cmds) / sizeof(s_cmds[0]); i++) {
+        if (strcmp(s_cmds[i].str, name) == 0) {
+            return &s_cmds[i];
+        }
+    }
+    return NULL;
+}
+
+/* a task waiting for its notification lets the executor run first */
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    TaskHandle_t t = xTaskGetCurrentTaskHandle();
+    if (t->notify == 0) {
+        host_task_run(s_exec);
+    }
+    uint32_t n = t->notify;
+    t->notify = 0;
+    return n;
+}
+
+static FILE *s_cap;
+static int s_stdout;
+
+static void capture_start(void)
+{
+    fflush(stdout);
+    s_cap = tmpfile();
+    s_stdout = dup(1);
+    dup2(fileno(s_cap), 1);
+}
+
+static char *capture_stop(void)
+{
+    static char out[4096];
+    fflush(stdout);
+    dup2(s_stdout, 1);
+    close(s_stdout);
+    rewind(s_cap);
+    out[fread(out, 1, sizeof(out) - 1, s_cap)] = '\0';
+    fclose(s_cap);
+    return out;
+}
+
+static void test_responsive(void)
+{
+    char *con[] = {"con"};
+    char *vu[] = {"vu", "0", "12"};
+
+    s_ran[0] = '\0';
+    host_set_time_us(0);
+    // the REPL gets the prompt back at once, the slow handler has not even started
+    assert(hf_exec_submit(1, con) == 0);
+    assert(hf_exec_submit(3, vu) == 0);
+    assert(esp_timer_get_time() == 0 && s_ran[0] == '\0');
+
+    capture_start();
+    host_task_run(s_exec);
+    char *out = capture_stop();
+    assert(strcmp(s_ran, "con;vu 0 12;") == 0);
+    assert(esp_timer_get_time() == 1000000);
+    assert(strstr(out, "con: done, ret 1, queued 0 ms, ran 1000 ms\n"));
+    assert(strstr(out, "vu: done, ret 3, queued 1000 ms, ran 0 ms\n"));
+
+    capture_start();
+    hf_exec_dump();
+    out = capture_stop();
+    assert(strstr(out, "cmd.vu") && strstr(out, "max=1000 ms"));
+}
+
+static void test_reject(void)
+{
+    static char arg[HF_EXEC_LINE_MAX];
+    char *argv[HF_EXEC_ARGS_MAX + 1];
+    char *vu[] = {"vu", "1"};
+
+    // full queue: rejected, not blocking and not dropping one already queued
+    s_ran[0] = '\0';
+    for (int i = 0; i < HF_EXEC_QUEUE_LEN; i++) {
+        assert(hf_exec_submit(2, vu) == 0);
+    }
+    capture_start();
+    assert(hf_exec_submit(2, vu) == 1);
+    char *out = capture_stop();
+    assert(strstr(out, "vu: busy"));
+    assert(hf_exec_post(&s_cmds[1], 2, vu, NULL, 0) == HF_EXEC_ERR_BUSY);
+    host_task_run(s_exec);
+    assert(strlen(s_ran) == HF_EXEC_QUEUE_LEN * strlen("vu 1;"));
+    capture_start();
+    hf_exec_dump();
+    out = capture_stop();
+    assert(strstr(out, "cmd.rejected               2\n"));
+
+    // the arguments fill the line exactly: taken whole
+    argv[0] = "vu";
+    argv[1] = arg;
+    memset(arg, 'a', sizeof(arg) - 4);
+    arg[sizeof(arg) - 4] = '\0';
+    assert(hf_exec_post(&s_cmds[1], 2, argv, NULL, 0) == HF_EXEC_OK);
+    s_ran[0] = '\0';
+    capture_start();
+    host_task_run(s_exec);
+    capture_stop();
+    assert(strlen(s_ran) == 3 + strlen(arg) + 1);
+
+    // one character more: rejected, not cut short
+    arg[sizeof(arg) - 4] = 'a';
+    arg[sizeof(arg) - 3] = '\0';
+    assert(hf_exec_post(&s_cmds[1], 2, argv, NULL, 0) == HF_EXEC_ERR_LINE);
+    capture_start();
+    assert(hf_exec_submit(2, argv) == 1);
+    out = capture_stop();
+    assert(strstr(out, "vu: arguments longer than"));
+
+    // too many arguments
+    for (int i = 1; i <= HF_EXEC_ARGS_MAX; i++) {
+        argv[i] = "1";
+    }
+    assert(hf_exec_post(&s_cmds[1], HF_EXEC_ARGS_MAX + 1, argv, NULL, 0) == HF_EXEC_ERR_ARGC);
+    assert(hf_exec_post(&s_cmds[1], HF_EXEC_ARGS_MAX, argv, NULL, 0) == HF_EXEC_OK);
+    s_ran[0] = '\0';
+    capture_start();
+    host_task_run(s_exec);
+    capture_stop();
+    assert(strlen(s_ran) == 3 + 2 * (HF_EXEC_ARGS_MAX - 1));
+}
+
+static int s_step_ret;
+static hf_exec_err_t s_step_err;
+
+static void script_task(void *arg)
+{
+    char *argv[] = {"vu", "0", "12"};
+    s_step_err = hf_exec_run(&s_cmds[1], 3, argv, &s_step_ret);
+    vTaskDelete(NULL);
+}
+
+static void test_run(void)
+{
+    char *con[] = {"con"};
+    TaskHandle_t script;
+
+    s_ran[0] = '\0';
+    // a typed command is pending: the step runs after it
+    assert(hf_exec_submit(1, con) == 0);
+    xTaskCreatePinnedToCore(script_task, "HfScrT", 4096, NULL, 1, &script, 0);
+    host_task_run(script);
+    assert(script->deleted);
+    assert(s_step_err == HF_EXEC_OK && s_step_ret == 3);
+    assert(strcmp(s_ran, "con;vu 0 12;") == 0);
+    assert(!s_quiet);
+
+    // from a handler on the executor the step runs at once
+    char *vu[] = {"vu", "1"};
+    int ret;
+    host_current_task = s_exec;
+    s_ran[0] = '\0';
+    assert(hf_exec_run(&s_cmds[1], 2, vu, &ret) == HF_EXEC_OK && ret == 2);
+    assert(strcmp(s_ran, "vu 1;") == 0);
+    host_current_task = NULL;
+}
+
+int main(void)
+{
+    s_console = stdout;
+    hf_exec_init();
+    s_exec = host_task_find("HfExecT");
+    assert(s_exec);
+    test_responsive();
+    test_reject();
+    test_run();
+    printf("exec ok\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_floor.c: half duplex gating by AT+BVRA, a collision is refused with BVRA=0, release by
+ * the holder only, disconnect frees the floor, full duplex opens both directions.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "bt_app_floor.h"
+#include "bt_app_metrics.h"
+
+int main(void)
+{
+    esp_bd_addr_t a = {1, 1, 1, 1, 1, 1};
+    esp_bd_addr_t b = {2, 2, 2, 2, 2, 2};
+    bt_app_floor_stats_t st;
+
+    assert(bt_app_floor_rx_open() && bt_app_floor_tx_open());
+    bt_app_floor_set_mode(BT_APP_FLOOR_HALF_DUPLEX);
+    bt_app_floor_on_audio(a, true);
+    assert(!bt_app_floor_rx_open() && bt_app_floor_tx_open());
+
+    // a talks, audio is already up
+    host_set_time_us(1000000);
+    bt_app_floor_on_bvra(a, true);
+    assert(bt_app_floor_rx_open() && !bt_app_floor_tx_open());
+    assert(host_hf_calls[HOST_HF_AUDIO_CONNECT] == 0);
+
+    // b collides and is told no
+    bt_app_floor_on_bvra(b, true);
+    assert(host_hf_calls[HOST_HF_VRA_CONTROL] == 1);
+    host_set_time_us(1045000);
+    bt_app_floor_on_rx_frame();
+    bt_app_floor_on_rx_frame();
+    bt_app_floor_get_stats(&st);
+    assert(st.talk_ms_last == 45 && st.collisions == 1 && st.grants == 1);
+
+    // only the holder releases
+    bt_app_floor_on_bvra(b, false);
+    assert(bt_app_floor_rx_open());
+    bt_app_floor_on_bvra(a, false);
+    assert(!bt_app_floor_rx_open() && bt_app_floor_tx_open());
+
+    // b talks, a listens
+    bt_app_floor_on_bvra(b, true);
+    assert(!bt_app_floor_rx_open() && bt_app_floor_tx_open());
+    bt_app_floor_on_bvra(a, true);
+    assert(host_hf_calls[HOST_HF_VRA_CONTROL] == 2);
+    bt_app_floor_on_disconnect(b);
+    assert(bt_app_floor_request(a));
+
+    bt_app_floor_set_mode(BT_APP_FLOOR_FULL_DUPLEX);
+    assert(bt_app_floor_rx_open() && bt_app_floor_tx_open());
+    bt_app_floor_get_stats(&st);
+    assert(st.collisions == 2 && st.grants == 3);
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_FLOOR_GRANTS) == st.grants);
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_FLOOR_COLLISIONS) == st.collisions);
+    printf("floor ok, %u requests, %u grants, %u collisions\n", (unsigned)st.requests, (unsigned)st.grants,
+           (unsigned)st.collisions);
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_gain.c: level table, exact unity, ramps in both directions without steps, AGC lifting a
+ * quiet talker, holding down a loud one and leaving noise alone, paths independent. Prints the
+ * cost per frame of each processing case.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "bt_app_gain.h"
+#include "host_bench.h"
+
+#define FRAME                       (120)       /* 7.5 ms of mSBC, 16 kHz; CVSD at 8 kHz is half */
+
+static void fill(int16_t *b, uint32_t num, int16_t v)
+{
+    for (uint32_t i = 0; i < num; i++) {
+        b[i] = (i & 1) ? -v : v;
+    }
+}
+
+static void test_table(void)
+{
+    assert(bt_app_gain_level_to_q15(15) == BT_APP_GAIN_Q15_ONE);
+    for (int l = 1; l < BT_APP_GAIN_LEVEL_NUM; l++) {
+        assert(bt_app_gain_level_to_q15(l) > bt_app_gain_level_to_q15(l - 1));
+        // 2 dB per step: 10^(2/20) = 1.259
+        double ratio = (double)bt_app_gain_level_to_q15(l) / bt_app_gain_level_to_q15(l - 1);
+        assert(ratio > 1.25 && ratio < 1.27);
+    }
+    assert(bt_app_gain_level_to_q15(-1) == bt_app_gain_level_to_q15(0));
+    assert(bt_app_gain_level_to_q15(16) == BT_APP_GAIN_Q15_ONE);
+}
+
+static void test_ramps(void)
+{
+    int16_t b[FRAME];
+
+    bt_app_gain_init();
+    /* unity leaves the frame untouched, including INT16_MIN */
+    for (int i = 0; i < FRAME; i++) {
+        b[i] = (i & 1) ? -32768 : 32767;
+    }
+    bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, b, FRAME);
+    for (int i = 0; i < FRAME; i++) {
+        assert(b[i] == ((i & 1) ? -32768 : 32767));
+    }
+
+    /* ramp down (negative step) ends at the target without a step on the way, then steady */
+    bt_app_gain_set_level(BT_APP_GAIN_PATH_OUTGOING, 9);
+    for (int i = 0; i < FRAME; i++) {
+        b[i] = 10000;
+    }
+    bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, b, FRAME);
+    for (int i = 1; i < FRAME; i++) {
+        assert(b[i] <= b[i - 1] && b[i - 1] - b[i] <= 70);
+    }
+    assert(abs(b[FRAME - 1] - 10000 * 8231 / 32768) <= 2);
+    for (int i = 0; i < FRAME; i++) {
+        b[i] = 10000;
+    }
+    bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, b, FRAME);
+    assert(b[0] == b[FRAME - 1] && abs(b[0] - 10000 * 8231 / 32768) <= 1);
+
+    /* and back up to unity, again in small steps */
+    bt_app_gain_set_level(BT_APP_GAIN_PATH_OUTGOING, 15);
+    for (int i = 0; i < FRAME; i++) {
+        b[i] = 10000;
+    }
+    bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, b, FRAME);
+    for (int i = 1; i < FRAME; i++) {
+        assert(b[i] >= b[i - 1] && b[i] - b[i - 1] <= 70);
+    }
+    assert(abs(b[FRAME - 1] - 10000) <= 2);
+    for (int i = 0; i < FRAME; i++) {
+        b[i] = 1234;
+    }
+    bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, b, FRAME);
+    assert(b[0] == 1234 && b[FRAME - 1] == 1234);
+
+    /* the incoming path keeps its own level */
+    bt_app_gain_set_level(BT_APP_GAIN_PATH_INCOMING, 0);
+    assert(bt_app_gain_get_level(BT_APP_GAIN_PATH_OUTGOING) == 15);
+    assert(bt_app_gain_get_level(BT_APP_GAIN_PATH_INCOMING) == 0);
+    bt_app_gain_set_level(BT_APP_GAIN_PATH_INCOMING, 16);
+    assert(bt_app_gain_get_level(BT_APP_GAIN_PATH_INCOMING) == 0);
+}
+
+static int16_t agc_settle(int16_t in, int frames)
+{
+    int16_t b[FRAME];
+
+    for (int n = 0; n < frames; n++) {
+        fill(b, FRAME, in);
+        bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, b, FRAME);
+    }
+    return (int16_t)abs(b[0]);
+}
+
+static void test_agc(void)
+{
+    bt_app_gain_init();
+    bt_app_gain_agc_enable(BT_APP_GAIN_PATH_OUTGOING, true);
+    assert(bt_app_gain_agc_enabled(BT_APP_GAIN_PATH_OUTGOING));
+    assert(!bt_app_gain_agc_enabled(BT_APP_GAIN_PATH_INCOMING));
+
+    /* quiet and loud talkers end up within a few dB of each other around the target */
+    int16_t quiet = agc_settle(500, 200);
+    int16_t loud = agc_settle(12000, 200);
+    assert(quiet > 1500 && quiet < 3500);
+    assert(loud > 2500 && loud < 4000);
+
+    /* noise below the floor keeps the last gain instead of being pumped up to the target */
+    bt_app_gain_init();
+    bt_app_gain_agc_enable(BT_APP_GAIN_PATH_OUTGOING, true);
+    assert(agc_settle(50, 200) == 50);
+
+    /* switched off, the level gain alone applies */
+    bt_app_gain_agc_enable(BT_APP_GAIN_PATH_OUTGOING, false);
+    assert(agc_settle(500, 2) == 500);
+}
+
+static void bench(const char *name, uint32_t num, int level, bool agc)
+{
+    static int16_t b[FRAME];
+    const int frames = 200000;
+    host_bench_t t;
+    double ns, cycles;
+
+    bt_app_gain_init();
+    bt_app_gain_agc_enable(BT_APP_GAIN_PATH_OUTGOING, agc);
+    host_bench_start(&t);
+    for (int n = 0; n < frames; n++) {
+        fill(b, num, 3000);
+        if (level < 0) {
+            // a new level every frame: every frame is a ramp
+            bt_app_gain_set_level(BT_APP_GAIN_PATH_OUTGOING, (n & 1) ? 9 : 12);
+        } else {
+            bt_app_gain_set_level(BT_APP_GAIN_PATH_OUTGOING, level);
+        }
+        bt_app_gain_process(BT_APP_GAIN_PATH_OUTGOING, b, num);
+        host_bench_sink += (uint16_t)b[n % num];
+    }
+    host_bench_stop(&t, frames, &ns, &cycles);
+    printf("  %-24s %3u samples: %7.1f ns %7.0f cycles per frame (incl. refill)\n", name, (unsigned)num, ns, cycles);
+}
+
+int main(void)
+{
+    test_table();
+    test_ramps();
+    test_agc();
+
+    printf("gain cost:\n");
+    for (uint32_t num = FRAME / 2; num <= FRAME; num *= 2) {
+        bench("unity", num, 15, false);
+        bench("fixed level", num, 9, false);
+        bench("ramp every frame", num, -1, false);
+        bench("fixed level + AGC", num, 9, true);
+    }
+    printf("gain ok\n");
+    return 0;
+}
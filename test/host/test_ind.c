@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_ind.c: only changed indicators are reported, a signal burst is coalesced to one report
+ * per interval, a peer is brought up to date on its own, a disconnected peer is not reported to.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "bt_app_ind.h"
+
+#define CIEV_SENT                   (host_hf_calls[HOST_HF_CIEV_REPORT])
+
+int main(void)
+{
+    esp_bd_addr_t a = {1, 2, 3, 4, 5, 0xa};
+    esp_bd_addr_t b = {1, 2, 3, 4, 5, 0xb};
+
+    host_set_time_us(1000000);
+    bt_app_ind_cind_response(a);
+    bt_app_ind_peer_connected(a);
+    assert(CIEV_SENT == 0 && host_hf_calls[HOST_HF_CIND_RESPONSE] == 1);
+
+    // unchanged, then changed
+    bt_app_ind_set(BT_APP_IND_CALL, 0);
+    assert(CIEV_SENT == 0);
+    bt_app_ind_set(BT_APP_IND_CALL, 1);
+    assert(CIEV_SENT == 1);
+    bt_app_ind_cind_response(b);
+    bt_app_ind_peer_connected(b);
+    assert(CIEV_SENT == 1);
+
+    // signal burst: the first change goes out at once to both peers, the rest is held back
+    host_advance_us(3000000);
+    for (int i = 0; i < 10; i++) {
+        bt_app_ind_set(BT_APP_IND_SIGNAL, (i % 2) ? 2 : 3);
+        host_advance_us(100000);
+    }
+    assert(CIEV_SENT == 1 + 2);
+    // and the last value follows once per peer when the interval is over
+    host_advance_us(2000000);
+    assert(CIEV_SENT == 1 + 4);
+
+    bt_app_ind_update(a);
+    assert(CIEV_SENT == 5);
+    bt_app_ind_peer_disconnected(b);
+    bt_app_ind_set(BT_APP_IND_CALL, 0);
+    assert(CIEV_SENT == 6);
+
+    assert(!bt_app_ind_set(BT_APP_IND_CALLSETUP, 4));
+    assert(bt_app_ind_find("battchg") == BT_APP_IND_BATTCHG);
+    assert(bt_app_ind_get(BT_APP_IND_CALL) == 0 && bt_app_ind_get(BT_APP_IND_SIGNAL) == 2);
+    printf("ind ok, %d reports\n", CIEV_SENT);
+    return 0;
+}
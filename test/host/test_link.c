@@ -0,0 +1,176 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_link.c: polling follows start, stop and the period, the figures cover the last
+ * BT_APP_LINK_WINDOW polls only, a total going backwards starts the window over, loss, throughput
+ * and goodput arithmetic, the 48-byte little-endian dump.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "esp_timer.h"
+#include "esp_hf_ag_api.h"
+#include "bt_app_link.h"
+
+#define POLLS_SENT                  (host_hf_calls[HOST_HF_PKT_STAT_NUMS_GET])
+
+static bt_app_link_pkt_nums_t s_nums;
+static uint64_t s_now_us;
+
+/* one poll a second: 100 packets, 5 of them bad (2 CRC, 2 empty, 1 partial), 6000 audio bytes */
+static void poll(uint32_t rx_total, uint32_t bad)
+{
+    s_nums.rx_total += rx_total;
+    s_nums.rx_correct += rx_total - bad;
+    s_nums.rx_err += bad * 2 / 5;
+    s_nums.rx_none += bad * 2 / 5;
+    s_nums.rx_lost += bad - 2 * (bad * 2 / 5);
+    s_nums.tx_total += rx_total;
+    s_nums.tx_discarded += 1;
+    bt_app_link_add_rx_bytes(6000);
+    s_now_us += 1000000;
+    bt_app_link_on_pkt_nums(&s_nums, s_now_us);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void test_polling(void)
+{
+    host_set_time_us(0);
+    bt_app_link_start(0x81);
+    host_advance_us(3500000);
+    assert(POLLS_SENT == 3);
+
+    // a new period takes effect at once
+    bt_app_link_set_period(250);
+    host_advance_us(1000000);
+    assert(POLLS_SENT == 3 + 4);
+
+    bt_app_link_stop();
+    host_advance_us(5000000);
+    assert(POLLS_SENT == 7);
+    bt_app_link_stats_t st;
+    bt_app_link_get_stats(&st);
+    assert(!st.active);
+
+    // stopped, a new period is only remembered
+    bt_app_link_set_period(BT_APP_LINK_POLL_PERIOD_MS);
+    host_advance_us(5000000);
+    assert(POLLS_SENT == 7);
+}
+
+static void test_window(void)
+{
+    bt_app_link_stats_t st;
+
+    bt_app_link_start(0x81);
+    bt_app_link_stop();
+
+    // one report is no window yet
+    poll(100, 5);
+    bt_app_link_get_stats(&st);
+    assert(st.polls == 1 && st.window_ms == 0 && st.delta.rx_total == 0 && st.throughput_bps == 0);
+
+    // a bad first second, then clean ones: it drops out once the window has moved past it
+    s_nums.rx_total = 0;
+    bt_app_link_start(0x81);
+    bt_app_link_stop();
+    poll(100, 50);
+    for (int i = 0; i < BT_APP_LINK_WINDOW; i++) {
+        poll(100, 5);
+    }
+    bt_app_link_get_stats(&st);
+    assert(st.polls == BT_APP_LINK_WINDOW + 1);
+    assert(st.window_ms == BT_APP_LINK_WINDOW * 1000);
+    assert(st.delta.rx_total == BT_APP_LINK_WINDOW * 100);
+    assert(st.delta.rx_correct == BT_APP_LINK_WINDOW * 95);
+    assert(st.delta.rx_err == BT_APP_LINK_WINDOW * 2 && st.delta.rx_none == BT_APP_LINK_WINDOW * 2);
+    assert(st.delta.rx_lost == BT_APP_LINK_WINDOW && st.delta.tx_discarded == BT_APP_LINK_WINDOW);
+    assert(st.loss_permille == 50);
+    // 6000 bytes a second is 48 kbit/s, 95 % of it good
+    assert(st.throughput_bps == 48000 && st.goodput_bps == 45600);
+
+    poll(100, 50);
+    bt_app_link_get_stats(&st);
+    assert(st.delta.rx_total == BT_APP_LINK_WINDOW * 100);
+    assert(st.loss_permille == (9 * 5 + 50) * 1000 / (BT_APP_LINK_WINDOW * 100));
+
+    // the controller starts counting from zero again: the window starts over, nothing wraps
+    memset(&s_nums, 0, sizeof(s_nums));
+    poll(100, 10);
+    bt_app_link_get_stats(&st);
+    assert(st.polls == BT_APP_LINK_WINDOW + 3 && st.window_ms == 0 && st.delta.rx_total == 0);
+    assert(st.loss_permille == 0);
+    poll(100, 10);
+    bt_app_link_get_stats(&st);
+    assert(st.window_ms == 1000 && st.delta.rx_total == 100 && st.delta.rx_err == 4);
+    assert(st.loss_permille == 100 && st.goodput_bps == 48000 * 90 / 100);
+
+    // only one counter going back is enough
+    s_nums.tx_discarded = 0;
+    poll(0, 0);
+    bt_app_link_get_stats(&st);
+    assert(st.window_ms == 0);
+    // no packets in the window: no loss figure, and no division by zero
+    poll(0, 0);
+    bt_app_link_get_stats(&st);
+    assert(st.delta.rx_total == 0 && st.loss_permille == 0 && st.goodput_bps == 0);
+    assert(st.throughput_bps == 48000);
+}
+
+static void test_dump(void)
+{
+    uint8_t buf[64];
+    bt_app_link_stats_t st;
+
+    memset(&s_nums, 0, sizeof(s_nums));
+    bt_app_link_start(0x81);
+    for (int i = 0; i < 3; i++) {
+        poll(100, 5);
+    }
+    bt_app_link_get_stats(&st);
+
+    assert(bt_app_link_dump(buf, 47) == 0);
+    assert(bt_app_link_dump(NULL, sizeof(buf)) == 0);
+    memset(buf, 0xee, sizeof(buf));
+    assert(bt_app_link_dump(buf, sizeof(buf)) == 48);
+    assert(buf[48] == 0xee);
+
+    assert(buf[0] == BT_APP_LINK_DUMP_VERSION);
+    assert(buf[1] == 1);
+    assert((buf[2] | (buf[3] << 8)) == 50);
+    assert(get_le32(&buf[4]) == 2000);
+    assert(get_le32(&buf[8]) == 200);
+    assert(get_le32(&buf[12]) == 190);
+    assert(get_le32(&buf[16]) == 4);
+    assert(get_le32(&buf[20]) == 4);
+    assert(get_le32(&buf[24]) == 2);
+    assert(get_le32(&buf[28]) == 200);
+    assert(get_le32(&buf[32]) == 2);
+    assert(get_le32(&buf[36]) == 48000);
+    assert(get_le32(&buf[40]) == 45600);
+    assert(get_le32(&buf[44]) == st.polls && st.polls == 3);
+
+    bt_app_link_stop();
+    bt_app_link_dump(buf, sizeof(buf));
+    assert(buf[1] == 0);
+}
+
+int main(void)
+{
+    test_polling();
+    test_window();
+    test_dump();
+    printf("link ok\n");
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_mem.c: periodic samples, a low stack, low heap or fragmented heap warns once until it
+ * clears, a task that is gone keeps its minimum, and the per-subsystem allocation counters.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_mem.h"
+#include "bt_app_tasks.h"
+#include "bt_app_dlog.h"
+
+static int s_dlogs;
+
+void bt_app_dlog_write(bt_app_dlog_id_t id, uint32_t nargs, const uintptr_t *args)
+{
+    s_dlogs++;
+}
+
+static void task_fn(void *arg)
+{
+}
+
+static void sample(void)
+{
+    host_advance_us(BT_APP_MEM_SAMPLE_MS * 1000);
+}
+
+int main(void)
+{
+    bt_app_mem_stats_t st;
+    TaskHandle_t core;
+    TaskHandle_t send;
+
+    bt_app_tasks_create(BT_APP_TASK_CORE, task_fn, NULL, &core);
+    bt_app_tasks_create(BT_APP_TASK_SEND, task_fn, NULL, &send);
+    core->stack_free = 900;
+    send->stack_free = 400;
+    host_heap_free = 100000;
+    host_heap_largest = 60000;
+
+    bt_app_mem_init();
+    sample();
+    bt_app_mem_get_stats(&st);
+    assert(st.samples == 1 && st.warnings == 0 && s_dlogs == 0);
+    assert(st.stack_free[BT_APP_TASK_SEND] == 400 && st.stack_free_min[BT_APP_TASK_SCR] == UINT32_MAX);
+
+    // all three cross, the second sample does not repeat them
+    send->stack_free = 200;
+    host_heap_free = 12000;
+    host_heap_largest = 2000;
+    sample();
+    sample();
+    bt_app_mem_get_stats(&st);
+    assert(st.samples == 3 && st.warnings == 3 && s_dlogs == 3 && st.stack_free_min[BT_APP_TASK_SEND] == 200);
+
+    // cleared, the task is gone and keeps its minimum
+    host_heap_free = 100000;
+    host_heap_largest = 60000;
+    vTaskDelete(send);
+    sample();
+    bt_app_mem_get_stats(&st);
+    assert(st.stack_free[BT_APP_TASK_SEND] == 0 && st.stack_free_min[BT_APP_TASK_SEND] == 200);
+
+    // the next instance is low again and warns again
+    host_tasks[host_task_num - 1].deleted = false;
+    send->stack_free = 180;
+    sample();
+    bt_app_mem_get_stats(&st);
+    assert(st.warnings == 4 && st.stack_free_min[BT_APP_TASK_SEND] == 180);
+
+    void *p = bt_app_mem_alloc(BT_APP_MEM_DISPATCH, 240);
+    bt_app_mem_free(BT_APP_MEM_DISPATCH, p);
+    bt_app_mem_free(BT_APP_MEM_DISPATCH, NULL);
+    bt_app_mem_get_stats(&st);
+    assert(st.subsys[BT_APP_MEM_DISPATCH].allocs == 1 && st.subsys[BT_APP_MEM_DISPATCH].frees == 1);
+    assert(st.subsys[BT_APP_MEM_DISPATCH].bytes == 240 && st.subsys[BT_APP_MEM_DISPATCH].fails == 0);
+    assert(strcmp(bt_app_mem_subsys_name(BT_APP_MEM_DISPATCH), "dispatch") == 0);
+    printf("mem ok, %u samples\n", (unsigned)st.samples);
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_metrics: counters and histograms are summed over the per-core slots, the slots do not
+ * share a cache line, values land in the right power-of-two bucket, reset leaves gauges alone, and
+ * no increment is lost with one pthread per core plus two sharing a core. Prints the cost of an
+ * update.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include "bt_app_metrics.h"
+#include "host_bench.h"
+
+#define THREAD_INCS                 (1000000)
+
+/* each pthread says which core it stands for */
+static _Thread_local BaseType_t s_core;
+
+BaseType_t xPortGetCoreID(void)
+{
+    return s_core;
+}
+
+static uint32_t bucket_sum(bt_app_metric_hist_t id, int b)
+{
+    uint32_t sum = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        sum += atomic_load(&bt_app_metrics_slots[core].hist[id][b]);
+    }
+    return sum;
+}
+
+static void test_slots(void)
+{
+    assert(sizeof(bt_app_metrics_slot_t) % BT_APP_METRICS_CACHE_LINE == 0);
+    assert((uintptr_t)&bt_app_metrics_slots[1] % BT_APP_METRICS_CACHE_LINE == 0);
+
+    s_core = 0;
+    bt_app_metrics_add(BT_APP_METRIC_SCO_IN_BYTES, 240);
+    bt_app_metrics_inc(BT_APP_METRIC_SCO_IN_FRAMES);
+    s_core = 1;
+    bt_app_metrics_add(BT_APP_METRIC_SCO_IN_BYTES, 120);
+    bt_app_metrics_inc(BT_APP_METRIC_SCO_IN_FRAMES);
+    assert(atomic_load(&bt_app_metrics_slots[0].counters[BT_APP_METRIC_SCO_IN_BYTES]) == 240);
+    assert(atomic_load(&bt_app_metrics_slots[1].counters[BT_APP_METRIC_SCO_IN_BYTES]) == 120);
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_SCO_IN_BYTES) == 360);
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_SCO_IN_FRAMES) == 2);
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_SCO_OUT_FRAMES) == 0);
+
+    bt_app_metrics_gauge_set(BT_APP_METRIC_RB_FILL, -5);
+    bt_app_metrics_reset();
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_SCO_IN_BYTES) == 0);
+    assert(atomic_load(&bt_app_metrics_gauges[BT_APP_METRIC_RB_FILL]) == -5);
+    s_core = 0;
+}
+
+static void test_buckets(void)
+{
+    /* value -> bucket: [0,1) [1,2) [2,4) [4,8) ... [2^14, inf) */
+    static const struct {
+        uint32_t v;
+        int bucket;
+    } cases[] = {
+        {0, 0}, {1, 1}, {2, 2}, {3, 2}, {4, 3}, {7, 3}, {8, 4},
+        {7500, 13}, {8191, 13}, {8192, 14}, {16383, 14},
+        {16384, 15}, {1000000, 15}, {UINT32_MAX, 15},
+    };
+
+    bt_app_metrics_reset();
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint32_t before = bucket_sum(BT_APP_METRIC_HF_CB_US, cases[i].bucket);
+        s_core = i & 1;
+        bt_app_metrics_hist_record(BT_APP_METRIC_HF_CB_US, cases[i].v);
+        assert(bucket_sum(BT_APP_METRIC_HF_CB_US, cases[i].bucket) == before + 1);
+    }
+    uint32_t total = 0;
+    for (int b = 0; b < BT_APP_METRICS_HIST_BUCKETS; b++) {
+        total += bucket_sum(BT_APP_METRIC_HF_CB_US, b);
+        // other histograms untouched
+        assert(bucket_sum(BT_APP_METRIC_HF_GEN_LATE_US, b) == 0);
+    }
+    assert(total == sizeof(cases) / sizeof(cases[0]));
+    s_core = 0;
+}
+
+static void *incrementer(void *arg)
+{
+    s_core = (BaseType_t)(intptr_t)arg;
+    for (int i = 0; i < THREAD_INCS; i++) {
+        bt_app_metrics_inc(BT_APP_METRIC_DISPATCH_HANDLED);
+        bt_app_metrics_hist_record(BT_APP_METRIC_DISPATCH_LATENCY_US, i & 0xff);
+    }
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    /* cores 0, 1, 1: the two on core 1 share a slot, as a task and an ISR would */
+    static const int cores[] = {0, 1, 1};
+    pthread_t t[3];
+
+    bt_app_metrics_reset();
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&t[i], NULL, incrementer, (void *)(intptr_t)cores[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        pthread_join(t[i], NULL);
+    }
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_DISPATCH_HANDLED) == 3 * THREAD_INCS);
+    assert(atomic_load(&bt_app_metrics_slots[1].counters[BT_APP_METRIC_DISPATCH_HANDLED]) == 2 * THREAD_INCS);
+    uint32_t total = 0;
+    for (int b = 0; b < BT_APP_METRICS_HIST_BUCKETS; b++) {
+        total += bucket_sum(BT_APP_METRIC_DISPATCH_LATENCY_US, b);
+    }
+    assert(total == 3 * THREAD_INCS);
+    // i & 0xff: 0 once per 256, 128..255 half of them
+    assert(bucket_sum(BT_APP_METRIC_DISPATCH_LATENCY_US, 0) == 3 * THREAD_INCS / 256 + 3);
+    assert(bucket_sum(BT_APP_METRIC_DISPATCH_LATENCY_US, 8) >= 3 * (THREAD_INCS / 2 - 128));
+}
+
+static void bench(void)
+{
+    const int n = 10000000;
+    host_bench_t t;
+    double ns, cycles;
+
+    bt_app_metrics_reset();
+    printf("metrics cost, one thread:\n");
+    host_bench_start(&t);
+    for (int i = 0; i < n; i++) {
+        bt_app_metrics_inc(BT_APP_METRIC_DISPATCH_ENQUEUED);
+    }
+    host_bench_stop(&t, n, &ns, &cycles);
+    printf("  inc          %5.2f ns %5.1f cycles\n", ns, cycles);
+
+    host_bench_start(&t);
+    for (int i = 0; i < n; i++) {
+        bt_app_metrics_hist_record(BT_APP_METRIC_DISPATCH_HANDLER_US, (uint32_t)i & 0x3fff);
+    }
+    host_bench_stop(&t, n, &ns, &cycles);
+    printf("  hist_record  %5.2f ns %5.1f cycles\n", ns, cycles);
+
+    host_bench_start(&t);
+    for (int i = 0; i < n / 100; i++) {
+        host_bench_sink += bt_app_metrics_counter_get(BT_APP_METRIC_DISPATCH_ENQUEUED);
+    }
+    host_bench_stop(&t, n / 100, &ns, &cycles);
+    printf("  counter_get  %5.2f ns %5.1f cycles\n", ns, cycles);
+    assert(bt_app_metrics_counter_get(BT_APP_METRIC_DISPATCH_ENQUEUED) == (uint32_t)n);
+}
+
+int main(void)
+{
+    test_slots();
+    test_buckets();
+    test_concurrent();
+    bench();
+    printf("metrics ok\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * app_hf_msg_prs.c: bulk and per-character parsing, pipelined messages, over-long messages
+ * dropped up to their terminator across calls, lookup by name and by opcode, and a first argument that only starts like an
+ * opcode ("5x", "5abc") or is past the 16-bit range ("70000") finds no command.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "app_hf_msg_prs.h"
+#include "app_hf_msg_set.h"
+
+void hf_msg_args_parser(char *buf, int len);
+
+static int s_msgs;
+static char s_last[HF_MSG_LEN_MAX + 1];
+static int s_handled;
+static int s_handled_argn;
+static int s_opcode_lookups;
+
+static void msg_cb(char *buf, int len)
+{
+    s_msgs++;
+    snprintf(s_last, sizeof(s_last), "%.*s", len, buf);
+}
+
+static int handler(int argn, char **argv)
+{
+    s_handled++;
+    s_handled_argn = argn;
+    return 0;
+}
+
+static const hf_msg_hdl_t s_cmd = {150, "vu", handler};
+
+const hf_msg_hdl_t *hf_find_cmd(const char *name)
+{
+    return strcmp(name, s_cmd.str) == 0 ? &s_cmd : NULL;
+}
+
+/* 5, and 4464 = 70000 cut to 16 bits, answer as well: a sloppy parse would reach the handler */
+const hf_msg_hdl_t *hf_find_cmd_by_opcode(uint16_t opcode)
+{
+    s_opcode_lookups++;
+    return (opcode == s_cmd.opcode || opcode == 5 || opcode == (uint16_t)70000) ? &s_cmd : NULL;
+}
+
+void hf_msg_show_usage(void)
+{
+}
+
+static void parser_init(hf_msg_prs_cb_t *prs)
+{
+    memset(prs, 0, sizeof(*prs));
+    hf_msg_parser_reset_state(prs);
+    hf_msg_parser_register_callback(prs, msg_cb);
+    s_msgs = 0;
+    s_last[0] = '\0';
+}
+
+static void test_pipelined(void)
+{
+    hf_msg_prs_cb_t prs;
+    hf_msg_prs_result_t res;
+    const char *in = "hf vu 0 9;  hf con;hf dis";
+
+    parser_init(&prs);
+    assert(hf_msg_parse_buf(in, strlen(in), &prs, &res) == HF_MSG_PRS_ERR_IN_PROGRESS);
+    assert(res.msgs == 2 && res.consumed == strlen(in) && res.overflows == 0);
+    assert(strcmp(s_last, "hf con;") == 0);
+    assert(hf_msg_parse_buf(";", 1, &prs, &res) == HF_MSG_PRS_ERR_OK);
+    assert(s_msgs == 3 && strcmp(s_last, "hf dis;") == 0);
+}
+
+static void test_overlong(void)
+{
+    hf_msg_prs_cb_t prs;
+    hf_msg_prs_result_t res;
+    char msg[400] = "hf x ";
+
+    // the " hf bad;" inside the dropped message must not be taken for a header
+    for (int i = 0; i < 200; i++) {
+        strcat(msg, "a");
+    }
+    strcat(msg, " hf bad; hf ok;");
+
+    parser_init(&prs);
+    for (const char *c = msg; *c; c++) {
+        hf_msg_parse(*c, &prs);
+    }
+    assert(s_msgs == 1 && strcmp(s_last, "hf ok;") == 0);
+
+    parser_init(&prs);
+    hf_msg_parse_buf(msg, 100, &prs, NULL);
+    hf_msg_parse_buf(msg + 100, strlen(msg) - 100, &prs, &res);
+    assert(s_msgs == 1 && strcmp(s_last, "hf ok;") == 0);
+    assert(res.msgs == 1);
+}
+
+static void args_parse(const char *msg)
+{
+    char buf[HF_MSG_LEN_MAX + 1];
+    int len = snprintf(buf, sizeof(buf), "%s", msg);
+    hf_msg_args_parser(buf, len);
+}
+
+static void test_args_parser(void)
+{
+    s_handled = 0;
+    args_parse("hf vu 0 9;");
+    assert(s_handled == 1 && s_handled_argn == 3);
+    args_parse("hf 150 0 9;");
+    assert(s_handled == 2 && s_handled_argn == 3);
+    args_parse("hf 5;");
+    assert(s_handled == 3 && s_handled_argn == 1);
+    args_parse("hf nope;");
+    assert(s_handled == 3);
+
+    s_opcode_lookups = 0;
+    static const char *const bad[] = {"hf 5x;", "hf 5abc 1;", "hf 150x 0 9;", "hf 70000;", "hf 65534;",
+                                      "hf 99999999999999999999;"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        args_parse(bad[i]);
+        assert(s_handled == 3);
+    }
+    assert(s_opcode_lookups == 0);
+}
+
+int main(void)
+{
+    test_pipelined();
+    test_overlong();
+    test_args_parser();
+    printf("prs ok\n");
+    return 0;
+}
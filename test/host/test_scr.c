@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * app_hf_msg_scr.c: scripts stored in NVS, run in their own task with every command step going
+ * through the executor, event waits that find a level reached before the wait, a timed out wait,
+ * a wait without a timeout or an unknown command stopping the script, delays, the boot script
+ * waiting for the stack, and deleting the boot script clearing the boot key.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "app_hf_msg_set.h"
+#include "app_hf_msg_scr.h"
+#include "app_hf_msg_exec.h"
+
+static char s_ran[256];
+static int s_exec_runs;
+
+static int record(int argn, char **argv)
+{
+    for (int i = 0; i < argn; i++) {
+        strcat(s_ran, argv[i]);
+        strcat(s_ran, i + 1 < argn ? " " : ";");
+    }
+    return 0;
+}
+
+static int con(int argn, char **argv)
+{
+    // the link comes up while the script moves on to its wait
+    hf_scr_post(HF_SCR_EVT_SLC_CONNECTED);
+    return record(argn, argv);
+}
+
+static const hf_msg_hdl_t s_cmds[] = {
+    {5, "con", con},
+    {20, "cona", record},
+    {40, "vu", record},
+    {90, "iron", record},
+};
+
+const hf_msg_hdl_t *hf_find_cmd(const char *name)
+{
+    for (size_t i = 0; i < sizeof(s_cmds) / sizeof(s_cmds[0]); i++) {
+        if (strcmp(s_cmds[i].str, name) == 0) {
+            return &s_cmds[i];
+        }
+    }
+    return NULL;
+}
+
+// not on the executor, the script text is joined from argv
+const char *hf_exec_line(int *argn)
+{
+    return NULL;
+}
+
+// the executor runs the step at once
+hf_exec_err_t hf_exec_run(const hf_msg_hdl_t *hdl, int argn, char **argv, int *ret)
+{
+    s_exec_runs++;
+    *ret = hdl->handler(argn, argv);
+    return HF_EXEC_OK;
+}
+
+static int cmd(const char *line)
+{
+    static char buf[HF_SCR_LEN_MAX];
+    char *argv[32];
+    int argn = 0;
+
+    snprintf(buf, sizeof(buf), "%s", line);
+    for (char *tok = strtok(buf, " "); tok; tok = strtok(NULL, " ")) {
+        argv[argn++] = tok;
+    }
+    return hf_scr_cmd(argn, argv);
+}
+
+static void run(const char *name)
+{
+    char line[32];
+
+    s_ran[0] = '\0';
+    snprintf(line, sizeof(line), "script run %s", name);
+    assert(cmd(line) == 0);
+    TaskHandle_t t = host_task_find("HfScrT");
+    assert(t);
+    host_task_run(t);
+    assert(t->deleted);
+}
+
+int main(void)
+{
+    char text[HF_SCR_LEN_MAX];
+    size_t len = sizeof(text);
+
+    assert(cmd("script add up con, wait slc_connected 5000, cona, delay 20, vu 0 12, iron") == 0);
+    assert(nvs_get_str(0, "up", text, &len) == ESP_OK);
+    assert(strcmp(text, "con, wait slc_connected 5000, cona, delay 20, vu 0 12, iron") == 0);
+    assert(cmd("script add this_name_is_too_long con") != 0);
+    assert(cmd("script boot nope") != 0);
+
+    // the boot script waits for the stack, which is not up
+    assert(cmd("script boot up") == 0);
+    hf_scr_init();
+    TaskHandle_t boot = host_task_find("HfScrT");
+    assert(boot && boot->arg);
+    host_task_run(boot);
+    assert(boot->deleted && s_ran[0] == '\0');
+    assert(cmd("script boot off") == 0);
+    len = sizeof(text);
+    assert(nvs_get_str(0, ".boot", text, &len) == ESP_ERR_NVS_NOT_FOUND);
+
+    hf_scr_post(HF_SCR_EVT_READY);
+    host_set_time_us(1000000);
+    run("up");
+    assert(strcmp(s_ran, "con;cona;vu 0 12;iron;") == 0 && s_exec_runs == 4);
+    assert(esp_timer_get_time() == 1000000 + 20000);
+
+    // a wait without a timeout or a bad time never blocks: the script stops there
+    static const char *const bad_times[] = {"wait slc_connected", "wait slc_connected 5x",
+                                            "wait slc_connected 600001", "delay", "delay -1"};
+    for (size_t i = 0; i < sizeof(bad_times) / sizeof(bad_times[0]); i++) {
+        char line[HF_SCR_LEN_MAX];
+        snprintf(line, sizeof(line), "script add nt cona, %s, iron", bad_times[i]);
+        assert(cmd(line) == 0);
+        int64_t before = esp_timer_get_time();
+        run("nt");
+        assert(strcmp(s_ran, "cona;") == 0 && esp_timer_get_time() == before);
+    }
+
+    // audio never comes up: the script stops at the wait
+    assert(cmd("script add au wait audio_connected 10, iron") == 0);
+    run("au");
+    assert(s_ran[0] == '\0');
+    hf_scr_post(HF_SCR_EVT_AUDIO_CONNECTED);
+    run("au");
+    assert(strcmp(s_ran, "iron;") == 0);
+    // a disconnect clears the connected levels
+    hf_scr_post(HF_SCR_EVT_SLC_DISCONNECTED);
+    run("au");
+    assert(s_ran[0] == '\0');
+
+    assert(cmd("script add bad cona, nope, iron") == 0);
+    run("bad");
+    assert(strcmp(s_ran, "cona;") == 0);
+
+    assert(cmd("script list") == 0);
+    assert(cmd("script del bad") == 0);
+    assert(cmd("script run bad") != 0);
+    assert(host_task_find("HfScrT") == NULL);
+
+    // deleting the boot script takes the boot key with it, deleting another one does not
+    assert(cmd("script boot up") == 0);
+    assert(cmd("script del au") == 0);
+    len = sizeof(text);
+    assert(nvs_get_str(0, ".boot", text, &len) == ESP_OK && strcmp(text, "up") == 0);
+    assert(cmd("script del up") == 0);
+    len = sizeof(text);
+    assert(nvs_get_str(0, ".boot", text, &len) == ESP_ERR_NVS_NOT_FOUND);
+    assert(cmd("script boot off") == 0);
+    printf("scr ok\n");
+    return 0;
+}
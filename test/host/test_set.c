@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * app_hf_msg_set.c: every registry entry is found by its name and by its opcode, before and after
+ * register_hfp_ag(), through the name index checked at compile time; near misses are not found.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "esp_console.h"
+#include "app_hf_msg_set.h"
+
+static void check_all(void)
+{
+    const hf_msg_hdl_t *tbl = hf_get_cmd_tbl();
+    size_t num = hf_get_cmd_tbl_size();
+    char name[32];
+
+    for (size_t i = 0; i < num; i++) {
+        assert(hf_find_cmd(tbl[i].str) == &tbl[i]);
+        assert(hf_find_cmd_by_opcode(tbl[i].opcode) == &tbl[i]);
+        for (size_t j = 0; j < i; j++) {
+            assert(strcmp(tbl[i].str, tbl[j].str) != 0 && tbl[i].opcode != tbl[j].opcode);
+        }
+        // a prefix, an extension and a different case are other names
+        snprintf(name, sizeof(name), "%s_", tbl[i].str);
+        assert(hf_find_cmd(name) == NULL);
+        snprintf(name, sizeof(name), "%.*s", (int)strlen(tbl[i].str) - 1, tbl[i].str);
+        assert(name[0] == '\0' || hf_find_cmd(name) == NULL || strcmp(hf_find_cmd(name)->str, name) == 0);
+        snprintf(name, sizeof(name), "%s", tbl[i].str);
+        name[0] = name[0] - 'a' + 'A';
+        assert(hf_find_cmd(name) == NULL);
+    }
+    assert(hf_find_cmd("") == NULL);
+    assert(hf_find_cmd("zzzz") == NULL);
+    assert(hf_find_cmd_by_opcode(1) == NULL);
+    assert(hf_find_cmd_by_opcode(UINT16_MAX) == NULL);
+}
+
+int main(void)
+{
+    // a boot script may look commands up before registration
+    check_all();
+    register_hfp_ag();
+    assert(host_console_cmds > 0 && (size_t)host_console_cmds <= hf_get_cmd_tbl_size());
+    check_all();
+    printf("set ok, %u commands\n", (unsigned)hf_get_cmd_tbl_size());
+    return 0;
+}
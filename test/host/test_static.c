@@ -0,0 +1,265 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * BT_APP_MEM_STATIC: booted as main.c does it, calls take nothing from the heap afterwards. Three
+ * calls, CVSD and mSBC, each with SLC and audio connect and disconnect, SCO frames both ways with
+ * the generator running off its timer, dispatches to the core task, commands through the executor,
+ * heap samples and the deferred log draining; then an audio connect without a disconnect in
+ * between. Direct allocations are counted by wrapping malloc, calloc and realloc at link time, the
+ * kernel objects the target takes from the heap by host_heap_allocs.
+ *
+ * Built a second time as test_static_dyn with BT_APP_MEM_STATIC 0, where every call creates and
+ * deletes the audio task, ring and timer. Both print the cost of an audio connect and disconnect.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_hf_ag_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_core.h"
+#include "bt_app_hf.h"
+#include "bt_app_gain.h"
+#include "bt_app_ind.h"
+#include "bt_app_link.h"
+#include "bt_app_mem.h"
+#include "bt_app_dlog.h"
+#include "app_hf_msg_set.h"
+#include "app_hf_msg_exec.h"
+#include "app_hf_msg_scr.h"
+#include "host_bench.h"
+
+#define BLOCK_US                    (7500)
+#define CALL_BLOCKS                 (600)       /* 4.5 s: speed and PLC logs, two heap samples */
+
+/* ---- heap ---- */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+static int s_mallocs;
+
+void *__wrap_malloc(size_t size)
+{
+    s_mallocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    s_mallocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    s_mallocs++;
+    return __real_realloc(p, size);
+}
+
+static int heap_allocs(void)
+{
+    return s_mallocs + host_heap_allocs;
+}
+
+/* ---- tasks ---- */
+
+static TaskHandle_t s_dlog;
+
+/* the drain task makes one pass per drain() */
+void vTaskDelay(TickType_t ticks)
+{
+    if (xTaskGetCurrentTaskHandle() == s_dlog) {
+        vTaskDelete(NULL);
+        return;
+    }
+    host_advance_us((int64_t)ticks * 1000 * portTICK_PERIOD_MS);
+}
+
+static void drain(void)
+{
+    host_task_run(s_dlog);
+    s_dlog->deleted = false;
+}
+
+/* ---- stack side ---- */
+
+static esp_hf_incoming_data_cb_t s_recv;
+static esp_hf_outgoing_data_cb_t s_send;
+
+esp_err_t esp_hf_ag_register_data_callback(esp_hf_incoming_data_cb_t recv, esp_hf_outgoing_data_cb_t send)
+{
+    s_recv = recv;
+    s_send = send;
+    return ESP_OK;
+}
+
+static void slc(esp_hf_connection_state_t state)
+{
+    esp_hf_cb_param_t param = {0};
+    memcpy(param.conn_stat.remote_bda, hf_peer_addr, ESP_BD_ADDR_LEN);
+    param.conn_stat.state = state;
+    bt_app_hf_cb(ESP_HF_CONNECTION_STATE_EVT, &param);
+}
+
+static void audio(esp_hf_audio_state_t state)
+{
+    esp_hf_cb_param_t param = {0};
+    memcpy(param.audio_stat.remote_addr, hf_peer_addr, ESP_BD_ADDR_LEN);
+    param.audio_stat.state = state;
+    param.audio_stat.sync_conn_handle = 0x80;
+    bt_app_hf_cb(ESP_HF_AUDIO_STATE_EVT, &param);
+}
+
+static int s_handled;
+
+static void handler(uint16_t event, void *param)
+{
+    s_handled += *(int *)param;
+}
+
+/* typed at the console, run by the executor */
+static void command(const char *line)
+{
+    char buf[64];
+    char *argv[8];
+    int argn = 0;
+
+    snprintf(buf, sizeof(buf), "%s", line);
+    for (char *tok = strtok(buf, " "); tok && argn < 8; tok = strtok(NULL, " ")) {
+        argv[argn++] = tok;
+    }
+    assert(hf_exec_submit(argn, argv) == 0);
+    host_task_run(host_task_find("HfExecT"));
+}
+
+/* one block period: the generator fills the ring, the stack takes a frame each way */
+static void block(bool msbc)
+{
+    static uint8_t in[240];
+    static uint8_t out[240];
+    uint32_t sz = msbc ? 240 : 120;
+
+    host_advance_us(BLOCK_US);
+    host_task_run(host_task_find("BtAppSendDataTask"));
+    s_recv(in, sz);
+    s_send(out, sz);
+}
+
+static void call(bool msbc)
+{
+    int one = 1;
+
+    slc(ESP_HF_CONNECTION_STATE_SLC_CONNECTED);
+    audio(msbc ? ESP_HF_AUDIO_STATE_CONNECTED_MSBC : ESP_HF_AUDIO_STATE_CONNECTED);
+    command("d 11223344");
+    command("ac");
+    // signal twice inside its interval: the second report is held back for the timer
+    command("ind signal 4");
+    command("ind signal 2");
+    for (int i = 0; i < CALL_BLOCKS; i++) {
+        block(msbc);
+        if (i % 50 == 0) {
+            assert(bt_app_work_dispatch(handler, 0, &one, sizeof(one), NULL));
+            host_task_run(host_task_find("BtAppT"));
+            drain();
+        }
+    }
+    command("vu 1 10");
+    command("stats");
+    command("metrics");
+    command("mem");
+    command("end");
+    audio(ESP_HF_AUDIO_STATE_DISCONNECTED);
+    slc(ESP_HF_CONNECTION_STATE_DISCONNECTED);
+    drain();
+}
+
+/* main.c: app_main, the stack up event, then the console */
+static void boot(void)
+{
+    bt_app_dlog_init();
+    bt_app_mem_init();
+    bt_app_task_start_up();
+    hf_scr_init();
+    bt_app_gain_init();
+    bt_app_ind_init();
+    bt_app_link_init();
+    bt_app_hf_audio_init();
+    hf_scr_post(HF_SCR_EVT_READY);
+    register_hfp_ag();
+    s_dlog = host_task_find("BtAppDlogT");
+}
+
+static double s_ns, s_cycles;
+
+static void bench(void)
+{
+    const int n = 2000;
+    host_bench_t t;
+
+    slc(ESP_HF_CONNECTION_STATE_SLC_CONNECTED);
+    host_bench_start(&t);
+    for (int i = 0; i < n; i++) {
+        audio(ESP_HF_AUDIO_STATE_CONNECTED_MSBC);
+        audio(ESP_HF_AUDIO_STATE_DISCONNECTED);
+    }
+    host_bench_stop(&t, n, &s_ns, &s_cycles);
+    slc(ESP_HF_CONNECTION_STATE_DISCONNECTED);
+    drain();
+}
+
+int main(void)
+{
+    // command and log output off the test's
+    fflush(stdout);
+    int out = dup(1);
+    dup2(open("/dev/null", O_WRONLY), 1);
+
+    boot();
+    int booted = heap_allocs();
+    call(false);
+    call(true);
+    call(true);
+    int per_call = (heap_allocs() - booted) / 3;
+    assert(s_handled == 3 * (CALL_BLOCKS / 50));
+#if BT_APP_MEM_STATIC
+    assert(heap_allocs() == booted);
+    // connected again without a disconnect: the ring is drained and the timer restarted
+    slc(ESP_HF_CONNECTION_STATE_SLC_CONNECTED);
+    audio(ESP_HF_AUDIO_STATE_CONNECTED);
+    block(false);
+    audio(ESP_HF_AUDIO_STATE_CONNECTED_MSBC);
+    block(true);
+    audio(ESP_HF_AUDIO_STATE_DISCONNECTED);
+    slc(ESP_HF_CONNECTION_STATE_DISCONNECTED);
+    assert(heap_allocs() == booted);
+#else
+    // task, ring and timer
+    assert(per_call >= 3);
+#endif
+    bench();
+#if BT_APP_MEM_STATIC
+    assert(heap_allocs() == booted);
+#endif
+
+    fflush(stdout);
+    dup2(out, 1);
+    printf("BT_APP_MEM_STATIC %d: heap allocations at boot %d, per call %d\n", BT_APP_MEM_STATIC, booted, per_call);
+    printf("audio connect and disconnect: %.0f ns %.0f cycles\n", s_ns, s_cycles);
+    printf("static ok\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_tasks.c: tasks land on the core of their table entry, static tasks are created static
+ * and only once, a delete gives the deferred log ring back first, and the report works out the
+ * CPU share since the previous one. Names cut by FreeRTOS are still found. The placement check
+ * catches tasks of the table and of the stack (esp_timer, pthreads, Bluedroid) off their core.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_mem.h"
+#include "bt_app_tasks.h"
+
+static TaskHandle_t s_released;
+
+void bt_app_dlog_release(TaskHandle_t task)
+{
+    assert(!task->deleted);
+    s_released = task;
+}
+
+static void task_fn(void *arg)
+{
+    bt_app_tasks_delete(NULL);
+    assert(0);
+}
+
+static void test_create(void)
+{
+    TaskHandle_t h = NULL;
+
+    for (int i = 0; i < BT_APP_TASK_NUM; i++) {
+        const bt_app_task_def_t *t = bt_app_tasks_def(i);
+        assert(t->core == BT_APP_TASKS_CORE_CTRL || t->core == BT_APP_TASKS_CORE_AUDIO || t->core == BT_APP_TASKS_CORE_ANY);
+        assert(t->prio < configMAX_PRIORITIES);
+    }
+    // audio on the core Bluedroid is not pinned to
+    assert(BT_APP_TASKS_CORE_AUDIO != CONFIG_BT_BLUEDROID_PINNED_TO_CORE);
+    assert(bt_app_tasks_def(BT_APP_TASK_SEND)->core == BT_APP_TASKS_CORE_AUDIO);
+
+    assert(bt_app_tasks_create(BT_APP_TASK_SEND, task_fn, NULL, &h) == pdPASS && h);
+    assert(h->is_static == BT_APP_MEM_STATIC && h->core == BT_APP_TASKS_CORE_AUDIO && h->stack == 2048);
+#if BT_APP_MEM_STATIC
+    assert(bt_app_tasks_create(BT_APP_TASK_SEND, task_fn, NULL, NULL) == pdFAIL);
+#endif
+    assert(bt_app_tasks_create(BT_APP_TASK_DLOG, task_fn, NULL, NULL) == pdPASS);
+    assert(host_task_find("BtAppDlogT")->is_static == BT_APP_MEM_STATIC);
+
+    // scripts start again after they deleted themselves, from the heap
+    for (int i = 0; i < 2; i++) {
+        assert(bt_app_tasks_create(BT_APP_TASK_SCR, task_fn, NULL, &h) == pdPASS);
+        assert(!h->is_static && h->core == BT_APP_TASKS_CORE_CTRL);
+        host_task_run(h);
+        assert(h->deleted && s_released == h);
+    }
+
+    // deleting another task
+    h = host_task_find("BtAppSendDataTask");
+    bt_app_tasks_delete(h);
+    assert(h->deleted && s_released == h);
+}
+
+/* bt_app_tasks_print() output */
+static const char *print(void)
+{
+    static char out[1024];
+    FILE *f = tmpfile();
+    int saved = dup(STDOUT_FILENO);
+
+    fflush(stdout);
+    dup2(fileno(f), STDOUT_FILENO);
+    bt_app_tasks_print();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    rewind(f);
+    out[fread(out, 1, sizeof(out) - 1, f)] = '\0';
+    fclose(f);
+    return out;
+}
+
+static void test_print(void)
+{
+    bt_app_mem_stats_t st;
+    TaskHandle_t core = NULL;
+    TaskHandle_t send = NULL;
+    const char *out;
+
+    // the send task's name is longer than FreeRTOS keeps
+    host_tasks_reset();
+    xTaskCreatePinnedToCore(task_fn, "BtAppT", 2048, NULL, 1, &core, 0);
+    xTaskCreatePinnedToCore(task_fn, "BtAppSendDataTask", 2048, NULL, 1, &send, 1);
+    assert(strcmp(send->name, "BtAppSendDataTa") == 0);
+    core->run_time = 20000;
+    send->run_time = 50000;
+    print();
+    core->run_time = 25000;
+    send->run_time = 130000;
+    out = print();
+    assert(strstr(out, "(last 85 ms)"));
+    assert(strstr(out, "BtAppT                0   22   2048   1024    5.8\n"));
+    assert(strstr(out, "BtAppSendDataTask     1   22   2048   1024   94.1\n"));
+    assert(strstr(out, "HfScrT                0   20   4096   not running\n"));
+    bt_app_mem_get_stats(&st);
+    assert(st.subsys[BT_APP_MEM_CONSOLE].allocs == 2 && st.subsys[BT_APP_MEM_CONSOLE].frees == 2);
+}
+
+static void test_check(void)
+{
+    TaskHandle_t h[6];
+
+    host_tasks_reset();
+    xTaskCreatePinnedToCore(task_fn, "BTC_TASK", 4096, NULL, 19, &h[0], BT_APP_TASKS_CORE_CTRL);
+    xTaskCreatePinnedToCore(task_fn, "esp_timer", 4096, NULL, 22, &h[1], BT_APP_TASKS_CORE_TIMER);
+    xTaskCreatePinnedToCore(task_fn, "pthread", 3072, NULL, 5, &h[2], tskNO_AFFINITY);
+    xTaskCreatePinnedToCore(task_fn, "BtAppSendDataTask", 2048, NULL, 22, &h[3], BT_APP_TASKS_CORE_AUDIO);
+    xTaskCreatePinnedToCore(task_fn, "BtAppDlogT", 3072, NULL, 1, &h[4], tskNO_AFFINITY);
+    // not in the plan, wherever it is
+    xTaskCreatePinnedToCore(task_fn, "IDLE1", 1024, NULL, 0, &h[5], 1);
+    assert(bt_app_tasks_check() == 0);
+
+    // a pthread pinned to the audio core, the timer task moved there, the generator on the wrong core
+    h[2]->core = BT_APP_TASKS_CORE_AUDIO;
+    assert(bt_app_tasks_check() == 1);
+    h[1]->core = BT_APP_TASKS_CORE_AUDIO;
+    h[3]->core = BT_APP_TASKS_CORE_CTRL;
+    assert(bt_app_tasks_check() == 3);
+    // the drain task may be anywhere, but not pinned
+    h[4]->core = 0;
+    assert(bt_app_tasks_check() == 4);
+    // a task that is gone is not checked
+    h[3]->deleted = true;
+    assert(bt_app_tasks_check() == 3);
+}
+
+int main(void)
+{
+    test_create();
+    test_print();
+    test_check();
+    printf("tasks ok\n");
+    return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_time.h: a periodic deadline woken by an esp_timer notification does not drift however
+ * late the task runs, lateness is measured from the first due deadline, and waits in ticks last
+ * at least the time asked for. See bench_tick.c for the wakeup latency on a real scheduler.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_time.h"
+
+#define BLOCK_US                    (7500)
+
+static struct host_task s_task;
+
+static void block_timer_cb(void *arg)
+{
+    xTaskNotifyGive(&s_task);
+}
+
+int main(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = block_timer_cb,
+        .name = "block",
+    };
+    esp_timer_handle_t timer;
+    bt_app_time_deadline_t d;
+    int64_t late = -1;
+    uint32_t blocks = 0;
+
+    host_set_time_us(123);
+    bt_app_time_deadline_start(&d, BLOCK_US);
+    assert(bt_app_time_deadline_expired(&d, bt_app_time_us(), &late) == 0 && late == -1);
+    assert(bt_app_time_deadline_remaining_us(&d, bt_app_time_us()) == BLOCK_US);
+    ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer, BLOCK_US));
+
+    // the task wakes up to 3 ms late, sometimes misses a whole block
+    host_current_task = &s_task;
+    for (int i = 0; i < 1000; i++) {
+        host_advance_us(BLOCK_US + ((i * 7919) % 3000) - 1500 + ((i % 97 == 0) ? BLOCK_US : 0));
+        if (ulTaskNotifyTake(pdTRUE, 0) == 0) {
+            continue;
+        }
+        uint32_t due = bt_app_time_deadline_expired(&d, bt_app_time_us(), &late);
+        assert(due >= 1 && late >= 0 && late < 2 * BLOCK_US);
+        blocks += due;
+    }
+    host_current_task = NULL;
+    int64_t elapsed = bt_app_time_us() - 123;
+    assert(blocks == elapsed / BLOCK_US);
+    assert(d.next_us == 123 + (int64_t)(blocks + 1) * BLOCK_US);
+
+    // several periods at once, lateness from the first
+    host_advance_us(d.next_us - bt_app_time_us() + 2 * BLOCK_US + 100);
+    assert(bt_app_time_deadline_expired(&d, bt_app_time_us(), &late) == 3 && late == 2 * BLOCK_US + 100);
+    assert(bt_app_time_deadline_remaining_us(&d, bt_app_time_us()) == BLOCK_US - 100);
+
+    // at 1000 Hz: a whole extra tick for the partly elapsed one
+    assert(bt_app_time_ms_to_ticks(0) == 1);
+    assert(bt_app_time_ms_to_ticks(1) == 2);
+    assert(bt_app_time_ms_to_ticks(10) == 11);
+    printf("time ok, %u blocks\n", (unsigned)blocks);
+    return 0;
+}
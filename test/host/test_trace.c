@@ -0,0 +1,303 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+/*
+ * bt_app_trace.c: the ring keeps the newest BT_APP_TRACE_LEN records in order across the wrap,
+ * clear and disable, records carry the writing task (0 from an ISR), and a dump waits for a
+ * writer preempted inside bt_app_trace_record while later writers are kept out. Prints the cost
+ * of a record.
+ *
+ * "test_trace dump" prints a dump with two tasks interleaving begin/end pairs of one category, an
+ * ISR record and a timestamp wrap, for test_trace_export.py to run through the exporter.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bt_app_trace.h"
+#include "host_bench.h"
+
+/* each pthread says which task it stands for */
+static _Thread_local TaskHandle_t s_self;
+static _Thread_local bool s_on_pthread;
+static bool s_isr;
+
+/* a writer that stops inside bt_app_trace_record until released */
+static TaskHandle_t s_stall_task;
+static atomic_bool s_stalled;
+static atomic_bool s_release;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (s_self && s_self == s_stall_task) {
+        atomic_store(&s_stalled, true);
+        while (!atomic_load(&s_release)) {
+            sched_yield();
+        }
+    }
+    return s_self;
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+    return s_isr;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (s_on_pthread) {
+        usleep(1000);
+    } else {
+        host_advance_us((int64_t)ticks * 1000 * portTICK_PERIOD_MS);
+    }
+}
+
+/* ---- dump output ---- */
+
+static FILE *s_cap;
+static int s_stdout;
+
+static void capture_start(void)
+{
+    fflush(stdout);
+    s_cap = tmpfile();
+    s_stdout = dup(1);
+    dup2(fileno(s_cap), 1);
+}
+
+static void capture_stop(void)
+{
+    fflush(stdout);
+    dup2(s_stdout, 1);
+    close(s_stdout);
+    rewind(s_cap);
+}
+
+typedef struct {
+    uint32_t ts;
+    unsigned cat;
+    unsigned ph;
+    unsigned id;
+    uint32_t arg;
+    uint32_t task;
+} rec_t;
+
+/* records of the captured dump, the count from its header */
+static unsigned read_dump(rec_t *recs, unsigned max, unsigned *tasks)
+{
+    char line[128];
+    unsigned n = 0, header = 0;
+    *tasks = 0;
+    while (fgets(line, sizeof(line), s_cap)) {
+        if (sscanf(line, "TRACE_BEGIN %u", &header) == 1 || strncmp(line, "TRACE_END", 9) == 0) {
+            continue;
+        }
+        if (strncmp(line, "TRACE_TASK:", 11) == 0) {
+            (*tasks)++;
+            continue;
+        }
+        rec_t r;
+        if (sscanf(line, "TRACE:%8x%2x%2x%4x%8x%8x", &r.ts, &r.cat, &r.ph, &r.id, &r.arg, &r.task) == 6) {
+            assert(n < max);
+            recs[n++] = r;
+        }
+    }
+    fclose(s_cap);
+    assert(header == n);
+    return n;
+}
+
+static rec_t s_recs[BT_APP_TRACE_LEN];
+
+static void test_ring(void)
+{
+    TaskHandle_t a, b;
+    unsigned tasks;
+
+    host_tasks_reset();
+    xTaskCreatePinnedToCore(NULL, "BtAppT", 2048, NULL, 1, &a, 0);
+    xTaskCreatePinnedToCore(NULL, "HfExecT", 2048, NULL, 1, &b, 0);
+    bt_app_trace_clear();
+
+    // wraps the ring: the oldest 10 are overwritten
+    host_set_time_us(5000);
+    for (uint32_t i = 0; i < BT_APP_TRACE_LEN + 10; i++) {
+        s_self = (i & 1) ? b : a;
+        bt_app_trace_record(BT_APP_TRACE_CAT_CMD, BT_APP_TRACE_PH_INSTANT, 7, i);
+        host_advance_us(3);
+    }
+    capture_start();
+    bt_app_trace_dump();
+    capture_stop();
+    assert(read_dump(s_recs, BT_APP_TRACE_LEN, &tasks) == BT_APP_TRACE_LEN);
+    assert(tasks == 2);
+    for (uint32_t i = 0; i < BT_APP_TRACE_LEN; i++) {
+        assert(s_recs[i].arg == i + 10 && s_recs[i].id == 7 && s_recs[i].ph == BT_APP_TRACE_PH_INSTANT);
+        assert(s_recs[i].task == (uint32_t)(uintptr_t)((s_recs[i].arg & 1) ? b : a));
+        assert(s_recs[i].ts == 5000 + 3 * (i + 10));
+    }
+
+    // an ISR on core 1
+    bt_app_trace_clear();
+    s_isr = true;
+    host_core_id = 1;
+    bt_app_trace_record(BT_APP_TRACE_CAT_SCO_IN, BT_APP_TRACE_PH_INSTANT, 0, 60);
+    s_isr = false;
+    host_core_id = 0;
+    // off: nothing recorded
+    bt_app_trace_enable(false);
+    bt_app_trace_record(BT_APP_TRACE_CAT_SCO_IN, BT_APP_TRACE_PH_INSTANT, 0, 61);
+    bt_app_trace_enable(true);
+    capture_start();
+    bt_app_trace_dump();
+    capture_stop();
+    assert(read_dump(s_recs, BT_APP_TRACE_LEN, &tasks) == 1);
+    assert(s_recs[0].task == 0 && s_recs[0].cat == (BT_APP_TRACE_CAT_SCO_IN | 0x80) && s_recs[0].arg == 60);
+
+    bt_app_trace_clear();
+    capture_start();
+    bt_app_trace_dump();
+    capture_stop();
+    assert(read_dump(s_recs, BT_APP_TRACE_LEN, &tasks) == 0);
+}
+
+/* ---- a dump waits for the writers inside ---- */
+
+static struct host_task s_stall;
+static atomic_bool s_dumped;
+
+static void *stalled_writer(void *arg)
+{
+    s_on_pthread = true;
+    s_self = &s_stall;
+    bt_app_trace_record(BT_APP_TRACE_CAT_RB, BT_APP_TRACE_PH_COUNTER, BT_APP_TRACE_RB_FILL, 0xabcd);
+    return NULL;
+}
+
+static void *dumper(void *arg)
+{
+    s_on_pthread = true;
+    bt_app_trace_dump();
+    atomic_store(&s_dumped, true);
+    return NULL;
+}
+
+static void test_in_flight(void)
+{
+    pthread_t w, d;
+    unsigned tasks;
+
+    bt_app_trace_clear();
+    s_stall_task = &s_stall;
+    pthread_create(&w, NULL, stalled_writer, NULL);
+    while (!atomic_load(&s_stalled)) {
+        sched_yield();
+    }
+
+    capture_start();
+    pthread_create(&d, NULL, dumper, NULL);
+    usleep(50000);
+    // the writer holds the dump off however long it is stalled
+    assert(!atomic_load(&s_dumped));
+    // and nobody gets in meanwhile
+    s_self = NULL;
+    bt_app_trace_record(BT_APP_TRACE_CAT_CMD, BT_APP_TRACE_PH_INSTANT, 1, 0xdead);
+    atomic_store(&s_release, true);
+    pthread_join(w, NULL);
+    pthread_join(d, NULL);
+    capture_stop();
+    assert(atomic_load(&s_dumped));
+    s_stall_task = NULL;
+
+    assert(read_dump(s_recs, BT_APP_TRACE_LEN, &tasks) == 1);
+    assert(s_recs[0].arg == 0xabcd && s_recs[0].task == (uint32_t)(uintptr_t)&s_stall);
+    assert(s_recs[0].ph == BT_APP_TRACE_PH_COUNTER && s_recs[0].id == BT_APP_TRACE_RB_FILL);
+
+    // recording is back on after the dump
+    bt_app_trace_record(BT_APP_TRACE_CAT_CMD, BT_APP_TRACE_PH_INSTANT, 1, 0xbeef);
+    capture_start();
+    bt_app_trace_dump();
+    capture_stop();
+    assert(read_dump(s_recs, BT_APP_TRACE_LEN, &tasks) == 2 && s_recs[1].arg == 0xbeef);
+}
+
+static void bench(void)
+{
+    const int n = 10000000;
+    host_bench_t t;
+    double ns, cycles;
+
+    s_self = NULL;
+    host_tasks_reset();
+    xTaskCreatePinnedToCore(NULL, "BtAppT", 2048, NULL, 1, &s_self, 0);
+    host_bench_start(&t);
+    for (int i = 0; i < n; i++) {
+        bt_app_trace_record(BT_APP_TRACE_CAT_SCO_OUT, BT_APP_TRACE_PH_BEGIN, 0, i);
+    }
+    host_bench_stop(&t, n, &ns, &cycles);
+    printf("trace cost per record: %.1f ns %.0f cycles\n", ns, cycles);
+}
+
+/* ---- exporter input ---- */
+
+static void dump_for_export(void)
+{
+    TaskHandle_t btc, send;
+
+    host_tasks_reset();
+    xTaskCreatePinnedToCore(NULL, "BTC_TASK", 4096, NULL, 1, &btc, 0);
+    xTaskCreatePinnedToCore(NULL, "BtAppSendDataTask", 2048, NULL, 1, &send, 1);
+    bt_app_trace_clear();
+    // 2 ms before the 32-bit microsecond stamp wraps
+    host_set_time_us(0xffffffffll - 2000);
+
+    // the same category from two tasks, interleaved: on one track per category these mis-nest
+    s_self = btc;
+    bt_app_trace_record(BT_APP_TRACE_CAT_HF_EVT, BT_APP_TRACE_PH_BEGIN, 1, 0);
+    host_advance_us(500);
+    s_self = send;
+    host_core_id = 1;
+    bt_app_trace_record(BT_APP_TRACE_CAT_HF_EVT, BT_APP_TRACE_PH_BEGIN, 3, 0);
+    host_advance_us(500);
+    s_self = btc;
+    host_core_id = 0;
+    bt_app_trace_record(BT_APP_TRACE_CAT_HF_EVT, BT_APP_TRACE_PH_END, 1, 0);
+    host_advance_us(800);
+    s_isr = true;
+    bt_app_trace_record(BT_APP_TRACE_CAT_SCO_IN, BT_APP_TRACE_PH_INSTANT, 0, 60);
+    s_isr = false;
+    // past the wrap
+    host_advance_us(700);
+    s_self = send;
+    host_core_id = 1;
+    bt_app_trace_record(BT_APP_TRACE_CAT_SCO_OUT, BT_APP_TRACE_PH_BEGIN, 0, 120);
+    host_advance_us(100);
+    bt_app_trace_record(BT_APP_TRACE_CAT_SCO_OUT, BT_APP_TRACE_PH_END, 0, 120);
+    bt_app_trace_record(BT_APP_TRACE_CAT_HF_EVT, BT_APP_TRACE_PH_END, 3, 0);
+    bt_app_trace_dump();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "dump") == 0) {
+        dump_for_export();
+        return 0;
+    }
+    test_ring();
+    test_in_flight();
+    bench();
+    printf("trace ok\n");
+    return 0;
+}
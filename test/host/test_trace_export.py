@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+#
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""
+tools/trace_to_chrome.py on the dump printed by "test_trace dump": one track per task, named as
+FreeRTOS truncates it, and one per ISR core, begin/end pairs of the same category from two
+interleaved tasks nest on their own tracks, and time keeps going forward across the 32-bit wrap.
+
+usage: test_trace_export.py <test_trace binary> <tools dir> <main dir>
+"""
+
+import json
+import subprocess
+import sys
+
+
+def main():
+    test_trace, tools, src = sys.argv[1:4]
+    dump = subprocess.run([test_trace, 'dump'], check=True, capture_output=True, text=True).stdout
+    out = subprocess.run([sys.executable, tools + '/trace_to_chrome.py', '-s', src], input=dump, check=True,
+                         capture_output=True, text=True).stdout
+    events = json.loads(out)['traceEvents']
+
+    tracks = {e['tid']: e['args']['name'] for e in events if e['ph'] == 'M'}
+    assert sorted(tracks.values()) == sorted(['BTC_TASK', 'BtAppSendDataTa', 'ISR core 0']), tracks
+    by_name = {name: tid for tid, name in tracks.items()}
+
+    slices = [e for e in events if e['ph'] != 'M']
+    assert len(slices) == 7, slices
+    ts = [e['ts'] for e in slices]
+    assert ts == sorted(ts) and ts[-1] - ts[0] == 2600 and ts[-1] > 1 << 32, ts
+
+    # every end closes the begin of the same name on its own track
+    open_slices = {}
+    for e in slices:
+        if e['ph'] == 'B':
+            open_slices.setdefault(e['tid'], []).append(e['name'])
+        elif e['ph'] == 'E':
+            assert open_slices[e['tid']].pop() == e['name'], e
+    assert all(not s for s in open_slices.values()), open_slices
+
+    assert [e['name'] for e in slices if e['tid'] == by_name['BtAppSendDataTa']] == \
+        ['VOLUME_CONTROL_EVT', 'outgoing frame', 'outgoing frame', 'VOLUME_CONTROL_EVT']
+    assert [e['args']['core'] for e in slices if e['tid'] == by_name['BtAppSendDataTa']] == [1, 1, 1, 1]
+    isr = [e for e in slices if e['tid'] == by_name['ISR core 0']]
+    assert len(isr) == 1 and isr[0]['cat'] == 'sco_in' and isr[0]['args']['arg'] == 60
+    print('trace export ok')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+#
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""
+Decode deferred log records printed by the firmware in raw mode (`hf dlog raw`).
+
+Each record is one line "DLOG:<hex>" whose fields are fixed-width hex, most significant digit first:
+    ts_us(8) id(4) nargs(2) core(2) args(8 * nargs) str(2 * bytes)
+
+The format strings are read from the BT_APP_DLOG_FORMATS list in main/bt_app_dlog.h, so the decoder
+always matches the firmware it was built with. The text of %s arguments travels in str, NUL
+terminated, and the argument is its offset there.
+
+usage: dlog_decode.py [-H main/bt_app_dlog.h] [capture.log]   (reads stdin without a file)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+ENTRY_RE = re.compile(r'X\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"([^"]*)"\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+CONV_RE = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)([diuxXcs%])')
+LEVELS = {'ESP_LOG_ERROR': 'E', 'ESP_LOG_WARN': 'W', 'ESP_LOG_INFO': 'I',
+          'ESP_LOG_DEBUG': 'D', 'ESP_LOG_VERBOSE': 'V'}
+
+
+def load_formats(header):
+    with open(header) as f:
+        text = f.read()
+    start = text.index('#define BT_APP_DLOG_FORMATS(X)')
+    end = text.index('\n\n', start)
+    return [(m.group(1), LEVELS.get(m.group(2), '?'), m.group(3), m.group(4))
+            for m in ENTRY_RE.finditer(text[start:end])]
+
+
+def format_record(fmt, args, text=b''):
+    it = iter(args)
+
+    def conv(m):
+        flags, c = m.group(1), m.group(2)
+        if c == '%':
+            return '%'
+        v = next(it, 0)
+        if c == 's':
+            return ('%' + flags + 's') % text[v:].split(b'\0', 1)[0].decode('utf-8', 'replace')
+        if c in 'di':
+            v = v - (1 << 32) if v & 0x80000000 else v
+            c = 'd'
+        return ('%' + flags + c) % v
+
+    return CONV_RE.sub(conv, fmt)
+
+
+def decode_line(line, formats):
+    pos = line.find('DLOG:')
+    if pos < 0:
+        return None
+    h = line[pos + 5:].strip()
+    if len(h) < 16:
+        return None
+    ts, rid, nargs, core = int(h[0:8], 16), int(h[8:12], 16), int(h[12:14], 16), int(h[14:16], 16)
+    args = [int(h[16 + 8 * i:24 + 8 * i], 16) for i in range(nargs) if len(h) >= 24 + 8 * i]
+    text = bytes.fromhex(h[16 + 8 * nargs:]) if len(h) % 2 == 0 else b''
+    if rid >= len(formats):
+        return '%10.3f  core%d  ? unknown id %d %s' % (ts / 1e6, core, rid, args)
+    name, level, tag, fmt = formats[rid]
+    return '%10.3f  core%d  %s (%s) %s' % (ts / 1e6, core, level, tag, format_record(fmt, args, text))
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument('-H', '--header', default=os.path.join(here, '..', 'main', 'bt_app_dlog.h'))
+    parser.add_argument('capture', nargs='?')
+    args = parser.parse_args()
+
+    formats = load_formats(args.header)
+    src = open(args.capture, errors='replace') if args.capture else sys.stdin
+    for line in src:
+        out = decode_line(line, formats)
+        if out is not None:
+            print(out)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+#
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""
+Reference host client for the binary framed control protocol (main/app_hf_msg_bin.c).
+
+Frame: SOF 0xA5 | len LE16 | type | req_id | opcode LE16 | args | crc LE16 (CRC-16/CCITT-FALSE over len..args)
+Args: 0x01 + u32 LE, or 0x02 + length byte + characters.
+
+examples:
+  hf_bin_client.py /dev/ttyUSB0 enter               send "binmode" on the text console
+  hf_bin_client.py /dev/ttyUSB0 cmd 40 0 12         volume update, same as "hf vu 0 12;"
+  hf_bin_client.py /dev/ttyUSB0 cmd 40 0 12 -u 0,1  the same with both arguments sent as u32
+  hf_bin_client.py /dev/ttyUSB0 cmd 150 p 500       stats poll period
+  hf_bin_client.py /dev/ttyUSB0 events              print connection and audio events
+  hf_bin_client.py /dev/ttyUSB0 bench -n 1000 -w 8  pipelined PING round trips
+  hf_bin_client.py --selftest                       framing and bench against a local Python pty responder;
+                                                    the bench numbers time the responder, not the firmware;
+                                                    test/host/test_bin.c tests and times the firmware side
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import threading
+import time
+import tty
+
+SOF = 0xA5
+TYPE_REQ, TYPE_RSP, TYPE_EVT = 1, 2, 3
+ARG_U32, ARG_STR = 1, 2
+OP_PING, OP_EXIT = 0xFFFE, 0xFFFF
+STATUS = {0: 'ok', 1: 'unknown opcode', 2: 'bad args', 3: 'bad type', 4: 'busy'}
+BODY_MIN, BODY_MAX = 4, 256
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode_args(args, u32=()):
+    """ints and the positions in u32 as u32, everything else as str: the handlers take text, so a
+    string is always right, and "0123" or "99999999999" reach them as typed"""
+    out = b''
+    for i, a in enumerate(args):
+        if isinstance(a, int) or i in u32:
+            v = int(a)
+            if not 0 <= v <= 0xFFFFFFFF:
+                raise ValueError('argument %d: %d does not fit a u32' % (i, v))
+            out += struct.pack('<BI', ARG_U32, v)
+        else:
+            s = a.encode()
+            if len(s) > 255:
+                raise ValueError('argument %d: longer than 255 bytes' % i)
+            out += struct.pack('<BB', ARG_STR, len(s)) + s
+    return out
+
+
+def decode_args(data):
+    vals, i = [], 0
+    while i < len(data):
+        t = data[i]
+        if t == ARG_U32 and i + 5 <= len(data):
+            vals.append(struct.unpack_from('<I', data, i + 1)[0])
+            i += 5
+        elif t == ARG_STR and i + 2 <= len(data):
+            n = data[i + 1]
+            vals.append(data[i + 2:i + 2 + n].decode(errors='replace'))
+            i += 2 + n
+        else:
+            break
+    return vals
+
+
+def encode_frame(ftype, req_id, opcode, args=b''):
+    body = struct.pack('<BBH', ftype, req_id, opcode) + args
+    hdr = struct.pack('<H', len(body))
+    return bytes([SOF]) + hdr + body + struct.pack('<H', crc16(hdr + body))
+
+
+class Deframer:
+    """SOF hunt plus length and CRC check, anything else on the line (logs, printf) is skipped"""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while True:
+            i = self.buf.find(bytes([SOF]))
+            if i < 0:
+                self.buf.clear()
+                break
+            del self.buf[:i]
+            if len(self.buf) < 3:
+                break
+            n = struct.unpack_from('<H', self.buf, 1)[0]
+            if n < BODY_MIN or n > BODY_MAX:
+                del self.buf[:1]
+                continue
+            if len(self.buf) < 3 + n + 2:
+                break
+            body = bytes(self.buf[3:3 + n])
+            crc = struct.unpack_from('<H', self.buf, 3 + n)[0]
+            if crc != crc16(bytes(self.buf[1:3]) + body):
+                del self.buf[:1]
+                continue
+            del self.buf[:3 + n + 2]
+            ftype, req_id, opcode = struct.unpack_from('<BBH', body)
+            frames.append((ftype, req_id, opcode, decode_args(body[4:])))
+        return frames
+
+
+class Link:
+    def __init__(self, fd):
+        self.fd = fd
+        self.deframer = Deframer()
+        self.pending = []
+
+    def write(self, data):
+        os.write(self.fd, data)
+
+    def read_frames(self, timeout):
+        r, _, _ = select.select([self.fd], [], [], timeout)
+        if not r:
+            return []
+        return self.deframer.feed(os.read(self.fd, 4096))
+
+    def request(self, req_id, opcode, args=b'', timeout=5.0):
+        self.write(encode_frame(TYPE_REQ, req_id, opcode, args))
+        end = time.time() + timeout
+        while time.time() < end:
+            for f in self.read_frames(0.1):
+                if f[0] == TYPE_RSP and f[1] == req_id:
+                    return f
+                if f[0] == TYPE_EVT:
+                    print_event(f)
+        return None
+
+
+def print_event(f):
+    print('event %d: %s' % (f[2], f[3]))
+
+
+def open_serial(path, baud):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    if baud:
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, 'B%d' % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def bench(link, count, window):
+    """pipeline `window` PINGs, report round-trip latency and frames/s"""
+    sent, done, lat = 0, 0, []
+    t_sent = {}
+    start = time.time()
+    while done < count:
+        while sent < count and sent - done < window:
+            rid = sent & 0xFF
+            t_sent[rid] = time.time()
+            link.write(encode_frame(TYPE_REQ, rid, OP_PING))
+            sent += 1
+        frames = link.read_frames(2.0)
+        if not frames:
+            print('timeout after %d of %d responses' % (done, count))
+            break
+        for f in frames:
+            if f[0] == TYPE_RSP and f[2] == OP_PING and f[1] in t_sent:
+                lat.append(time.time() - t_sent.pop(f[1]))
+                done += 1
+    elapsed = time.time() - start
+    if lat:
+        lat.sort()
+        print('%d round trips in %.3f s: %.0f req/s, latency p50 %.2f ms, p99 %.2f ms, max %.2f ms' % (
+            len(lat), elapsed, len(lat) / elapsed, lat[len(lat) // 2] * 1e3,
+            lat[min(len(lat) - 1, int(len(lat) * 0.99))] * 1e3, lat[-1] * 1e3))
+
+
+def responder(fd, stop):
+    """minimal device side for --selftest: answers PING and EXIT, reports unknown opcodes"""
+    d = Deframer()
+    while not stop.is_set():
+        r, _, _ = select.select([fd], [], [], 0.1)
+        if not r:
+            continue
+        for ftype, rid, op, _ in d.feed(os.read(fd, 4096)):
+            status = 0 if op in (OP_PING, OP_EXIT) else 1
+            os.write(fd, b'I (123) log line between frames\n' if rid % 16 == 0 else b'')
+            os.write(fd, encode_frame(TYPE_RSP, rid, op, encode_args([status, 0])))
+
+
+def selftest(args):
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    stop = threading.Event()
+    t = threading.Thread(target=responder, args=(slave, stop), daemon=True)
+    t.start()
+    link = Link(master)
+    f = link.request(1, 40, encode_args([0, 12]))
+    assert f and f[3][0] == 1, f
+    print('selftest: the bench below times the Python pty responder, not the firmware')
+    bench(link, args.n, args.w)
+    stop.set()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1],
+                                     formatter_class=argparse.RawDescriptionHelpFormatter, epilog=__doc__)
+    parser.add_argument('port', nargs='?')
+    parser.add_argument('action', nargs='?', choices=['enter', 'exit', 'ping', 'cmd', 'events', 'bench'])
+    parser.add_argument('rest', nargs='*')
+    parser.add_argument('-b', '--baud', type=int, default=115200)
+    parser.add_argument('-n', type=int, default=1000, help='bench requests')
+    parser.add_argument('-w', type=int, default=8, help='bench pipeline depth')
+    parser.add_argument('-u', '--u32', default='',
+                        help='cmd: comma-separated positions of arguments sent as u32, the rest are strings')
+    parser.add_argument('--selftest', action='store_true')
+    args = parser.parse_args()
+
+    if args.selftest:
+        selftest(args)
+        return
+    if not args.port or not args.action:
+        parser.error('port and action are required')
+
+    link = Link(open_serial(args.port, args.baud))
+    if args.action == 'enter':
+        link.write(b'binmode\n')
+    elif args.action == 'exit':
+        print(link.request(0, OP_EXIT))
+    elif args.action == 'ping':
+        print(link.request(0, OP_PING))
+    elif args.action == 'cmd':
+        u32 = {int(i) for i in args.u32.split(',') if i}
+        f = link.request(1, int(args.rest[0]), encode_args(args.rest[1:], u32))
+        if f is None:
+            sys.exit('no response')
+        print('status %s, return %d' % (STATUS.get(f[3][0], f[3][0]), f[3][1]))
+    elif args.action == 'events':
+        while True:
+            for f in link.read_frames(1.0):
+                if f[0] == TYPE_EVT:
+                    print_event(f)
+    elif args.action == 'bench':
+        bench(link, args.n, args.w)
+
+
+if __name__ == '__main__':
+    main()
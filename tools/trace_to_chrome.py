@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+#
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""
+Convert an event trace dump (`hf trace`) to Chrome trace JSON for chrome://tracing or ui.perfetto.dev.
+
+Each record is one line "TRACE:<hex>" with fixed-width hex fields, most significant digit first:
+    ts_us(8) cat(2, bit 7 = core) ph(2) id(4) arg(8) task(8)
+
+task is the handle of the task that wrote the record, 0 from an ISR. Every task gets its own track,
+named from the "TRACE_TASK:<handle> <name>" lines of the dump, so begin/end pairs nest per task.
+
+HFP event names are read from c_hf_evt_str in main/bt_app_hf.c and command names from HF_CMD_REGISTRY in
+main/app_hf_msg_set.c, so the output matches the firmware the dump came from.
+
+usage: trace_to_chrome.py [-s main] [capture.log] [-o trace.json]   (reads stdin without a file)
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+# same order as bt_app_trace_cat_t
+CATEGORIES = ['dispatcher', 'hf_cb', 'sco_in', 'sco_out', 'ringbuf', 'command']
+RB_NAMES = ['rb.fill_bytes', 'rb.send_fail', 'rb.underrun']
+
+
+def load_hf_events(src_dir):
+    with open(os.path.join(src_dir, 'bt_app_hf.c')) as f:
+        text = f.read()
+    m = re.search(r'c_hf_evt_str\[\]\s*=\s*\{(.*?)\};', text, re.S)
+    return re.findall(r'"([^"]*)"', m.group(1)) if m else []
+
+
+def load_commands(src_dir):
+    with open(os.path.join(src_dir, 'app_hf_msg_set.c')) as f:
+        text = f.read()
+    return {int(op): name for name, op in re.findall(r'^\s*X\((\w+),\s*(\d+),', text, re.M)}
+
+
+def record_name(cat, ph, rid, hf_events, commands):
+    if cat == 0:
+        return ('enqueue evt %d' if ph == 'i' else 'dispatch evt %d') % rid
+    if cat == 1:
+        return hf_events[rid] if rid < len(hf_events) else 'hf evt %d' % rid
+    if cat == 2:
+        return 'incoming frame'
+    if cat == 3:
+        return 'outgoing frame'
+    if cat == 4:
+        return RB_NAMES[rid] if rid < len(RB_NAMES) else 'rb %d' % rid
+    if cat == 5:
+        return 'hf ' + commands.get(rid, '#%d' % rid)
+    return 'cat%d id %d' % (cat, rid)
+
+
+def parse(lines):
+    """task names by handle, and the records as (ts, cat_core, ph, id, arg, task)"""
+    names = {}
+    records = []
+    for line in lines:
+        pos = line.find('TRACE_TASK:')
+        if pos >= 0:
+            handle, _, name = line[pos + 11:].strip().partition(' ')
+            names[int(handle, 16)] = name
+            continue
+        pos = line.find('TRACE:')
+        if pos < 0:
+            continue
+        h = line[pos + 6:].strip()
+        if len(h) < 32:
+            continue
+        records.append((int(h[0:8], 16), int(h[8:10], 16), chr(int(h[10:12], 16)), int(h[12:16], 16),
+                        int(h[16:24], 16), int(h[24:32], 16)))
+    return names, records
+
+
+def convert(names, records, hf_events, commands):
+    events = []
+    tids = {}
+
+    def track(task, core):
+        key = task if task else ('isr', core)
+        if key not in tids:
+            tids[key] = len(tids)
+            if task:
+                name = names.get(task, 'task 0x%08x' % task)
+            else:
+                name = 'ISR core %d' % core
+            events.append({'ph': 'M', 'name': 'thread_name', 'pid': 0, 'tid': tids[key], 'args': {'name': name}})
+        return tids[key]
+
+    wrap = 0
+    last = None
+    depth = {}
+    for ts, cat_core, ph, rid, arg, task in records:
+        # a record is claimed before it is stamped, so neighbours from another task or core can be
+        # slightly out of order; only a step back by more than half the range is a wrap
+        base = wrap
+        if last is not None and last - ts > 1 << 31:
+            wrap += 1 << 32
+            base = wrap
+        elif last is not None and ts - last > 1 << 31:
+            # stamped just before the wrap, claimed after a record stamped after it
+            base = wrap - (1 << 32)
+        if base == wrap:
+            last = ts
+        cat, core = cat_core & 0x7f, cat_core >> 7
+        if cat >= len(CATEGORIES):
+            continue
+        tid = track(task, core)
+        # the ring may have overwritten the begin of the first slices
+        if ph == 'E':
+            if depth.get(tid, 0) == 0:
+                continue
+            depth[tid] -= 1
+        elif ph == 'B':
+            depth[tid] = depth.get(tid, 0) + 1
+        ev = {'name': record_name(cat, ph, rid, hf_events, commands), 'cat': CATEGORIES[cat], 'ph': ph,
+              'ts': ts + base, 'pid': 0, 'tid': tid, 'args': {'arg': arg, 'core': core}}
+        if ph == 'i':
+            ev['s'] = 't'
+        elif ph == 'C':
+            ev['args'] = {'value': arg}
+        events.append(ev)
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument('-s', '--src', default=os.path.join(here, '..', 'main'))
+    parser.add_argument('-o', '--output')
+    parser.add_argument('capture', nargs='?')
+    args = parser.parse_args()
+
+    src = open(args.capture, errors='replace') if args.capture else sys.stdin
+    names, records = parse(src)
+    trace = convert(names, records, load_hf_events(args.src), load_commands(args.src))
+    out = open(args.output, 'w') if args.output else sys.stdout
+    json.dump(trace, out, indent=1)
+    out.write('\n')
+
+
+if __name__ == '__main__':
+    main()